@@ -0,0 +1,611 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "WibasCore.hh"
+#include "EnergyTest.hh"
+#include "PhasespacePoint.hh"
+#include "FastPointMap.hh"
+#include "FitResult.hh"
+#include "WibGaussFitFunction.hh"
+#include "WibVoigtFitFunction.hh"
+#include "WibVoigtFitFunction2D.hh"
+#include "WibCrystalBallFitFunction.hh"
+#include "WibModelFitFunction.hh"
+#include "SimplexModelFitter.hh"
+#include "PerfCounters.hh"
+
+#include "RooMsgService.h"
+
+
+// Synthetic-data benchmarks of the WiBaS and energy test hot spots. Every
+// measurement is one record of the sweep parameters (number of points N,
+// neighbors k, dimension, threads) and the time per item, written as JSON
+// and CSV. With --counters the hardware counters (cycles, instructions,
+// LLC misses, branch misses) of every benchmarked region are recorded as
+// well, per thread for the threaded distance scan. thread is -1 for
+// records that cover all threads of a region.
+// Usage: benchmarkApp [--quick] [--counters] [--json file] [--csv file]
+
+
+struct BenchmarkRecord
+{
+    std::string name;
+    long n;
+    long k;
+    int dim;
+    int threads;
+    int thread;
+    long items;
+    double seconds;
+    bool hasCounts[PerfCounters::NUM_EVENTS];
+    double counts[PerfCounters::NUM_EVENTS];
+};
+
+
+
+// Exposes the neighbor selection of CalcWeight
+class BenchmarkWiBaS : public WiBaS
+{
+    public:
+        BenchmarkWiBaS(WibFitFunction& fitFunction) : WiBaS(fitFunction) {}
+
+        unsigned int SelectNeighbors(PhasespacePoint& refPoint, unsigned int k, std::vector<FastPointMap>& sorted){
+            SortByDistance(refPoint, sorted);
+            return GetCutIndex(sorted, k);
+        }
+
+        std::vector<PhasespacePoint*>& GetPoints(){ return GetPointVector(); }
+};
+
+
+
+namespace {
+
+const double meanMass = 782.65;
+const double width = 8.49;
+const double minMass = meanMass - 150;
+const double maxMass = meanMass + 150;
+
+std::mt19937 generator(4711);
+bool useCounters = false;
+
+
+
+// Hardware counters of one benchmarked region, only opened with --counters
+class RegionCounters
+{
+    public:
+        explicit RegionCounters(bool inherit=false) : _counters(NULL) {
+            if(useCounters){
+                _counters = new PerfCounters(inherit);
+                _counters->Start();
+            }
+        }
+
+        ~RegionCounters(){ delete _counters; }
+
+        void Stop(){
+            if(_counters != NULL)
+                _counters->Stop();
+        }
+
+        const PerfCounters* Get() const { return _counters; }
+
+    private:
+        RegionCounters(const RegionCounters&);
+        RegionCounters& operator=(const RegionCounters&);
+
+        PerfCounters* _counters;
+};
+
+
+
+std::string CoordName(int d){
+
+    std::ostringstream name;
+    name << "x" << d;
+    return name.str();
+}
+
+
+
+void RegisterCoords(PhasespacePointCloud& cloud, int dim){
+
+    // The last coordinate is an angle
+    for(int d=0; d<dim; d++){
+        if(d == dim - 1 && dim > 1)
+            cloud.RegisterPhasespaceCoord(CoordName(d), PhasespacePointCloud::Pi, PhasespacePointCloud::IS_2PI_CIRCULAR);
+        else
+            cloud.RegisterPhasespaceCoord(CoordName(d), 1.);
+    }
+}
+
+
+
+double GenerateMass(){
+
+    // 70% Gaussian signal on a flat background
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::normal_distribution<double> gauss(meanMass, 12.);
+
+    if(uniform(generator) < 0.7){
+        double mass = gauss(generator);
+        if(mass > minMass && mass < maxMass)
+            return mass;
+    }
+
+    return minMass + uniform(generator) * (maxMass - minMass);
+}
+
+
+
+PhasespacePoint GeneratePoint(int dim, bool withMass2){
+
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+    PhasespacePoint point;
+
+    for(int d=0; d<dim; d++){
+        double value = uniform(generator);
+        point.SetCoordinate(CoordName(d), (d == dim - 1 && dim > 1) ? value * PhasespacePointCloud::Pi : value);
+    }
+
+    point.SetMass(GenerateMass());
+    if(withMass2)
+        point.SetMass2(GenerateMass());
+
+    return point;
+}
+
+
+
+double Seconds(std::chrono::steady_clock::time_point start){
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
+void Report(std::vector<BenchmarkRecord>& records, const std::string& name, long n, long k, int dim,
+            int threads, long items, double seconds, const RegionCounters& counters, int thread=-1){
+
+    BenchmarkRecord record = {name, n, k, dim, threads, thread, items, seconds, {}, {}};
+
+    for(short e=0; e<PerfCounters::NUM_EVENTS; e++){
+        record.hasCounts[e] = (counters.Get() != NULL && counters.Get()->IsAvailable(e));
+        record.counts[e] = record.hasCounts[e] ? counters.Get()->GetCount(e) : 0;
+    }
+
+    records.push_back(record);
+
+    std::cout << name << " N=" << n << " k=" << k << " dim=" << dim << " threads=" << threads;
+    if(thread >= 0)
+        std::cout << " thread=" << thread;
+    std::cout << ": " << seconds / items * 1E9 << " ns per item";
+
+    if(record.hasCounts[PerfCounters::CYCLES] && record.hasCounts[PerfCounters::INSTRUCTIONS]
+       && record.counts[PerfCounters::CYCLES] > 0)
+        std::cout << ", IPC " << record.counts[PerfCounters::INSTRUCTIONS] / record.counts[PerfCounters::CYCLES];
+    if(record.hasCounts[PerfCounters::LLC_MISSES])
+        std::cout << ", " << record.counts[PerfCounters::LLC_MISSES] / items << " LLC misses per item";
+    if(record.hasCounts[PerfCounters::BRANCH_MISSES])
+        std::cout << ", " << record.counts[PerfCounters::BRANCH_MISSES] / items << " branch misses per item";
+
+    std::cout << std::endl;
+}
+
+
+
+void BenchDistances(std::vector<BenchmarkRecord>& records, long n, int dim){
+
+    WibGaussFitFunction fitFunction(meanMass, minMass, maxMass, 2, 10, 1, 30);
+    BenchmarkWiBaS wibas(fitFunction);
+    RegisterCoords(wibas, dim);
+
+    for(long i=0; i<n; i++){
+        PhasespacePoint point = GeneratePoint(dim, false);
+        wibas.AddPhasespacePoint(point);
+    }
+
+    PhasespacePoint refPoint = GeneratePoint(dim, false);
+    wibas.ArrangePointCoordinates(refPoint);
+    std::vector<PhasespacePoint*>& points = wibas.GetPoints();
+
+    const int repetitions = 10;
+    double sum = 0;
+    RegionCounters counters;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int r=0; r<repetitions; r++){
+        for(size_t i=0; i<points.size(); i++)
+            sum += wibas.CalcPhasespaceDistance(points[i], &refPoint);
+    }
+
+    double seconds = Seconds(start);
+    counters.Stop();
+    if(sum < 0)
+        std::cout << sum << std::endl;
+
+    Report(records, "CalcPhasespaceDistance", n, 0, dim, 1, repetitions * n, seconds, counters);
+}
+
+
+
+void BenchDistancesThreaded(std::vector<BenchmarkRecord>& records, long n, int dim, int threads){
+
+    WibGaussFitFunction fitFunction(meanMass, minMass, maxMass, 2, 10, 1, 30);
+    BenchmarkWiBaS wibas(fitFunction);
+    RegisterCoords(wibas, dim);
+
+    for(long i=0; i<n; i++){
+        PhasespacePoint point = GeneratePoint(dim, false);
+        wibas.AddPhasespacePoint(point);
+    }
+
+    PhasespacePoint refPoint = GeneratePoint(dim, false);
+    wibas.ArrangePointCoordinates(refPoint);
+    std::vector<PhasespacePoint*>& points = wibas.GetPoints();
+
+    // Every thread scans its own slice, with its own counters
+    const int repetitions = 10;
+    std::vector<double> sums(threads, 0);
+    std::vector<double> seconds(threads, 0);
+    std::vector<RegionCounters*> threadCounters(threads);
+    std::vector<std::thread> workers;
+
+    RegionCounters counters(true);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int t=0; t<threads; t++){
+        workers.push_back(std::thread([&, t](){
+            size_t first = points.size() * t / threads;
+            size_t last = points.size() * (t + 1) / threads;
+            threadCounters[t] = new RegionCounters;
+            std::chrono::steady_clock::time_point threadStart = std::chrono::steady_clock::now();
+
+            // Summed locally, neighboring entries of sums share a cache line
+            double sum = 0;
+            for(int r=0; r<repetitions; r++){
+                for(size_t i=first; i<last; i++)
+                    sum += wibas.CalcPhasespaceDistance(points[i], &refPoint);
+            }
+
+            sums[t] = sum;
+            seconds[t] = Seconds(threadStart);
+            threadCounters[t]->Stop();
+        }));
+    }
+
+    for(int t=0; t<threads; t++)
+        workers[t].join();
+
+    double totalSeconds = Seconds(start);
+    counters.Stop();
+
+    for(int t=0; t<threads; t++){
+        if(sums[t] < 0)
+            std::cout << sums[t] << std::endl;
+
+        long items = repetitions * (n * (t + 1) / threads - n * t / threads);
+        Report(records, "CalcPhasespaceDistance", n, 0, dim, threads, items, seconds[t], *threadCounters[t], t);
+        delete threadCounters[t];
+    }
+
+    Report(records, "CalcPhasespaceDistance", n, 0, dim, threads, repetitions * n, totalSeconds, counters);
+}
+
+
+
+void BenchNeighbors(std::vector<BenchmarkRecord>& records, long n, long k, int dim){
+
+    WibGaussFitFunction fitFunction(meanMass, minMass, maxMass, 2, 10, 1, 30);
+    BenchmarkWiBaS wibas(fitFunction);
+    RegisterCoords(wibas, dim);
+
+    for(long i=0; i<n; i++){
+        PhasespacePoint point = GeneratePoint(dim, false);
+        wibas.AddPhasespacePoint(point);
+    }
+
+    const int numEvents = 10;
+    std::vector<PhasespacePoint> refPoints;
+    for(int e=0; e<numEvents; e++){
+        refPoints.push_back(GeneratePoint(dim, false));
+        wibas.ArrangePointCoordinates(refPoints.back());
+    }
+
+    std::vector<FastPointMap> sorted;
+    RegionCounters counters;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int e=0; e<numEvents; e++)
+        wibas.SelectNeighbors(refPoints[e], k, sorted);
+
+    double seconds = Seconds(start);
+    counters.Stop();
+
+    Report(records, "NeighborSelection", n, k, dim, 1, numEvents, seconds, counters);
+}
+
+
+
+void BenchFit(std::vector<BenchmarkRecord>& records, const std::string& name, WibFitFunction& fitFunction,
+              long k, bool withMass2, int numFits){
+
+    std::vector<std::vector<PhasespacePoint> > samples(numFits);
+    for(int f=0; f<numFits; f++){
+        for(long i=0; i<k; i++)
+            samples[f].push_back(GeneratePoint(1, withMass2));
+    }
+
+    RegionCounters counters;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int f=0; f<numFits; f++){
+        for(long i=0; i<k; i++)
+            fitFunction.AddData(samples[f][i]);
+
+        FitResult* fitResult = fitFunction.DoFit(meanMass, meanMass);
+        delete fitResult;
+    }
+
+    double seconds = Seconds(start);
+    counters.Stop();
+
+    Report(records, name, 0, k, withMass2 ? 2 : 1, 1, numFits, seconds, counters);
+}
+
+
+
+void BenchSimplexFits(std::vector<BenchmarkRecord>& records, long k, int numFits){
+
+    SimplexModelFitter<VoigtShape, PolynomialShape<2> > fitter(VoigtShape(meanMass - minMass, width, 10, 1, 30),
+                                                               PolynomialShape<2>(), maxMass - minMass);
+    std::vector<double> masses(k);
+    std::vector<double> weights(k, 1.);
+
+    for(int f=0; f<numFits; f++){
+        for(long i=0; i<k; i++)
+            masses[i] = GenerateMass() - minMass;
+        fitter.AddEvent(f, k, &masses[0], NULL, &weights[0], meanMass - minMass, 0);
+    }
+
+    std::vector<SimplexModelFitter<VoigtShape, PolynomialShape<2> >::Result> results;
+    RegionCounters counters;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    fitter.Run(results);
+    double seconds = Seconds(start);
+    counters.Stop();
+
+    Report(records, "SimplexModelFitter<Voigt,Pol2>", 0, k, 1, 1, numFits, seconds, counters);
+}
+
+
+
+void FillEnergyTest(EnergyTest& energyTest, long n, int dim){
+
+    RegisterCoords(energyTest, dim);
+
+    for(long i=0; i<n; i++){
+        PhasespacePoint dataPoint = GeneratePoint(dim, false);
+        PhasespacePoint fitPoint = GeneratePoint(dim, false);
+        energyTest.AddPhasespacePointData(dataPoint);
+        energyTest.AddPhasespacePointFit(fitPoint);
+    }
+}
+
+
+
+void BenchPhi(std::vector<BenchmarkRecord>& records, long n, int dim){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_LOG, false);
+    FillEnergyTest(energyTest, n, dim);
+
+    RegionCounters counters;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    energyTest.GetPhi();
+    double seconds = Seconds(start);
+    counters.Stop();
+
+    // One item is one pair of the (2N)^2 / 2 pairs
+    Report(records, "EnergyTest::GetPhi", n, 0, dim, 1, 2 * n * n, seconds, counters);
+}
+
+
+
+void BenchResampling(std::vector<BenchmarkRecord>& records, long n, int dim, int threads, long perThread){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_LOG, false);
+    FillEnergyTest(energyTest, n, dim);
+    energyTest.GetPhi();
+
+    // The resampling threads are started by EnergyTest, the counters
+    // inherit to them and cover all threads together
+    RegionCounters counters(true);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    energyTest.GetResampledPhis(perThread, threads, 1);
+    double seconds = Seconds(start);
+    counters.Stop();
+
+    Report(records, "EnergyTest::GetResampledPhis", n, 0, dim, threads, perThread * threads, seconds, counters);
+}
+
+
+
+void WriteJson(const std::vector<BenchmarkRecord>& records, const std::string& fileName){
+
+    std::ofstream out(fileName.c_str());
+    out << "[" << std::endl;
+
+    for(size_t i=0; i<records.size(); i++){
+        const BenchmarkRecord& r = records[i];
+        out << "  {\"name\": \"" << r.name << "\", \"n\": " << r.n << ", \"k\": " << r.k
+            << ", \"dim\": " << r.dim << ", \"threads\": " << r.threads << ", \"thread\": " << r.thread
+            << ", \"items\": " << r.items << ", \"seconds\": " << r.seconds
+            << ", \"ns_per_item\": " << r.seconds / r.items * 1E9;
+
+        for(short e=0; e<PerfCounters::NUM_EVENTS; e++){
+            out << ", \"" << PerfCounters::GetEventName(e) << "\": ";
+            if(r.hasCounts[e])
+                out << r.counts[e];
+            else
+                out << "null";
+        }
+
+        out << "}" << ((i + 1 < records.size()) ? "," : "") << std::endl;
+    }
+
+    out << "]" << std::endl;
+}
+
+
+
+void WriteCsv(const std::vector<BenchmarkRecord>& records, const std::string& fileName){
+
+    std::ofstream out(fileName.c_str());
+    out << "name,n,k,dim,threads,thread,items,seconds,ns_per_item";
+    for(short e=0; e<PerfCounters::NUM_EVENTS; e++)
+        out << "," << PerfCounters::GetEventName(e);
+    out << std::endl;
+
+    // Unavailable counters are left empty
+    for(size_t i=0; i<records.size(); i++){
+        const BenchmarkRecord& r = records[i];
+        out << "\"" << r.name << "\"," << r.n << "," << r.k << "," << r.dim << "," << r.threads << ","
+            << r.thread << "," << r.items << "," << r.seconds << "," << r.seconds / r.items * 1E9;
+
+        for(short e=0; e<PerfCounters::NUM_EVENTS; e++){
+            out << ",";
+            if(r.hasCounts[e])
+                out << r.counts[e];
+        }
+
+        out << std::endl;
+    }
+}
+
+}
+
+
+
+int main(int argc, char** argv){
+
+    bool quick = false;
+    std::string jsonName = "benchmarkResults.json";
+    std::string csvName = "benchmarkResults.csv";
+
+    for(int i=1; i<argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--quick")
+            quick = true;
+        else if(arg == "--counters")
+            useCounters = true;
+        else if(arg == "--json" && i + 1 < argc)
+            jsonName = argv[++i];
+        else if(arg == "--csv" && i + 1 < argc)
+            csvName = argv[++i];
+    }
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    if(useCounters && !PerfCounters().IsAvailable())
+        std::cout << "WARNING: No hardware counters available (perf_event_open failed, "
+                  << "see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+
+    std::vector<BenchmarkRecord> records;
+    long sizes[] = {10000, 100000, 1000000};
+    int dims[] = {2, 4, 8};
+    long ks[] = {100, 200, 500};
+    int numSizes = quick ? 2 : 3;
+    int numFits = quick ? 5 : 20;
+
+    for(int s=0; s<numSizes; s++){
+        for(int d=0; d<3; d++)
+            BenchDistances(records, sizes[s], dims[d]);
+    }
+
+    int threads[] = {1, 2, 4};
+    for(int t=0; t<3; t++)
+        BenchDistancesThreaded(records, sizes[numSizes - 1], 4, threads[t]);
+
+    for(int s=0; s<numSizes; s++){
+        for(int k=0; k<3; k++)
+            BenchNeighbors(records, sizes[s], ks[k], 3);
+    }
+
+    for(int k=0; k<3; k++){
+        WibGaussFitFunction gauss(meanMass, minMass, maxMass, 2, 10, 1, 30);
+        WibVoigtFitFunction voigt(meanMass, width, minMass, maxMass, 2, 10, 1, 30);
+        WibVoigtFitFunction2D voigt2D(meanMass, width, minMass, maxMass, 2, 10, 1, 30);
+        WibCrystalBallFitFunction crystalBall(meanMass, minMass, maxMass, 2, 10, 1, 30, 1.5, 0.1, 10, 3);
+        WibModelFitFunction<VoigtShape, PolynomialShape<2> > model(VoigtShape(meanMass - minMass, width, 10, 1, 30),
+                                                                   PolynomialShape<2>(), minMass, maxMass);
+
+        BenchFit(records, "WibGaussFitFunction::DoFit", gauss, ks[k], false, numFits);
+        BenchFit(records, "WibVoigtFitFunction::DoFit", voigt, ks[k], false, numFits);
+        BenchFit(records, "WibVoigtFitFunction2D::DoFit", voigt2D, ks[k], true, numFits);
+        BenchFit(records, "WibCrystalBallFitFunction::DoFit", crystalBall, ks[k], false, numFits);
+        BenchFit(records, "WibModelFitFunction<Voigt,Pol2>::DoFit", model, ks[k], false, numFits);
+        BenchSimplexFits(records, ks[k], 4 * numFits);
+    }
+
+    long energySizes[] = {1000, 4000};
+    for(int s=0; s<2; s++){
+        for(int d=0; d<2; d++)
+            BenchPhi(records, energySizes[s], dims[d]);
+    }
+
+    for(int t=0; t<3; t++)
+        BenchResampling(records, 1000, 2, threads[t], quick ? 2 : 4);
+
+    WriteJson(records, jsonName);
+    WriteCsv(records, csvName);
+    std::cout << "Results written to " << jsonName << " and " << csvName << std::endl;
+
+    return 0;
+}
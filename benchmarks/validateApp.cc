@@ -0,0 +1,557 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <functional>
+
+#include "WibasCore.hh"
+#include "EnergyTest.hh"
+#include "PhasespacePoint.hh"
+#include "FastPointMap.hh"
+#include "FitStrategy.hh"
+#include "WibVoigtFitFunction.hh"
+#include "WibModelFitFunction.hh"
+#include "SimplexModelFitter.hh"
+#include "WibTelemetry.hh"
+#include "ColumnarPointFile.hh"
+#include "EventGenerator.hh"
+
+#include "RooMsgService.h"
+
+
+// Accuracy-vs-speed regression harness of the approximate modes. Every
+// mode runs on the same synthetic sample as its reference path (fits with
+// the exact RooVoigtian for the weights, the exact double sum for Phi) and is
+// compared event by event (Q), in the signal yield (sum of Q, also
+// against the true yield of the generator) and in Phi. A mode fails if
+// its deviations exceed the tolerances, the exit code is then 1.
+// Usage: validateApp [--quick] [--csv file] [--yield-tolerance t]
+//                    [--q-tolerance t]
+
+
+struct ValidationRecord
+{
+    std::string mode;
+    std::string reference;
+    long events;
+    long failures;
+    double seconds;
+    double speedup;
+    double meanAbsDeltaQ;   // Weight modes only
+    double maxAbsDeltaQ;
+    double rmsDeltaQ;
+    double yield;
+    double yieldBias;       // Relative to the reference yield
+    double truthBias;       // Relative to the true yield
+    double binningBound;    // Binned modes only, added to the tolerances
+    double phi;             // Phi modes only
+    double phiDeviation;    // Absolute
+    double phiTolerance;
+    bool passed;
+};
+
+
+
+// Exposes the neighbor selection of CalcWeight for the simplex fits
+class ValidationWiBaS : public WiBaS
+{
+    public:
+        ValidationWiBaS(WibFitFunction& fitFunction) : WiBaS(fitFunction) {}
+
+        unsigned int SelectNeighbors(PhasespacePoint& refPoint, unsigned int k, std::vector<FastPointMap>& sorted){
+            ArrangePointCoordinates(refPoint);
+            SortByDistance(refPoint, sorted);
+            return GetCutIndex(sorted, k);
+        }
+};
+
+
+
+namespace {
+
+const double meanMass = 782.65;
+const double width = 8.49;
+const double sigma = 10;
+const double minMass = meanMass - 150;
+const double maxMass = meanMass + 150;
+const unsigned int numDims = 3;
+const double nan = std::numeric_limits<double>::quiet_NaN();
+
+typedef SimplexModelFitter<VoigtShape, PolynomialShape<2> > SimplexFitter;
+
+
+
+double Seconds(std::chrono::steady_clock::time_point start){
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
+void SetupGenerator(EventGenerator& generator, double modulation){
+
+    generator.SetCircular(numDims - 1);
+    generator.SetSignal(EventGenerator::SHAPE_VOIGT, meanMass, sigma, width);
+    generator.SetSignalFraction(0.5, modulation);
+}
+
+
+
+void RegisterCoords(PhasespacePointCloud& cloud){
+
+    EventGenerator generator(numDims, minMass, maxMass);
+    SetupGenerator(generator, 0);
+    generator.RegisterCoords(cloud);
+}
+
+
+
+ValidationRecord MakeRecord(const std::string& mode, const std::string& reference, long events, double seconds){
+
+    ValidationRecord record = {mode, reference, events, 0, seconds, 1., nan, nan, nan, nan, nan, nan, 0, nan, nan, nan, true};
+    return record;
+}
+
+
+
+// The binned fits evaluate the pdf at the bin centres instead of integrating
+// it over the bins. For a peak of width s the relative error of the midpoint
+// rule is about h^2/(24 s^2) at bin width h, which bounds the bias of the
+// fitted signal share. s is taken from the FWHM of the Voigt profile
+// (Olivero's approximation).
+double BinningBiasBound(unsigned int numBins){
+
+    double h = (maxMass - minMass) / numBins;
+    double fwhmGauss = 2. * sqrt(2. * log(2.)) * sigma;
+    double fwhm = 0.5346 * width + sqrt(0.2166 * width * width + fwhmGauss * fwhmGauss);
+    double s = fwhm / (2. * sqrt(2. * log(2.)));
+
+    return h * h / (24. * s * s);
+}
+
+
+
+// Q of the evaluated events, NaN for failed events
+double RunWiBaS(const std::vector<PhasespacePoint>& sample, unsigned long numEvaluated, unsigned int k,
+                WibFitFunction& fitFunction, std::function<void(WiBaS&)> configure, std::vector<double>& q){
+
+    ValidationWiBaS wibas(fitFunction);
+    WibTelemetry telemetry;  // Keeps per-event fit warnings quiet
+    RegisterCoords(wibas);
+    wibas.SetNearestNeighbors(k);
+    wibas.SetCalcErrors(false);
+    wibas.SetTelemetry(&telemetry);
+    configure(wibas);
+
+    for(size_t i=0; i<sample.size(); i++){
+        PhasespacePoint point = sample[i];
+        wibas.AddPhasespacePoint(point);
+    }
+
+    std::vector<PhasespacePoint> events(sample.begin(), sample.begin() + numEvaluated);
+    q.assign(numEvaluated, nan);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(unsigned long i=0; i<numEvaluated; i++){
+        if(wibas.CalcWeight(events[i]))
+            q[i] = events[i].GetWeight();
+    }
+
+    return Seconds(start);
+}
+
+
+
+double RunSimplex(const std::vector<PhasespacePoint>& sample, unsigned long numEvaluated, unsigned int k,
+                  std::vector<double>& q){
+
+    WibModelFitFunction<VoigtShape, PolynomialShape<2> > fitFunction(VoigtShape(meanMass - minMass, width, sigma, 1, 30),
+                                                                     PolynomialShape<2>(), minMass, maxMass);
+    ValidationWiBaS wibas(fitFunction);
+    RegisterCoords(wibas);
+
+    for(size_t i=0; i<sample.size(); i++){
+        PhasespacePoint point = sample[i];
+        wibas.AddPhasespacePoint(point);
+    }
+
+    SimplexFitter fitter(VoigtShape(meanMass - minMass, width, sigma, 1, 30), PolynomialShape<2>(), maxMass - minMass);
+    fitter.SetCalcErrors(false);
+
+    std::vector<FastPointMap> sorted;
+    std::vector<double> masses;
+    std::vector<double> weights;
+    std::vector<SimplexFitter::Result> results;
+    q.assign(numEvaluated, nan);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Same neighbors as CalcWeight, the nearest (the event itself) is skipped
+    for(unsigned long i=0; i<numEvaluated; i++){
+        PhasespacePoint event = sample[i];
+        unsigned int cutIndex = wibas.SelectNeighbors(event, k, sorted);
+        masses.clear();
+        weights.clear();
+
+        for(unsigned int n=1; n<=cutIndex; n++){
+            masses.push_back(sorted[n]._phasespacePoint->GetMass() - minMass);
+            weights.push_back(sorted[n]._phasespacePoint->GetInitialWeight());
+        }
+
+        if(cutIndex > 0)
+            fitter.AddEvent(i, masses.size(), &masses[0], NULL, &weights[0], event.GetMass() - minMass, 0);
+    }
+
+    fitter.Run(results);
+
+    for(size_t r=0; r<results.size(); r++){
+        if(results[r].status == 0)
+            q[results[r].id] = std::min(1., std::max(0., results[r].weight));
+    }
+
+    return Seconds(start);
+}
+
+
+
+void CompareWeights(ValidationRecord& record, const std::vector<double>& q, const std::vector<double>& referenceQ,
+                    double referenceSeconds, double trueYield){
+
+    double sumAbs = 0;
+    double sumSquares = 0;
+    double yield = 0;
+    double comparedYield = 0;
+    double referenceYield = 0;
+    long numCompared = 0;
+    record.maxAbsDeltaQ = 0;
+
+    for(size_t i=0; i<q.size(); i++){
+        if(std::isnan(q[i])){
+            record.failures++;
+            continue;
+        }
+
+        yield += q[i];
+
+        // The bias to the reference only uses events both paths could weight
+        if(std::isnan(referenceQ[i]))
+            continue;
+
+        double delta = q[i] - referenceQ[i];
+        sumAbs += fabs(delta);
+        sumSquares += delta * delta;
+        record.maxAbsDeltaQ = std::max(record.maxAbsDeltaQ, fabs(delta));
+        comparedYield += q[i];
+        referenceYield += referenceQ[i];
+        numCompared++;
+    }
+
+    record.speedup = referenceSeconds / record.seconds;
+    record.meanAbsDeltaQ = (numCompared > 0) ? sumAbs / numCompared : nan;
+    record.rmsDeltaQ = (numCompared > 0) ? sqrt(sumSquares / numCompared) : nan;
+    record.yield = yield;
+    record.yieldBias = (referenceYield > 0) ? comparedYield / referenceYield - 1 : nan;
+    record.truthBias = (trueYield > 0) ? yield / trueYield - 1 : nan;
+}
+
+
+
+void ValidateWeights(std::vector<ValidationRecord>& records, unsigned long numPoints, unsigned long numEvaluated,
+                     unsigned int k, double yieldTolerance, double qTolerance){
+
+    EventGenerator generator(numDims, minMass, maxMass, 4711);
+    SetupGenerator(generator, 0.5);
+
+    std::vector<PhasespacePoint> sample(numPoints);
+    double trueYield = 0;
+
+    for(unsigned long i=0; i<numPoints; i++){
+        generator.Generate(sample[i]);
+        if(i < numEvaluated)
+            trueYield += generator.GetTrueQ(sample[i]);
+    }
+
+    std::vector<double> referenceQ;
+    std::vector<double> q;
+    std::function<void(WiBaS&)> nominal = [](WiBaS&){};
+
+    WibVoigtFitFunction referenceFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30, true);
+    double referenceSeconds = RunWiBaS(sample, numEvaluated, k, referenceFunction, nominal, referenceQ);
+
+    ValidationRecord reference = MakeRecord("RooVoigtian exact", "", numEvaluated, referenceSeconds);
+    CompareWeights(reference, referenceQ, referenceQ, referenceSeconds, trueYield);
+    records.push_back(reference);
+
+    // The tabulated normalization and Weideman profile of WibCachedVoigtian,
+    // all modes below build on it
+    {
+        WibVoigtFitFunction fitFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, nominal, q);
+        records.push_back(MakeRecord("cached Voigt", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    // The reproducible mode, its speedup below 1 is the cost of the
+    // determinism
+    {
+        WibVoigtFitFunction fitFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, [](WiBaS& wibas){
+            wibas.SetReproducible();
+        }, q);
+        records.push_back(MakeRecord("cached Voigt, reproducible", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    // The approximate modes, each with a fresh fit function
+    {
+        WibVoigtFitFunction fitFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, [](WiBaS& wibas){
+            FitStrategy fast;
+            fast.strategy = 0;
+            fast.tolerance = 0.1;
+            wibas.SetFitStrategy(fast);
+        }, q);
+        records.push_back(MakeRecord("cached Voigt, strategy 0", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    unsigned int binnings[] = {100, 30};
+    for(int b=0; b<2; b++){
+        unsigned int numBins = binnings[b];
+        WibVoigtFitFunction fitFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, [numBins](WiBaS& wibas){
+            wibas.SetBinnedFit(numBins);
+        }, q);
+        std::ostringstream mode;
+        mode << "cached Voigt, " << numBins << " bins";
+        records.push_back(MakeRecord(mode.str(), reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+        records.back().binningBound = BinningBiasBound(numBins);
+    }
+
+    {
+        WibVoigtFitFunction fitFunction(meanMass, width, minMass, maxMass, 2, sigma, 1, 30);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, [](WiBaS& wibas){
+            wibas.SetFitCache(true, 0.9);
+        }, q);
+        records.push_back(MakeRecord("cached Voigt, fit cache J>=0.9", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    {
+        WibModelFitFunction<VoigtShape, PolynomialShape<2> > fitFunction(VoigtShape(meanMass - minMass, width, sigma, 1, 30),
+                                                                         PolynomialShape<2>(), minMass, maxMass);
+        double seconds = RunWiBaS(sample, numEvaluated, k, fitFunction, nominal, q);
+        records.push_back(MakeRecord("WibModelFitFunction<Voigt,Pol2>", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    {
+        double seconds = RunSimplex(sample, numEvaluated, k, q);
+        records.push_back(MakeRecord("SimplexModelFitter<Voigt,Pol2>", reference.mode, numEvaluated, seconds));
+        CompareWeights(records.back(), q, referenceQ, referenceSeconds, trueYield);
+    }
+
+    for(size_t r=0; r<records.size(); r++){
+        ValidationRecord& record = records[r];
+        if(record.reference.empty())
+            continue;
+
+        record.passed = fabs(record.yieldBias) <= yieldTolerance + record.binningBound
+                        && record.meanAbsDeltaQ <= qTolerance + record.binningBound
+                        && record.failures <= reference.failures + static_cast<long>(numEvaluated / 100);
+    }
+}
+
+
+
+void FillEnergyTest(EnergyTest& energyTest, unsigned long numPoints, const std::string& fitFileName){
+
+    EventGenerator dataGenerator(numDims, minMass, maxMass, 13);
+    EventGenerator fitGenerator(numDims, minMass, maxMass, 17);
+    SetupGenerator(dataGenerator, 0.5);
+    SetupGenerator(fitGenerator, 0.4);
+    dataGenerator.RegisterCoords(energyTest);
+
+    std::vector<std::string> coordNames = dataGenerator.GetCoordNames();
+    ColumnarPointFile* fitFile = NULL;
+    if(!fitFileName.empty())
+        fitFile = new ColumnarPointFile(fitFileName, coordNames, numPoints);
+
+    PhasespacePoint point;
+
+    for(unsigned long i=0; i<numPoints; i++){
+        dataGenerator.Generate(point);
+        energyTest.AddPhasespacePointData(point);
+
+        fitGenerator.Generate(point);
+        if(fitFile != NULL)
+            fitFile->SetPoint(i, point);
+        else
+            energyTest.AddPhasespacePointFit(point);
+    }
+
+    delete fitFile;
+}
+
+
+
+void ValidatePhi(std::vector<ValidationRecord>& records, unsigned long numPoints){
+
+    EnergyTest reference(EnergyTest::DISTANCE_LOG, false);
+    FillEnergyTest(reference, numPoints, "");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double phi = reference.GetPhi();
+    double referenceSeconds = Seconds(start);
+
+    ValidationRecord referenceRecord = MakeRecord("EnergyTest exact", "", numPoints, referenceSeconds);
+    referenceRecord.phi = phi;
+    referenceRecord.phiDeviation = 0;
+    records.push_back(referenceRecord);
+
+    // Tree summation, within its own error bound
+    {
+        EnergyTest energyTest(EnergyTest::DISTANCE_LOG, false);
+        FillEnergyTest(energyTest, numPoints, "");
+        energyTest.SetSummationMode(EnergyTest::SUMMATION_TREE, 1E-2);
+
+        start = std::chrono::steady_clock::now();
+        double treePhi = energyTest.GetPhi();
+        ValidationRecord record = MakeRecord("EnergyTest tree summation", referenceRecord.mode, numPoints, Seconds(start));
+        record.phi = treePhi;
+        record.phiDeviation = fabs(treePhi - phi);
+        record.phiTolerance = energyTest.GetPhiErrorBound() + 1E-9 * fabs(phi);
+        records.push_back(record);
+    }
+
+    // Streamed fit sample in tiles of about 256 points, exact up to the
+    // summation order
+    {
+        std::string fileName = "validateFitSample.col";
+        EnergyTest energyTest(EnergyTest::DISTANCE_LOG, false);
+        FillEnergyTest(energyTest, numPoints, fileName);
+
+        start = std::chrono::steady_clock::now();
+        double streamedPhi = energyTest.GetPhiStreamed(fileName, (numPoints + 2 * 256) * numDims * sizeof(double));
+        ValidationRecord record = MakeRecord("EnergyTest streamed", referenceRecord.mode, numPoints, Seconds(start));
+        record.phi = streamedPhi;
+        record.phiDeviation = fabs(streamedPhi - phi);
+        record.phiTolerance = 1E-6 * fabs(phi);
+        records.push_back(record);
+        std::remove(fileName.c_str());
+    }
+
+    for(size_t r=0; r<records.size(); r++){
+        ValidationRecord& record = records[r];
+        if(record.reference == referenceRecord.mode){
+            record.speedup = referenceSeconds / record.seconds;
+            record.passed = record.phiDeviation <= record.phiTolerance;
+        }
+    }
+}
+
+
+
+void Print(const std::vector<ValidationRecord>& records){
+
+    for(size_t r=0; r<records.size(); r++){
+        const ValidationRecord& record = records[r];
+
+        std::cout << std::setw(34) << std::left << record.mode << std::right
+                  << (record.reference.empty() ? "  REF " : (record.passed ? "  ok  " : "  FAIL"))
+                  << "  " << std::setw(8) << std::setprecision(3) << record.seconds << " s"
+                  << "  x" << std::setw(6) << std::setprecision(3) << record.speedup;
+
+        if(!std::isnan(record.phi)){
+            std::cout << "  phi=" << std::setprecision(8) << record.phi
+                      << "  |dphi|=" << std::setprecision(3) << record.phiDeviation;
+            if(!record.reference.empty())
+                std::cout << " (tolerance " << record.phiTolerance << ")";
+        }
+        else{
+            std::cout << "  failed=" << record.failures
+                      << "  <|dQ|>=" << std::setprecision(3) << record.meanAbsDeltaQ
+                      << "  max|dQ|=" << record.maxAbsDeltaQ
+                      << "  yield=" << std::setprecision(5) << record.yield
+                      << "  bias=" << std::setprecision(3) << 100 * record.yieldBias << "%"
+                      << "  vs truth=" << 100 * record.truthBias << "%";
+            if(record.binningBound > 0)
+                std::cout << " (binning bound " << 100 * record.binningBound << "%)";
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+
+
+void WriteCsv(const std::vector<ValidationRecord>& records, const std::string& fileName){
+
+    std::ofstream out(fileName.c_str());
+    out << "mode,reference,events,failures,seconds,speedup,mean_abs_dq,max_abs_dq,rms_dq,yield,"
+        << "yield_bias,truth_bias,binning_bound,phi,phi_deviation,phi_tolerance,passed" << std::endl;
+    out << std::setprecision(10);
+
+    for(size_t r=0; r<records.size(); r++){
+        const ValidationRecord& record = records[r];
+        out << "\"" << record.mode << "\",\"" << record.reference << "\"," << record.events << ","
+            << record.failures << "," << record.seconds << "," << record.speedup << ","
+            << record.meanAbsDeltaQ << "," << record.maxAbsDeltaQ << "," << record.rmsDeltaQ << ","
+            << record.yield << "," << record.yieldBias << "," << record.truthBias << "," << record.binningBound << ","
+            << record.phi << "," << record.phiDeviation << "," << record.phiTolerance << ","
+            << (record.passed ? 1 : 0) << std::endl;
+    }
+}
+
+}
+
+
+
+int main(int argc, char** argv){
+
+    bool quick = false;
+    std::string csvName = "validationResults.csv";
+    double yieldTolerance = 0.02;
+    double qTolerance = 0.05;
+
+    for(int i=1; i<argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--quick")
+            quick = true;
+        else if(arg == "--csv" && i + 1 < argc)
+            csvName = argv[++i];
+        else if(arg == "--yield-tolerance" && i + 1 < argc)
+            yieldTolerance = atof(argv[++i]);
+        else if(arg == "--q-tolerance" && i + 1 < argc)
+            qTolerance = atof(argv[++i]);
+    }
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    std::vector<ValidationRecord> records;
+    ValidateWeights(records, quick ? 20000 : 100000, quick ? 100 : 500, 200, yieldTolerance, qTolerance);
+    ValidatePhi(records, quick ? 2000 : 8000);
+
+    Print(records);
+    WriteCsv(records, csvName);
+    std::cout << "Results written to " << csvName << std::endl;
+
+    for(size_t r=0; r<records.size(); r++){
+        if(!records[r].passed){
+            std::cout << "ERROR: " << records[r].mode << " exceeds its tolerance against " << records[r].reference << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
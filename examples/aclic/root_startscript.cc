@@ -3,7 +3,15 @@
    gROOT->ProcessLine(".L ../../src/FastPointMap.cc+");
    gROOT->ProcessLine(".L ../../src/PhasespaceCoord.cc+");
    gROOT->ProcessLine(".L ../../src/PhasespacePoint.cc+");
+   gROOT->ProcessLine(".L ../../src/MemoryUsage.cc+");
    gROOT->ProcessLine(".L ../../src/PhasespacePointCloud.cc+");
+   gROOT->ProcessLine(".L ../../src/NormalizationCache.cc+");
+   gROOT->ProcessLine(".L ../../src/VoigtProfile.cc+");
+   gROOT->ProcessLine(".L ../../src/WibCachedVoigtian.cc+");
+   gROOT->ProcessLine(".L ../../src/WibTrace.cc+");
+   gROOT->ProcessLine(".L ../../src/WibProfile.cc+");
+   gROOT->ProcessLine(".L ../../src/WibTelemetry.cc+");
+   gROOT->ProcessLine(".L ../../src/WibProgress.cc+");
    gROOT->ProcessLine(".L ../../src/WibFitFunction.cc+");
    gROOT->ProcessLine(".L ../../src/WibVoigtFitFunction.cc+");
    gROOT->ProcessLine(".L ../../src/WibasCore.cc+");
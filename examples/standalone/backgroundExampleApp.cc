@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <climits>
 #include <sstream>
+#include <vector>
 
 #include "TFile.h"
 #include "TTree.h"
@@ -47,6 +48,10 @@
 
 #include "WibasCore.hh"
 #include "WibVoigtFitFunction.hh"
+#include "WibProfile.hh"
+#include "WibTelemetry.hh"
+#include "WibProgress.hh"
+#include "WibTrace.hh"
 
 int main(int argc, char *argv[])
 {
@@ -111,6 +116,24 @@ int main(int argc, char *argv[])
     wibasObj.SetCalcErrors(calcErrors);
 
 
+    // The fit cache (SetFitCache) is left off: the events weighted here
+    // are points of the cloud, their neighbor sets exclude themselves and
+    // are therefore never identical.
+
+
+    // Failed fits are repeated with other start values, a flat background
+    // and more neighbors before the event is given up
+    wibasObj.SetFitFallback(true);
+
+
+    // Status, covariance quality, EDM and timing of every fit go to a CSV
+    // file instead of per-event warnings, a summary is printed at the end
+    WibTelemetry telemetry;
+    telemetry.OpenSink("fitTelemetry.csv");
+    telemetry.Start();
+    wibasObj.SetTelemetry(&telemetry);
+
+
     // Now do some root stuff to load the example data.
     TFile exampleFile("../examples/backgroundExampleData.root", "read");
     if(!exampleFile.IsOpen()){
@@ -140,9 +163,14 @@ int main(int argc, char *argv[])
     }
 
 
-    // Now we need to fill the WiBaS database with ALL available data
+    // Now we need to fill the WiBaS database with ALL available data. The
+    // added points of the requested range are kept for the weighting, they
+    // know their place in the cloud for the neighbor averages of the fit
+    // fallback.
     int numTotalEntries = dataTree->GetEntries();
     int numEntriesInRange = (lastEvent - firstEvent + 1);
+    std::vector<PhasespacePoint> eventsInRange;
+
     for(int i = 1; i <= numTotalEntries; i++){
         dataTree->GetEntry(i-1);
 
@@ -156,8 +184,13 @@ int main(int argc, char *argv[])
 
         // Add it to the WiBaS object
         wibasObj.AddPhasespacePoint(newPoint);
+
+        if(i >= firstEvent && i <= lastEvent)
+            eventsInRange.push_back(newPoint);
     }
 
+    wibasObj.GetMemoryUsage().Print(std::cout, "WiBaS");
+
 
     // In the second run we calculate the weights of all events in the requested
     // range and fill some histograms.
@@ -166,41 +199,44 @@ int main(int argc, char *argv[])
     TH1F* sum = new TH1F("sum", "sum", 100, omegaMass - range, omegaMass + range);
     TH1F* errors = new TH1F("errors", "errors", 100, 0, 1);
 
-    for(int i = firstEvent; i <= lastEvent; i++){
 
-        dataTree->GetEntry(i-1);
+    // Save one example fit
+    wibasObj.SaveNextFitToFile("exampleFit.png");
 
-        PhasespacePoint newPoint;
-        newPoint.SetCoordinate("prodTheta", prodTheta);
-        newPoint.SetCoordinate("decTheta", decTheta);
-        newPoint.SetCoordinate("decPhi",   decPhi);
-        newPoint.SetMass(mass);
 
-        // Save one example fit
-        if(i == 10){
-            wibasObj.SaveNextFitToFile("exampleFit.png");
-        }
+    // Finally: Get the event weights. Events/s, fit latency, failures and
+    // the ETA are printed and written to wibasProgress.json every 10 s.
+    // With -DWIBAS_TRACE the stage timeline goes to wibasTrace.json.
+    WibProgress progress(numEntriesInRange);
+    WibTrace::Start();
+    progress.Start("wibasProgress.json", 10., true);
+    wibasObj.CalcWeights(eventsInRange, &progress);
+    progress.Stop();
 
 
-        // Finally: Get the event weight
-        wibasObj.CalcWeight(newPoint);
-        double Q = newPoint.GetWeight();
-        double QErr = newPoint.GetWeightError();
+    // Fill histograms
+    for(size_t i = 0; i < eventsInRange.size(); i++){
+        double Q = eventsInRange[i].GetWeight();
+        double QErr = eventsInRange[i].GetWeightError();
 
+        signal->Fill(eventsInRange[i].GetMass(), Q);
+        background->Fill(eventsInRange[i].GetMass(), 1-Q);
+        sum->Fill(eventsInRange[i].GetMass());
+        errors->Fill(QErr);
+    }
 
-        // Status update
-        int processedEvents = i-firstEvent+1;
-        if(processedEvents % 100 == 0)
-            std::cout << "Event " << processedEvents << " / " << numEntriesInRange << " ("
-                      << (float)processedEvents/(float)numEntriesInRange * 100.0 << "%)" << std::endl;
+    wibasObj.PrintFitCacheStats();
+    wibasObj.PrintFitFallbackStats();
 
+    telemetry.Stop();
+    telemetry.PrintSummary();
 
-        // Fill histograms
-        signal->Fill(newPoint.GetMass(), Q);
-        background->Fill(newPoint.GetMass(), 1-Q);
-        sum->Fill(newPoint.GetMass());
-        errors->Fill(QErr);
-    }
+    WibTrace::Stop();
+    if(WibTrace::IsEnabled())
+        WibTrace::WriteChromeTrace("wibasTrace.json");
+
+    if(WibProfile::IsEnabled())
+        WibProfile::PrintSummary();
 
 
     // Save result histogram
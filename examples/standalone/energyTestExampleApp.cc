@@ -140,5 +140,15 @@ int main(){
     std::cout << "p-value bad fit = " << pValue1 << std::endl;
     std::cout << "p-value good fit = " << pValue2 << std::endl;
 
+    // Instead of a fixed number of resamplings, GetPValue resamples in
+    // batches until the confidence interval of the p-value is clearly
+    // below or above the given threshold (here 5%), or until the maximum
+    // number of resamplings is reached. The confidence level holds for all
+    // batches together, the last batch may go beyond the maximum.
+    PValueResult pValueResult = energyTest1.GetPValue(0.05, 1000, nThreads);
+    std::cout << "p-value bad fit = " << pValueResult.pValue << " ["
+              << pValueResult.lowerLimit << ", " << pValueResult.upperLimit << "] after "
+              << pValueResult.numResamples << " resamplings" << std::endl;
+
     return 0;
 }
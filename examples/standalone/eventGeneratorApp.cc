@@ -0,0 +1,183 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "EventGenerator.hh"
+
+
+
+void PrintUsage(){
+
+    std::cout << "Usage: eventGeneratorApp [options] outputFile\n"
+              << "  --events N          number of events (default 1000000)\n"
+              << "  --dims D            phasespace dimension (default 3)\n"
+              << "  --circular C        last C coordinates are angles (default 1)\n"
+              << "  --seed S            random seed (default 1)\n"
+              << "  --range MIN,MAX     mass range (default 632.65,932.65)\n"
+              << "  --signal SHAPE      gauss, voigt or cb (default voigt)\n"
+              << "  --mean M --sigma S --width G --alpha A --n N   signal parameters\n"
+              << "  --background A1,A2,...   polynomial background coefficients\n"
+              << "  --fraction F        signal fraction (default 0.5)\n"
+              << "  --modulation M      variation of the signal fraction along x0 (default 0.5)\n"
+              << "  --weights MIN,MAX   uniform initial weights (default 1,1)\n"
+              << "  --mass2             generate a second mass\n";
+}
+
+
+
+std::vector<double> ParseList(const std::string& list){
+
+    std::vector<double> values;
+    std::stringstream stream(list);
+    std::string item;
+
+    while(std::getline(stream, item, ','))
+        values.push_back(atof(item.c_str()));
+
+    return values;
+}
+
+
+
+int main(int argc, char** argv){
+
+    unsigned long numEvents = 1000000;
+    unsigned int numDims = 3;
+    unsigned int numCircular = 1;
+    unsigned long seed = 1;
+    double minMass = 632.65;
+    double maxMass = 932.65;
+    short shape = EventGenerator::SHAPE_VOIGT;
+    double mean = 782.65;
+    double sigma = 10;
+    double width = 8.49;
+    double alpha = 1.5;
+    double n = 3;
+    std::vector<double> background;
+    double fraction = 0.5;
+    double modulation = 0.5;
+    double minWeight = 1;
+    double maxWeight = 1;
+    bool twoMasses = false;
+    std::string fileName;
+
+    for(int i=1; i<argc; i++){
+        std::string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+
+        if(arg == "--mass2")
+            twoMasses = true;
+        else if(arg.compare(0, 2, "--") != 0)
+            fileName = arg;
+        else if(!hasValue){
+            PrintUsage();
+            return 1;
+        }
+        else{
+            std::string value(argv[++i]);
+
+            if(arg == "--events") numEvents = strtoul(value.c_str(), NULL, 10);
+            else if(arg == "--dims") numDims = atoi(value.c_str());
+            else if(arg == "--circular") numCircular = atoi(value.c_str());
+            else if(arg == "--seed") seed = strtoul(value.c_str(), NULL, 10);
+            else if(arg == "--mean") mean = atof(value.c_str());
+            else if(arg == "--sigma") sigma = atof(value.c_str());
+            else if(arg == "--width") width = atof(value.c_str());
+            else if(arg == "--alpha") alpha = atof(value.c_str());
+            else if(arg == "--n") n = atof(value.c_str());
+            else if(arg == "--background") background = ParseList(value);
+            else if(arg == "--fraction") fraction = atof(value.c_str());
+            else if(arg == "--modulation") modulation = atof(value.c_str());
+            else if(arg == "--range" || arg == "--weights"){
+                std::vector<double> limits = ParseList(value);
+                if(limits.size() != 2){
+                    PrintUsage();
+                    return 1;
+                }
+                (arg == "--range" ? minMass : minWeight) = limits[0];
+                (arg == "--range" ? maxMass : maxWeight) = limits[1];
+            }
+            else if(arg == "--signal"){
+                if(value == "gauss") shape = EventGenerator::SHAPE_GAUSS;
+                else if(value == "voigt") shape = EventGenerator::SHAPE_VOIGT;
+                else if(value == "cb") shape = EventGenerator::SHAPE_CRYSTALBALL;
+                else{
+                    PrintUsage();
+                    return 1;
+                }
+            }
+            else{
+                PrintUsage();
+                return 1;
+            }
+        }
+    }
+
+    if(fileName.empty() || numDims == 0 || numCircular > numDims){
+        PrintUsage();
+        return 1;
+    }
+
+    EventGenerator generator(numDims, minMass, maxMass, seed);
+    generator.SetSignal(shape, mean, sigma, width, alpha, n);
+    generator.SetBackground(background);
+    generator.SetSignalFraction(fraction, modulation);
+    generator.SetInitialWeights(minWeight, maxWeight);
+    generator.SetTwoMasses(twoMasses);
+
+    for(unsigned int i=numDims-numCircular; i<numDims; i++)
+        generator.SetCircular(i);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if(!generator.WriteColumnarFile(fileName, numEvents)){
+        std::cout << "ERROR: could not write " << fileName << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "INFO: wrote " << numEvents << " events to " << fileName << " in " << seconds << " s" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef COLUMNARPOINTFILE_HH
+#define COLUMNARPOINTFILE_HH
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class PhasespacePoint;
+
+// Memory-mapped columnar storage of phasespace points for samples that do
+// not fit into memory. The file consists of a header with the coordinate
+// names followed by one contiguous column of doubles per coordinate and
+// the columns of initial weights, masses and second masses (NaN if unset).
+// A file is either opened for reading, or created with a fixed number of
+// points and filled via SetPoint.
+class ColumnarPointFile
+{
+    public:
+        ColumnarPointFile(const std::string& fileName);
+        ColumnarPointFile(const std::string& fileName, const std::vector<std::string>& coordNames,
+                          unsigned long numPoints);
+        ~ColumnarPointFile();
+
+        bool IsOpen() const { return _data != NULL; }
+        unsigned long GetNumPoints() const { return _numPoints; }
+        unsigned int GetNumCoords() const { return _coordNames.size(); }
+        const std::vector<std::string>& GetCoordNames() const { return _coordNames; }
+        int GetCoordIndex(const std::string& name) const;
+
+        const double* GetCoordColumn(unsigned int index) const { return GetColumn(index); }
+        const double* GetWeightColumn() const { return GetColumn(_coordNames.size()); }
+        const double* GetMassColumn() const { return GetColumn(_coordNames.size() + 1); }
+        const double* GetMass2Column() const { return GetColumn(_coordNames.size() + 2); }
+
+        void SetPoint(unsigned long index, const PhasespacePoint& point);
+        void Prefetch(unsigned long first, unsigned long num) const;
+        void Release(unsigned long first, unsigned long num) const;
+
+        static const unsigned int NUM_EXTRA_COLUMNS;
+
+    private:
+        std::string _fileName;
+        std::vector<std::string> _coordNames;
+        unsigned long _numPoints;
+        size_t _headerSize;
+        size_t _fileSize;
+        char* _data;
+        bool _writable;
+
+        double* GetColumn(unsigned int column) const;
+        void Map(int fd, bool writable);
+        void Advise(unsigned long first, unsigned long num, int advice) const;
+
+        ColumnarPointFile(const ColumnarPointFile&);
+        ColumnarPointFile& operator=(const ColumnarPointFile&);
+};
+
+
+#endif // COLUMNARPOINTFILE_HH
@@ -0,0 +1,205 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef ENERGYKERNELS_HH
+#define ENERGYKERNELS_HH
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "FastMath.hh"
+#include "PointColumns.hh"
+
+// Batched evaluation of the energy test distance functions. The kernels
+// transform an array of squared distances in place, the pair sums are
+// templated on the kernel, so that the choice of the distance function is
+// made once outside of the pair loops and all inner loops vectorize.
+class EnergyLogKernel
+{
+    public:
+        EnergyLogKernel(double epsilon) : _epsilon(epsilon) {}
+
+        void operator() (double* values, unsigned int n) const {
+            for(unsigned int i=0; i<n; i++){
+                values[i] = -FastMath::Log(sqrt(values[i]) + _epsilon);
+            }
+        }
+
+    private:
+        double _epsilon;
+};
+
+
+
+class EnergyGaussKernel
+{
+    public:
+        EnergyGaussKernel(double gauss2sigsq) : _scale(-1. / gauss2sigsq) {}
+
+        void operator() (double* values, unsigned int n) const {
+            for(unsigned int i=0; i<n; i++){
+                values[i] = FastMath::Exp(values[i] * _scale);
+            }
+        }
+
+    private:
+        double _scale;
+};
+
+
+
+class EnergyPairSums
+{
+    public:
+        static const unsigned int TILE_SIZE = 256;
+
+        static void SquaredDistances(const PointColumns& columns, unsigned int first, unsigned int num,
+                                     const double* point, const std::vector<bool>& isCircular, double* out);
+
+        template<class Kernel>
+        static double Sum(const PointColumns& a, const PointColumns& b, const std::vector<bool>& isCircular,
+                          bool sameBlock, const Kernel& kernel);
+
+        template<class Kernel>
+        static void Row(const PointColumns& columns, unsigned int index, const std::vector<bool>& isCircular,
+                        const Kernel& kernel, double* out);
+};
+
+
+
+inline void EnergyPairSums::SquaredDistances(const PointColumns& columns, unsigned int first, unsigned int num,
+                                             const double* point, const std::vector<bool>& isCircular, double* out){
+
+    for(unsigned int j=0; j<num; j++){
+        out[j] = 0;
+    }
+
+    // Circular coordinates have a period of 2 in units of the norm,
+    // see PhasespacePointCloud::CalcPhasespaceDistance
+    for(unsigned int d=0; d<columns.GetNumDims(); d++){
+        const double* column = columns.GetColumn(d) + first;
+        double x = point[d];
+
+        if(isCircular[d]){
+            for(unsigned int j=0; j<num; j++){
+                double diff = fabs(column[j] - x);
+                double wrapped = fabs(2. - diff);
+                diff = (wrapped < diff) ? wrapped : diff;
+                out[j] += diff * diff;
+            }
+        }
+        else{
+            for(unsigned int j=0; j<num; j++){
+                double diff = column[j] - x;
+                out[j] += diff * diff;
+            }
+        }
+    }
+}
+
+
+
+// Weighted kernel sum over all pairs of two point blocks, or over the
+// pairs i<j if both blocks are the same. The second block is processed in
+// tiles, so that its columns stay in the cache during the loop over the first.
+template<class Kernel>
+double EnergyPairSums::Sum(const PointColumns& a, const PointColumns& b, const std::vector<bool>& isCircular,
+                           bool sameBlock, const Kernel& kernel){
+
+    unsigned int numDims = a.GetNumDims();
+    std::vector<double> point(numDims);
+    double values[TILE_SIZE];
+    const double* weightsA = a.GetWeights();
+    const double* weightsB = b.GetWeights();
+    double sum = 0;
+
+    for(unsigned int tileBegin=0; tileBegin<b.GetNumPoints(); tileBegin+=TILE_SIZE){
+
+        unsigned int tileEnd = std::min(tileBegin + static_cast<unsigned int>(TILE_SIZE), b.GetNumPoints());
+        unsigned int numA = sameBlock ? std::min(tileEnd, a.GetNumPoints()) : a.GetNumPoints();
+
+        for(unsigned int i=0; i<numA; i++){
+
+            unsigned int first = sameBlock ? std::max(tileBegin, i + 1) : tileBegin;
+            if(first >= tileEnd)
+                continue;
+
+            unsigned int num = tileEnd - first;
+            for(unsigned int d=0; d<numDims; d++){
+                point[d] = a.GetColumn(d)[i];
+            }
+
+            SquaredDistances(b, first, num, &point[0], isCircular, values);
+            kernel(values, num);
+
+            double rowSum = 0;
+            for(unsigned int j=0; j<num; j++){
+                rowSum += weightsB[first + j] * values[j];
+            }
+
+            sum += weightsA[i] * rowSum;
+        }
+    }
+
+    return sum;
+}
+
+
+
+// Kernel values of one point with all points of the block. The entry of
+// the point itself is set to 0.
+template<class Kernel>
+void EnergyPairSums::Row(const PointColumns& columns, unsigned int index, const std::vector<bool>& isCircular,
+                         const Kernel& kernel, double* out){
+
+    std::vector<double> point(columns.GetNumDims());
+    for(unsigned int d=0; d<columns.GetNumDims(); d++){
+        point[d] = columns.GetColumn(d)[index];
+    }
+
+    for(unsigned int first=0; first<columns.GetNumPoints(); first+=TILE_SIZE){
+        unsigned int num = std::min(static_cast<unsigned int>(TILE_SIZE), columns.GetNumPoints() - first);
+        SquaredDistances(columns, first, num, &point[0], isCircular, out + first);
+        kernel(out + first, num);
+    }
+
+    out[index] = 0;
+}
+
+
+#endif // ENERGYKERNELS_HH
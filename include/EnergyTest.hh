@@ -42,35 +42,66 @@
 
 #include "PhasespacePointCloud.hh"
 #include "PhasespaceCoord.hh"
+#include "PValueResult.hh"
 
 class PhasespacePoint;
+class ColumnarPointFile;
 
 class EnergyTest : public PhasespacePointCloud
 {
+    friend class EnergyTestState;
+
     private:
         bool _initialized;
         double _epsilon;
         double _gauss2sigsq;
         short _distanceFunc;
+        short _summationMode;
+        double _treeTolerance;
+        double _phiErrorBound;
+        bool _reproducible;
         std::ofstream _log;
 
         void Initialize();
+        bool InitializeStreamed(const ColumnarPointFile& fitFile, const std::vector<int>& fitColumns,
+                                double& scaleFitWeights);
+        void GetNormalization(std::vector<double>& norms, std::vector<bool>& isCircular);
+        double GetPhiTree(const std::vector<PhasespacePoint*>& phasespacePointVectorData,
+                          const std::vector<PhasespacePoint*>& phasespacePointVectorFit,
+                          double& errorBound);
+        static size_t GetWorkspaceBytes(unsigned long numData, unsigned long numFit, unsigned int numCoords,
+                                        short threads, short summationMode, size_t pointBytes);
 
     public:
         EnergyTest(short distFunc, bool writelog=true);
         void SetGauss2SigSq(double val){ _gauss2sigsq = val; }
+        void SetSummationMode(short mode, double relTolerance=1E-2);
+        void SetReproducible(bool set=true){ _reproducible = set; }
+        double GetPhiErrorBound() const { return _phiErrorBound; }
         double GetPhi();
         double GetPhi(const std::vector<PhasespacePoint*>& phasespacePointVectorData,
                       const std::vector<PhasespacePoint*>& phasespacePointVectorFit);
+        double GetPhiStreamed(const std::string& fitFileName, size_t memoryBudget=268435456);
         std::vector<double> GetResampledPhis(long n, short threads=1, unsigned int seed=0);
-        void Threadfunc(long n, std::vector<double>& phis);
+        PValueResult GetPValue(double threshold, long maxResamples, short threads=1, long batchSize=50,
+                               double confidenceLevel=0.99, unsigned int seed=0);
+        std::vector<double> GetSwapChainPhis(long n, unsigned int swapsPerStep=1, long burnIn=0,
+                                             unsigned int seed=0);
+        void Threadfunc(long n, std::vector<double>& phis, long firstResample=-1, unsigned int seed=0);
         double Rlog(double distance);
         double RGauss(double distance);
         void AddPhasespacePointData(PhasespacePoint& newPhasespacePoint);
         void AddPhasespacePointFit(PhasespacePoint& newPhasespacePoint);
+        virtual MemoryUsage GetMemoryUsage() const;
+        MemoryUsage GetResamplingMemoryUsage(short threads) const;
+        static MemoryUsage EstimateMemoryUsage(unsigned long numData, unsigned long numFit, unsigned int numCoords,
+                                               short threads=1, short summationMode=SUMMATION_EXACT,
+                                               unsigned int meanNameLength=2);
 
         static const short DISTANCE_LOG;
         static const short DISTANCE_GAUSS;
+        static const short SUMMATION_EXACT;
+        static const short SUMMATION_TREE;
 };
 
 
@@ -0,0 +1,88 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef ENERGYTESTSTATE_HH
+#define ENERGYTESTSTATE_HH
+
+#include <vector>
+
+#include "PointColumns.hh"
+
+class EnergyTest;
+class PhasespacePoint;
+
+// Incremental energy test statistic for moving points between the data and
+// the fit subset. The data and fit points of an EnergyTest object are pooled
+// and for each point the kernel row sums over the current data and fit
+// members are kept, so that Phi is available in O(1) and a label change
+// costs O(N) kernel evaluations instead of the O(N^2) of a full GetPhi.
+class EnergyTestState
+{
+    public:
+        EnergyTestState(EnergyTest& energyTest);
+
+        double GetPhi() const;
+        void MoveToData(unsigned int index);
+        void MoveToFit(unsigned int index);
+        void Swap(unsigned int dataIndex, unsigned int fitIndex);
+        void Recalculate();
+
+        bool IsData(unsigned int index) const { return _isData.at(index); }
+        unsigned int GetNumPoints() const { return _points.size(); }
+        unsigned int GetNumData() const { return _numData; }
+
+    private:
+        EnergyTest* _energyTest;
+        std::vector<PhasespacePoint*> _points;
+        PointColumns _columns;
+        std::vector<bool> _isCircular;
+        std::vector<double> _kernelRow;
+        std::vector<bool> _isData;
+        std::vector<double> _rowData;
+        std::vector<double> _rowFit;
+        unsigned int _numData;
+        double _sumRData;
+        double _sumRDataFit;
+        double _sumOfWeightsData;
+        double _sumOfWeightsFit;
+
+        void UpdateRows(unsigned int index, double sign);
+        void CalcKernelRow(unsigned int index);
+};
+
+
+#endif // ENERGYTESTSTATE_HH
@@ -0,0 +1,158 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef EVENTGENERATOR_HH
+#define EVENTGENERATOR_HH
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include "PhasespacePoint.hh"
+#include "PhasespacePointCloud.hh"
+
+// Seedable generator of synthetic samples for scaling tests. Events are
+// uniform in numDims phasespace coordinates "x0", "x1", ... ([-1, 1], or
+// [-Pi, Pi) for circular ones) with a signal peak on a polynomial
+// background in the mass. The signal fraction may vary along x0, so the
+// true Q of an event is known (GetTrueQ) and depends on its position.
+class EventGenerator
+{
+    public:
+        static const short SHAPE_GAUSS = 0;
+        static const short SHAPE_VOIGT = 1;
+        static const short SHAPE_CRYSTALBALL = 2;
+
+        EventGenerator(unsigned int numDims, double minMass, double maxMass, unsigned long seed=1);
+
+        void SetSeed(unsigned long seed);
+        void SetCircular(unsigned int dim, bool circular=true);
+        void SetSignal(short shape, double mean, double sigma, double width=0, double alpha=1.5, double n=3);
+        void SetBackground(const std::vector<double>& coefs);
+        void SetSignalFraction(double fraction, double modulation=0);
+        void SetInitialWeights(double minWeight, double maxWeight);
+        void SetTwoMasses(bool set);
+
+        unsigned int GetNumDims() const { return _numDims; }
+        const std::vector<std::string>& GetCoordNames() const { return _coordNames; }
+        bool IsCircular(unsigned int dim) const { return _circular.at(dim); }
+
+        // Registers the coordinates at a WiBaS, EnergyTest or other cloud
+        template<class Cloud> void RegisterCoords(Cloud& cloud) const;
+
+        // Returns true for a signal event
+        bool Generate(PhasespacePoint& point);
+        double GetTrueQ(const PhasespacePoint& point) const;
+
+        // Adds numEvents events via cloud.AddPhasespacePoint, returns the number of signal events
+        template<class Cloud> unsigned long Fill(Cloud& cloud, unsigned long numEvents);
+        bool WriteColumnarFile(const std::string& fileName, unsigned long numEvents);
+
+        static const unsigned int NUM_TABLE_BINS;
+
+    private:
+        unsigned int _numDims;
+        double _minMass;
+        double _maxMass;
+        std::vector<std::string> _coordNames;
+        std::vector<bool> _circular;
+
+        short _shape;
+        double _mean;
+        double _sigma;
+        double _width;
+        double _alpha;
+        double _n;
+        std::vector<double> _backgroundCoefs;
+        double _fraction;
+        double _modulation;
+        double _minWeight;
+        double _maxWeight;
+        bool _twoMasses;
+
+        // Cumulative distributions at the NUM_TABLE_BINS+1 bin edges of
+        // [minMass, maxMass] and the integrals of the densities
+        std::vector<double> _signalTable;
+        std::vector<double> _backgroundTable;
+        double _signalNorm;
+        double _backgroundNorm;
+
+        std::mt19937_64 _engine;
+        std::uniform_real_distribution<double> _uniform;
+        std::normal_distribution<double> _normal;
+
+        double GenerateSignalMass();
+        double GenerateBackgroundMass();
+        double SampleTable(const std::vector<double>& table);
+        double GetSignalFraction(double x0) const;
+        double SignalDensity(double mass) const;
+        double BackgroundDensity(double mass) const;
+        double FillTable(std::vector<double>& table, bool signal) const;
+        void UpdateTables();
+};
+
+
+
+template<class Cloud> void EventGenerator::RegisterCoords(Cloud& cloud) const {
+
+    for(unsigned int i=0; i<_numDims; i++){
+        if(_circular[i])
+            cloud.RegisterPhasespaceCoord(_coordNames[i], PhasespacePointCloud::Pi, PhasespacePointCloud::IS_2PI_CIRCULAR);
+        else
+            cloud.RegisterPhasespaceCoord(_coordNames[i], 1.);
+    }
+}
+
+
+
+template<class Cloud> unsigned long EventGenerator::Fill(Cloud& cloud, unsigned long numEvents){
+
+    PhasespacePoint point;
+    unsigned long numSignal = 0;
+
+    for(unsigned long i=0; i<numEvents; i++){
+        if(Generate(point))
+            numSignal++;
+        cloud.AddPhasespacePoint(point);
+    }
+
+    return numSignal;
+}
+
+
+#endif // EVENTGENERATOR_HH
@@ -0,0 +1,164 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef FASTMATH_HH
+#define FASTMATH_HH
+
+#include <cstring>
+#include <stdint.h>
+
+// Branch-free log and exp for the energy test kernels. Both only use
+// arithmetic, bit operations and selects, so that loops over arrays are
+// auto-vectorized by the compiler, which is not possible with calls to
+// the libm functions. Log is valid for positive normal numbers, Exp
+// returns 0 below -708. The relative deviation from libm is below 1E-15,
+// see tests/FastMath_Test.cc.
+class FastMath
+{
+    public:
+        static double Log(double x);
+        static double Exp(double x);
+        static void LogBatch(const double* in, double* out, unsigned int n);
+        static void ExpBatch(const double* in, double* out, unsigned int n);
+
+    private:
+        static double FromBits(uint64_t bits){ double x; memcpy(&x, &bits, sizeof(x)); return x; }
+        static uint64_t ToBits(double x){ uint64_t bits; memcpy(&bits, &x, sizeof(bits)); return bits; }
+};
+
+
+
+inline double FastMath::Log(double x){
+
+    const double sqrt2 = 1.4142135623730951;
+    const double ln2 = 0.69314718055994531;
+    const uint64_t mantissaMask = 0x000FFFFFFFFFFFFFULL;
+    const uint64_t exponentOne = 0x3FF0000000000000ULL;
+    const uint64_t magicBits = 0x4330000000000000ULL;   // 2^52
+    const double magic = 4503599627370496.0;
+
+    // x = m * 2^e with m in [1, 2). The exponent is converted to double by
+    // inserting it into the mantissa of 2^52.
+    uint64_t bits = ToBits(x);
+    double exponent = FromBits(magicBits | (bits >> 52)) - magic - 1023.;
+    double m = FromBits((bits & mantissaMask) | exponentOne);
+
+    // Move m to [sqrt(0.5), sqrt(2))
+    double large = (m > sqrt2) ? 1. : 0.;
+    m = m - 0.5 * large * m;
+    exponent = exponent + large;
+
+    // log(m) = 2 atanh(s) with |s| < 0.172
+    double s = (m - 1.) / (m + 1.);
+    double s2 = s * s;
+    double p = 1./21.;
+    p = p * s2 + 1./19.;
+    p = p * s2 + 1./17.;
+    p = p * s2 + 1./15.;
+    p = p * s2 + 1./13.;
+    p = p * s2 + 1./11.;
+    p = p * s2 + 1./9.;
+    p = p * s2 + 1./7.;
+    p = p * s2 + 1./5.;
+    p = p * s2 + 1./3.;
+    p = p * s2 + 1.;
+
+    return exponent * ln2 + 2. * s * p;
+}
+
+
+
+inline double FastMath::Exp(double x){
+
+    const double log2e = 1.4426950408889634;
+    const double ln2Hi = 6.93147180369123816490e-01;
+    const double ln2Lo = 1.90821492927058770002e-10;
+    const double roundMagic = 6755399441055744.0;       // 1.5 * 2^52
+
+    // Clamp to the normal range with arithmetic masks, conditional
+    // assignments would prevent the vectorization
+    double underflow = (x < -708.) ? 1. : 0.;
+    double overflow = (x > 709.) ? 1. : 0.;
+    x = x + underflow * (-708. - x);
+    x = x + overflow * (709. - x);
+
+    // x = k ln2 + r with integer k and |r| <= ln2/2
+    double t = x * log2e + roundMagic;
+    double k = t - roundMagic;
+    int64_t ki = static_cast<int64_t>(ToBits(t) - ToBits(roundMagic));
+    double r = (x - k * ln2Hi) - k * ln2Lo;
+
+    double p = 1./6227020800.;
+    p = p * r + 1./479001600.;
+    p = p * r + 1./39916800.;
+    p = p * r + 1./3628800.;
+    p = p * r + 1./362880.;
+    p = p * r + 1./40320.;
+    p = p * r + 1./5040.;
+    p = p * r + 1./720.;
+    p = p * r + 1./120.;
+    p = p * r + 1./24.;
+    p = p * r + 1./6.;
+    p = p * r + 0.5;
+    p = p * r + 1.;
+    p = p * r + 1.;
+
+    double scale = FromBits(static_cast<uint64_t>(ki + 1023) << 52);
+
+    return (1. - underflow) * p * scale;
+}
+
+
+
+inline void FastMath::LogBatch(const double* in, double* out, unsigned int n){
+
+    for(unsigned int i=0; i<n; i++){
+        out[i] = Log(in[i]);
+    }
+}
+
+
+
+inline void FastMath::ExpBatch(const double* in, double* out, unsigned int n){
+
+    for(unsigned int i=0; i<n; i++){
+        out[i] = Exp(in[i]);
+    }
+}
+
+
+#endif // FASTMATH_HH
@@ -43,11 +43,16 @@ class FastPointMap
 {
     public:
         FastPointMap();
-        FastPointMap(PhasespacePoint* phasespacePoint, float distance);
+        FastPointMap(PhasespacePoint* phasespacePoint, float distance, unsigned int index=0);
         PhasespacePoint* _phasespacePoint;
         float _distance;
+        unsigned int _index;
 
     bool operator() (const FastPointMap& i, const FastPointMap& j);
+
+    // Orders equal distances by the point index, so the order does not
+    // depend on the sort algorithm
+    static bool CompareStable(const FastPointMap& i, const FastPointMap& j);
 };
 
 
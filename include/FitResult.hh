@@ -46,12 +46,20 @@ class FitResult
     public:
         double weight;
         double weightError;
-        RooFitResult* rooFitResult;
+        int status;
+        int covQual;
+        double edm;
+        unsigned int numCalls;        // 0 if unknown
+        RooFitResult* rooFitResult;   // NULL for fits without RooFit
 
 
     FitResult() :
         weight(0),
         weightError(0),
+        status(-1),
+        covQual(-1),
+        edm(0),
+        numCalls(0),
         rooFitResult(NULL)
     {}
 
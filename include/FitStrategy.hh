@@ -0,0 +1,72 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef FITSTRATEGY_H
+#define FITSTRATEGY_H
+
+#include <string>
+
+// Minimizer configuration of the per-event fits. By default HESSE only runs
+// if event errors are calculated, weight-only runs use the covariance
+// estimate of the minimizer and never evaluate the second derivatives.
+class FitStrategy
+{
+    public:
+        static const short HESSE_AUTO = 0;
+        static const short HESSE_ALWAYS = 1;
+        static const short HESSE_NEVER = 2;
+
+        std::string minimizerType;  // e.g. "Minuit", "Minuit2"
+        std::string algorithm;      // e.g. "migrad", "simplex"
+        int strategy;               // 0 fast, 1 default, 2 careful
+        short hesseMode;
+        double tolerance;           // <= 0 keeps the minimizer default
+        int maxCalls;               // <= 0 keeps the minimizer default
+
+
+    FitStrategy() :
+        minimizerType("Minuit"),
+        algorithm("migrad"),
+        strategy(1),
+        hesseMode(HESSE_AUTO),
+        tolerance(0),
+        maxCalls(0)
+    {}
+};
+
+
+#endif
@@ -0,0 +1,102 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef KERNELTREE_HH
+#define KERNELTREE_HH
+
+#include <vector>
+#include <cstddef>
+
+class PhasespacePoint;
+
+// Spatial tree (kd-tree) over a set of phasespace points in normalized
+// coordinates. It is used for an approximate Barnes-Hut summation of the
+// logarithmic energy test kernel -log(d + epsilon): nodes that are far away
+// from the target point are replaced by their total weight at the weighted
+// centroid, near nodes are resolved down to the leaves and evaluated exactly.
+// A node is approximated if the Taylor remainder of the kernel, summed over
+// its points, is below tolerance * (sum of absolute weights). The remainders
+// of all approximated nodes are returned as a strict error bound.
+class KernelTree
+{
+    public:
+        KernelTree(const std::vector<PhasespacePoint*>& points,
+                   const std::vector<double>& norms,
+                   const std::vector<bool>& isCircular,
+                   unsigned int leafSize=16);
+
+        void NormalizePoint(const PhasespacePoint* point, double* normalized) const;
+        double SumLogKernel(const double* target, const PhasespacePoint* exclude,
+                            double epsilon, double tolerance, double& errorBound) const;
+        unsigned int GetNumDimensions() const { return _numDims; }
+        unsigned int GetNumNodes() const { return _nodes.size(); }
+        size_t GetMemoryUsage() const;
+
+        static size_t EstimateMemoryUsage(unsigned long numPoints, unsigned int numDims, unsigned int leafSize=16);
+
+    private:
+        struct Node
+        {
+            unsigned int begin;
+            unsigned int end;
+            int left;
+            int right;
+            double weightSum;
+            double absWeightSum;
+            double firstMoment;
+            double secondMoment;
+        };
+
+        unsigned int _numDims;
+        unsigned int _leafSize;
+        std::vector<double> _invNorms;
+        std::vector<bool> _isCircular;
+        std::vector<double> _coords;      // normalized coordinates, point major
+        std::vector<double> _weights;
+        std::vector<const PhasespacePoint*> _points;
+        std::vector<Node> _nodes;
+        std::vector<double> _lo;          // node bounding boxes, node major
+        std::vector<double> _hi;
+        std::vector<double> _centroid;
+
+        int Build(std::vector<unsigned int>& order, unsigned int begin, unsigned int end);
+        bool NodeMinDistance(const double* target, int node, double& dmin) const;
+        double PointDistance(const double* target, const double* point) const;
+};
+
+
+#endif // KERNELTREE_HH
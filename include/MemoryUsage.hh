@@ -0,0 +1,80 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef MEMORYUSAGE_HH
+#define MEMORYUSAGE_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+
+class PhasespacePoint;
+
+// Heap bytes of the main data structures, counted from the container sizes
+// with the allocation granularity of glibc malloc (16 byte chunks with an
+// 8 byte header, 32 bytes at least) and the strings of libstdc++. The
+// tests check both against mallinfo2. The fixed RooFit objects of the fit
+// functions (pdfs, minimizer) are not included. The same per-object
+// formulas are used for the pre-flight estimates, so that an estimate and
+// the accounting of the loaded job agree.
+struct MemoryUsage
+{
+    size_t pointStorage;     // PhasespacePoint objects and the pointer vectors
+    size_t coordinateMaps;   // coordinate maps and vectors of the points
+    size_t neighborIndex;    // sorted distance list of an event, spatial trees
+    size_t fitWorkspace;     // neighbor buffers, datasets, fit cache
+    size_t energyTest;       // coordinate columns and resampling copies
+
+    MemoryUsage();
+    MemoryUsage& operator+=(const MemoryUsage& other);
+    MemoryUsage operator*(size_t factor) const;
+    size_t GetTotal() const;
+    void Print(std::ostream& out, const std::string& title) const;
+
+    static size_t GetAllocationSize(size_t bytes);
+    static size_t GetStringSize(size_t length);
+    static size_t GetVectorBytes(size_t capacity, size_t elementSize);
+    static size_t GetGrownCapacity(size_t size);
+    static size_t GetPointBytes();
+    static size_t GetCoordinateBytes(size_t numCoords, size_t meanNameLength);
+    static size_t GetPointCoordinateBytes(const PhasespacePoint& point);
+};
+
+
+#endif // MEMORYUSAGE_HH
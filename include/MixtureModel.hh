@@ -0,0 +1,276 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef MIXTUREMODEL_HH
+#define MIXTUREMODEL_HH
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+#include "FastMath.hh"
+
+// Signal plus background density r*S + (1-r)*B of the Q-value fits, composed
+// at compile time from two shapes of ModelShapes.hh. With Dim = 2 both
+// components are products of the same shape in mass and mass2, like in
+// WibVoigtFitFunction2D. The parameters are ordered as signal parameters,
+// background parameters and the signal share r as the last one.
+template<class Signal, class Background, unsigned int Dim=1>
+class MixtureModel
+{
+    static_assert(Dim == 1 || Dim == 2, "MixtureModel supports one or two mass dimensions");
+
+    public:
+        static const unsigned int NUM_PARAMS = Signal::NUM_PARAMS + Background::NUM_PARAMS + 1;
+        static const unsigned int SHARE_INDEX = NUM_PARAMS - 1;
+
+        MixtureModel(const Signal& signal, const Background& background, double range);
+
+        const Signal& GetSignal() const { return _signal; }
+        const Background& GetBackground() const { return _background; }
+        double GetRange() const { return _range; }
+        double GetShare() const { return _params[SHARE_INDEX]; }
+        const double* GetParameters() const { return _params; }
+
+        void GetParameter(unsigned int index, std::string& name, double& start, double& min, double& max) const;
+        void SetParameters(const double* params);
+
+        double GetSignalDensity(double x, double y) const;
+        double GetBackgroundDensity(double x, double y) const;
+        double GetQValue(double x, double y) const;
+        void GetQGradient(double x, double y, double* gradient) const;
+
+        bool GetNegativeLogLikelihood(const double* x, const double* y, const double* weights,
+                                      size_t numPoints, double& nll) const;
+
+    private:
+        Signal _signal;
+        Background _background;
+        double _range;
+        double _params[NUM_PARAMS];
+
+        mutable std::vector<double> _signalValues;
+        mutable std::vector<double> _backgroundValues;
+        mutable std::vector<double> _values2;
+};
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+const unsigned int MixtureModel<Signal, Background, Dim>::NUM_PARAMS;
+
+template<class Signal, class Background, unsigned int Dim>
+const unsigned int MixtureModel<Signal, Background, Dim>::SHARE_INDEX;
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+MixtureModel<Signal, Background, Dim>::MixtureModel(const Signal& signal, const Background& background, double range) :
+    _signal(signal),
+    _background(background),
+    _range(range)
+{
+    std::string name;
+    double min, max;
+
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        GetParameter(i, name, _params[i], min, max);
+
+    SetParameters(_params);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void MixtureModel<Signal, Background, Dim>::GetParameter(unsigned int index, std::string& name,
+                                                          double& start, double& min, double& max) const {
+
+    if(index < Signal::NUM_PARAMS){
+        _signal.GetParameter(index, name, start, min, max);
+    }
+    else if(index < SHARE_INDEX){
+        _background.GetParameter(index - Signal::NUM_PARAMS, name, start, min, max);
+    }
+    else{
+        name = "sigshare";
+        start = 0.5;
+        min = 0;
+        max = 1;
+    }
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void MixtureModel<Signal, Background, Dim>::SetParameters(const double* params){
+
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        _params[i] = params[i];
+
+    _signal.SetParameters(_params, _range);
+    _background.SetParameters(_params + Signal::NUM_PARAMS, _range);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double MixtureModel<Signal, Background, Dim>::GetSignalDensity(double x, double y) const {
+
+    return (Dim == 2) ? _signal.Evaluate(x) * _signal.Evaluate(y) : _signal.Evaluate(x);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double MixtureModel<Signal, Background, Dim>::GetBackgroundDensity(double x, double y) const {
+
+    return (Dim == 2) ? _background.Evaluate(x) * _background.Evaluate(y) : _background.Evaluate(x);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double MixtureModel<Signal, Background, Dim>::GetQValue(double x, double y) const {
+
+    double r = GetShare();
+    double s = r * GetSignalDensity(x, y);
+    double b = (1 - r) * GetBackgroundDensity(x, y);
+
+    return s / (s + b);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void MixtureModel<Signal, Background, Dim>::GetQGradient(double x, double y, double* gradient) const {
+
+    // dQ/dp = r(1-r)/D^2 * (b*ds - s*db) and dQ/dr = s*b/D^2 with D = r*s + (1-r)*b,
+    // see WibFitFunction::CombineQGradient
+    double r = GetShare();
+    double s = GetSignalDensity(x, y);
+    double b = GetBackgroundDensity(x, y);
+    double denom = r * s + (1 - r) * b;
+    double scale = r * (1 - r) / (denom * denom);
+
+    double signalGradient[Signal::NUM_PARAMS + 1];
+    double backgroundGradient[Background::NUM_PARAMS + 1];
+    _signal.GetGradient(x, signalGradient);
+    _background.GetGradient(x, backgroundGradient);
+
+    if(Dim == 2){
+        double signalGradient2[Signal::NUM_PARAMS + 1];
+        double backgroundGradient2[Background::NUM_PARAMS + 1];
+        _signal.GetGradient(y, signalGradient2);
+        _background.GetGradient(y, backgroundGradient2);
+
+        for(unsigned int i=0; i<Signal::NUM_PARAMS; i++)
+            signalGradient[i] = signalGradient[i] * _signal.Evaluate(y) + _signal.Evaluate(x) * signalGradient2[i];
+
+        for(unsigned int i=0; i<Background::NUM_PARAMS; i++)
+            backgroundGradient[i] = backgroundGradient[i] * _background.Evaluate(y) +
+                                    _background.Evaluate(x) * backgroundGradient2[i];
+    }
+
+    for(unsigned int i=0; i<Signal::NUM_PARAMS; i++)
+        gradient[i] = scale * b * signalGradient[i];
+
+    for(unsigned int i=0; i<Background::NUM_PARAMS; i++)
+        gradient[Signal::NUM_PARAMS + i] = -scale * s * backgroundGradient[i];
+
+    gradient[SHARE_INDEX] = s * b / (denom * denom);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+bool MixtureModel<Signal, Background, Dim>::GetNegativeLogLikelihood(const double* x, const double* y,
+                                                                    const double* weights, size_t numPoints,
+                                                                    double& nll) const {
+
+    // Weighted likelihood -sum w*log(r*S + (1-r)*B) like the RooFit NLL
+    // without SumW2 correction. Returns false if the density is not
+    // positive at one of the points.
+    _signalValues.resize(numPoints);
+    _backgroundValues.resize(numPoints);
+
+    if(numPoints == 0){
+        nll = 0;
+        return true;
+    }
+
+    double* signalValues = &_signalValues[0];
+    double* backgroundValues = &_backgroundValues[0];
+
+    _signal.EvaluateBatch(x, signalValues, numPoints);
+    _background.EvaluateBatch(x, backgroundValues, numPoints);
+
+    if(Dim == 2){
+        _values2.resize(numPoints);
+        double* values2 = &_values2[0];
+
+        _signal.EvaluateBatch(y, values2, numPoints);
+        for(size_t i=0; i<numPoints; i++)
+            signalValues[i] *= values2[i];
+
+        _background.EvaluateBatch(y, values2, numPoints);
+        for(size_t i=0; i<numPoints; i++)
+            backgroundValues[i] *= values2[i];
+    }
+
+    double r = GetShare();
+    double minDensity = 1;
+
+    for(size_t i=0; i<numPoints; i++){
+        signalValues[i] = r * signalValues[i] + (1 - r) * backgroundValues[i];
+        minDensity = (signalValues[i] < minDensity) ? signalValues[i] : minDensity;
+    }
+
+    if(!(minDensity > 0))
+        return false;
+
+    FastMath::LogBatch(signalValues, signalValues, numPoints);
+
+    double sum = 0;
+    for(size_t i=0; i<numPoints; i++)
+        sum -= weights[i] * signalValues[i];
+
+    nll = sum;
+    return true;
+}
+
+
+#endif // MIXTUREMODEL_HH
@@ -0,0 +1,478 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef MODELSHAPES_HH
+#define MODELSHAPES_HH
+
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <stddef.h>
+
+#include "FastMath.hh"
+#include "VoigtProfile.hh"
+#include "NormalizationCache.hh"
+
+// Shape policies of MixtureModel. Masses are given relative to the lower
+// edge of the fit range, each shape is normalized on [0, range] and has
+// NUM_PARAMS floating parameters. A shape provides
+//
+//   GetParameter(index, name, start, min, max)   description of a parameter
+//   SetParameters(params, range)                 new parameters, normalization
+//   Evaluate(x), EvaluateBatch(x, values, n)     normalized density
+//   GetGradient(x, gradient)                     density derivatives by the parameters
+//
+// All members are inline and non-virtual, so the likelihood loops of the
+// model are compiled for the concrete shapes.
+class GaussShape
+{
+    public:
+        static const unsigned int NUM_PARAMS = 1;
+
+        GaussShape(double mean, double sigmaStart, double sigmaMin, double sigmaMax) :
+            _mean(mean), _sigmaStart(sigmaStart), _sigmaMin(sigmaMin), _sigmaMax(sigmaMax),
+            _sigma(sigmaStart), _range(0), _norm(1) {}
+
+        void GetParameter(unsigned int index, std::string& name, double& start, double& min, double& max) const {
+            name = "sigma";
+            start = _sigmaStart;
+            min = _sigmaMin;
+            max = _sigmaMax;
+        }
+
+        void SetParameters(const double* params, double range);
+        double Evaluate(double x) const;
+        void EvaluateBatch(const double* x, double* values, size_t numPoints) const;
+        void GetGradient(double x, double* gradient) const;
+
+    private:
+        double _mean;
+        double _sigmaStart;
+        double _sigmaMin;
+        double _sigmaMax;
+        double _sigma;
+        double _range;
+        double _norm;
+};
+
+
+
+// Voigt profile with fixed mean and width. The normalization over sigma is
+// tabulated once per fit range, like in WibCachedVoigtian. The width has to
+// be positive, GaussShape covers the Gaussian limit.
+class VoigtShape
+{
+    public:
+        static const unsigned int NUM_PARAMS = 1;
+
+        VoigtShape(double mean, double width, double sigmaStart, double sigmaMin, double sigmaMax,
+                   unsigned int numNodes=256) :
+            _profile(mean, width, sigmaStart), _cache(sigmaMin, sigmaMax, numNodes),
+            _sigmaStart(sigmaStart), _sigmaMin(sigmaMin), _sigmaMax(sigmaMax),
+            _cacheRange(-1), _range(0), _norm(1) {}
+
+        void GetParameter(unsigned int index, std::string& name, double& start, double& min, double& max) const {
+            name = "sigma";
+            start = _sigmaStart;
+            min = _sigmaMin;
+            max = _sigmaMax;
+        }
+
+        void SetParameters(const double* params, double range);
+        double Evaluate(double x) const;
+        void EvaluateBatch(const double* x, double* values, size_t numPoints) const;
+        void GetGradient(double x, double* gradient) const;
+
+    private:
+        VoigtProfile _profile;
+        NormalizationCache _cache;
+        double _sigmaStart;
+        double _sigmaMin;
+        double _sigmaMax;
+        double _cacheRange;
+        double _range;
+        double _norm;
+};
+
+
+
+// Crystal Ball with a low tail like RooCBShape: fixed mean and exponent n,
+// floating sigma and alpha (alpha > 0). The normalization and its
+// derivatives are closed-form and updated once per parameter set.
+class CrystalBallShape
+{
+    public:
+        static const unsigned int NUM_PARAMS = 2;
+
+        CrystalBallShape(double mean, double sigmaStart, double sigmaMin, double sigmaMax,
+                         double alphaStart, double alphaMin, double alphaMax, double n) :
+            _mean(mean), _n(n), _sigmaStart(sigmaStart), _sigmaMin(sigmaMin), _sigmaMax(sigmaMax),
+            _alphaStart(alphaStart), _alphaMin(alphaMin), _alphaMax(alphaMax),
+            _sigma(sigmaStart), _alpha(alphaStart), _tailA(0), _tailB(0), _range(0), _norm(1),
+            _normDSigma(0), _normDAlpha(0) {}
+
+        void GetParameter(unsigned int index, std::string& name, double& start, double& min, double& max) const {
+            name = (index == 0) ? "sigma" : "alpha";
+            start = (index == 0) ? _sigmaStart : _alphaStart;
+            min = (index == 0) ? _sigmaMin : _alphaMin;
+            max = (index == 0) ? _sigmaMax : _alphaMax;
+        }
+
+        void SetParameters(const double* params, double range);
+        double Evaluate(double x) const;
+        void EvaluateBatch(const double* x, double* values, size_t numPoints) const;
+        void GetGradient(double x, double* gradient) const;
+
+    private:
+        double GetUnnormalized(double t) const;
+        static double PowerIntegral(double u, double k);
+
+        double _mean;
+        double _n;
+        double _sigmaStart;
+        double _sigmaMin;
+        double _sigmaMax;
+        double _alphaStart;
+        double _alphaMin;
+        double _alphaMax;
+        double _sigma;
+        double _alpha;
+        double _tailA;
+        double _tailB;
+        double _range;
+        double _norm;
+        double _normDSigma;
+        double _normDAlpha;
+};
+
+
+
+// Polynomial 1 + a1*x + ... + aN*x^N like RooPolynomial, Order = 0 is a
+// flat background.
+template<unsigned int Order>
+class PolynomialShape
+{
+    public:
+        static const unsigned int NUM_PARAMS = Order;
+
+        PolynomialShape() : _range(0), _norm(1) {
+            for(unsigned int k=0; k<=Order; k++)
+                _coefs[k] = 0;
+        }
+
+        void GetParameter(unsigned int index, std::string& name, double& start, double& min, double& max) const {
+            name = "a" + std::string(1, static_cast<char>('1' + index));
+            start = 0.1;
+            min = -100;
+            max = 100;
+        }
+
+        void SetParameters(const double* params, double range);
+        double Evaluate(double x) const;
+        void EvaluateBatch(const double* x, double* values, size_t numPoints) const;
+        void GetGradient(double x, double* gradient) const;
+
+    private:
+        double _coefs[Order + 1];  // _coefs[k] multiplies x^(k+1)
+        double _range;
+        double _norm;
+};
+
+
+
+inline void GaussShape::SetParameters(const double* params, double range){
+
+    _sigma = params[0];
+    _range = range;
+
+    double tlow = -_mean / _sigma;
+    double thigh = (range - _mean) / _sigma;
+    _norm = _sigma * sqrt(M_PI / 2.) * (erf(thigh / sqrt(2.)) - erf(tlow / sqrt(2.)));
+}
+
+
+
+inline double GaussShape::Evaluate(double x) const {
+
+    double t = (x - _mean) / _sigma;
+
+    return exp(-0.5 * t * t) / _norm;
+}
+
+
+
+inline void GaussShape::EvaluateBatch(const double* x, double* values, size_t numPoints) const {
+
+    double scale = -0.5 / (_sigma * _sigma);
+
+    for(size_t i=0; i<numPoints; i++){
+        double arg = x[i] - _mean;
+        values[i] = scale * arg * arg;
+    }
+
+    FastMath::ExpBatch(values, values, numPoints);
+
+    double invNorm = 1. / _norm;
+    for(size_t i=0; i<numPoints; i++)
+        values[i] *= invNorm;
+}
+
+
+
+inline void GaussShape::GetGradient(double x, double* gradient) const {
+
+    // dI/dsigma = I/sigma - [t * exp(-t^2/2)] over the range
+    double t = (x - _mean) / _sigma;
+    double tlow = -_mean / _sigma;
+    double thigh = (_range - _mean) / _sigma;
+    double normDSigma = _norm / _sigma - thigh * exp(-0.5 * thigh * thigh) + tlow * exp(-0.5 * tlow * tlow);
+    double gauss = exp(-0.5 * t * t);
+
+    gradient[0] = (gauss * t * t / _sigma - gauss / _norm * normDSigma) / _norm;
+}
+
+
+
+inline void VoigtShape::SetParameters(const double* params, double range){
+
+    _profile.SetParameters(_profile.GetMean(), _profile.GetWidth(), params[0]);
+    _range = range;
+
+    if(_cacheRange != range){
+        for(unsigned int i=0; i<_cache.GetNumNodes(); i++){
+            VoigtProfile node(_profile.GetMean(), _profile.GetWidth(), _cache.GetNode(i));
+            _cache.SetNode(i, node.Integrate(0, range), node.IntegralDSigma(0, range));
+        }
+        _cacheRange = range;
+    }
+
+    _norm = _cache.IsInRange(params[0]) ? _cache.GetValue(params[0]) : _profile.Integrate(0, range);
+}
+
+
+
+inline double VoigtShape::Evaluate(double x) const {
+
+    return _profile.Evaluate(x) / _norm;
+}
+
+
+
+inline void VoigtShape::EvaluateBatch(const double* x, double* values, size_t numPoints) const {
+
+    _profile.EvaluateBatch(x, values, numPoints);
+
+    double invNorm = 1. / _norm;
+    for(size_t i=0; i<numPoints; i++)
+        values[i] *= invNorm;
+}
+
+
+
+inline void VoigtShape::GetGradient(double x, double* gradient) const {
+
+    double value, dSigma, dX;
+    _profile.Evaluate(x, value, dSigma, dX);
+
+    gradient[0] = (dSigma - value / _norm * _profile.IntegralDSigma(0, _range)) / _norm;
+}
+
+
+
+inline double CrystalBallShape::PowerIntegral(double u, double k){
+
+    // Antiderivative of u^-k
+    if(k == 1)
+        return log(u);
+
+    return pow(u, 1 - k) / (1 - k);
+}
+
+
+
+inline double CrystalBallShape::GetUnnormalized(double t) const {
+
+    if(t >= -_alpha)
+        return exp(-0.5 * t * t);
+
+    return _tailA / pow(_tailB - t, _n);
+}
+
+
+
+inline void CrystalBallShape::SetParameters(const double* params, double range){
+
+    _sigma = params[0];
+    _alpha = params[1];
+    _range = range;
+    _tailA = pow(_n / _alpha, _n) * exp(-0.5 * _alpha * _alpha);
+    _tailB = _n / _alpha - _alpha;
+
+    double tlow = -_mean / _sigma;
+    double thigh = (range - _mean) / _sigma;
+
+    // Gaussian core above -alpha, power-law tail A / (B - t)^n below, with
+    // d ln(tail) / d alpha = dA + dB / (B - t)
+    double core = 0;
+    double tail = 0;
+    _normDAlpha = 0;
+
+    if(thigh > -_alpha){
+        double tstart = std::max(tlow, -_alpha);
+        core = sqrt(M_PI / 2.) * (erf(thigh / sqrt(2.)) - erf(tstart / sqrt(2.)));
+    }
+
+    if(tlow < -_alpha){
+        double tend = std::min(thigh, -_alpha);
+        double ulow = _tailB - tlow;
+        double uhigh = _tailB - tend;
+        double dA = -_n / _alpha - _alpha;
+        double dB = _n * (_n / (_alpha * _alpha) + 1);
+
+        tail = _tailA * (PowerIntegral(ulow, _n) - PowerIntegral(uhigh, _n));
+        _normDAlpha = _sigma * _tailA * (dA * (PowerIntegral(ulow, _n) - PowerIntegral(uhigh, _n)) +
+                                         dB * (PowerIntegral(ulow, _n + 1) - PowerIntegral(uhigh, _n + 1)));
+    }
+
+    // Pure scale dependence: dI/dsigma = I/sigma - [t * f(t)] over the range
+    _norm = _sigma * (core + tail);
+    _normDSigma = _norm / _sigma - thigh * GetUnnormalized(thigh) + tlow * GetUnnormalized(tlow);
+}
+
+
+
+inline double CrystalBallShape::Evaluate(double x) const {
+
+    return GetUnnormalized((x - _mean) / _sigma) / _norm;
+}
+
+
+
+inline void CrystalBallShape::EvaluateBatch(const double* x, double* values, size_t numPoints) const {
+
+    for(size_t i=0; i<numPoints; i++)
+        values[i] = Evaluate(x[i]);
+}
+
+
+
+inline void CrystalBallShape::GetGradient(double x, double* gradient) const {
+
+    double t = (x - _mean) / _sigma;
+    double value = GetUnnormalized(t);
+    double valueDSigma = 0;
+    double valueDAlpha = 0;
+
+    if(t >= -_alpha){
+        valueDSigma = value * t * t / _sigma;
+    }
+    else{
+        valueDSigma = -_n * t * value / (_sigma * (_tailB - t));
+        valueDAlpha = value * (-_n / _alpha - _alpha + _n * (_n / (_alpha * _alpha) + 1) / (_tailB - t));
+    }
+
+    gradient[0] = (valueDSigma - value / _norm * _normDSigma) / _norm;
+    gradient[1] = (valueDAlpha - value / _norm * _normDAlpha) / _norm;
+}
+
+
+
+template<unsigned int Order>
+const unsigned int PolynomialShape<Order>::NUM_PARAMS;
+
+
+
+template<unsigned int Order>
+inline void PolynomialShape<Order>::SetParameters(const double* params, double range){
+
+    _range = range;
+    _norm = range;
+
+    double rpow = range;
+    for(unsigned int k=0; k<Order; k++){
+        _coefs[k] = params[k];
+        rpow *= range;
+        _norm += _coefs[k] * rpow / (k + 2);
+    }
+}
+
+
+
+template<unsigned int Order>
+inline double PolynomialShape<Order>::Evaluate(double x) const {
+
+    double value = 0;
+    for(unsigned int k=Order; k>0; k--)
+        value = (value + _coefs[k - 1]) * x;
+
+    return (1. + value) / _norm;
+}
+
+
+
+template<unsigned int Order>
+inline void PolynomialShape<Order>::EvaluateBatch(const double* x, double* values, size_t numPoints) const {
+
+    double invNorm = 1. / _norm;
+
+    for(size_t i=0; i<numPoints; i++){
+        double value = 0;
+        for(unsigned int k=Order; k>0; k--)
+            value = (value + _coefs[k - 1]) * x[i];
+
+        values[i] = (1. + value) * invNorm;
+    }
+}
+
+
+
+template<unsigned int Order>
+inline void PolynomialShape<Order>::GetGradient(double x, double* gradient) const {
+
+    double density = Evaluate(x);
+    double xpow = 1;
+    double rpow = _range;
+
+    for(unsigned int k=0; k<Order; k++){
+        xpow *= x;
+        rpow *= _range;
+        gradient[k] = (xpow - density * rpow / (k + 2)) / _norm;
+    }
+}
+
+
+#endif // MODELSHAPES_HH
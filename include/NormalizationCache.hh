@@ -0,0 +1,67 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef NORMALIZATIONCACHE_HH
+#define NORMALIZATIONCACHE_HH
+
+#include <vector>
+
+// Table of a normalization integral as a function of one floating shape
+// parameter. The owner fills equidistant nodes with the integral and its
+// derivative, values in between are interpolated with cubic Hermite
+// polynomials, so smooth integrals are reproduced to O(h^4).
+class NormalizationCache
+{
+    public:
+        NormalizationCache(double paramMin, double paramMax, unsigned int numNodes);
+
+        unsigned int GetNumNodes() const { return _values.size(); }
+        double GetNode(unsigned int index) const;
+        void SetNode(unsigned int index, double value, double derivative);
+        bool IsInRange(double param) const;
+        double GetValue(double param) const;
+
+    private:
+        double _paramMin;
+        double _paramMax;
+        double _step;
+        std::vector<double> _values;
+        std::vector<double> _derivatives;
+};
+
+
+#endif // NORMALIZATIONCACHE_HH
@@ -0,0 +1,79 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+// Hardware performance counters (cycles, instructions, last level cache
+// misses, branch misses) of the calling thread, read with perf_event_open
+// on Linux. With inherit, threads started after the construction are
+// counted as well. Counters that the kernel or the permissions
+// (perf_event_paranoid) do not provide are reported as unavailable, on
+// other systems none are available.
+class PerfCounters
+{
+    public:
+        static const short CYCLES = 0;
+        static const short INSTRUCTIONS = 1;
+        static const short LLC_MISSES = 2;
+        static const short BRANCH_MISSES = 3;
+        static const short NUM_EVENTS = 4;
+
+        explicit PerfCounters(bool inherit=false);
+        ~PerfCounters();
+
+        bool IsAvailable() const;
+        bool IsAvailable(short event) const { return _fds[event] >= 0; }
+
+        void Start();
+        void Stop();
+
+        // Counts between Start and Stop, scaled up if the kernel had to
+        // multiplex the counters
+        double GetCount(short event) const { return _counts[event]; }
+        static const char* GetEventName(short event);
+
+    private:
+        PerfCounters(const PerfCounters&);
+        PerfCounters& operator=(const PerfCounters&);
+
+        int _fds[NUM_EVENTS];
+        double _counts[NUM_EVENTS];
+};
+
+
+#endif
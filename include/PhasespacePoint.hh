@@ -61,6 +61,7 @@ class PhasespacePoint
         void SetCoordinate(std::string name, double value);
         void SetWeight(double weight);
         void SetWeightError(double weightError);
+        void SetCloudIndex(long index);
         void ArrangeCoordinates(const std::map< std::string, PhasespaceCoord >& coordNameMap);
 
         double GetCoordValue(unsigned short int id) const;
@@ -69,6 +70,7 @@ class PhasespacePoint
         double GetWeight() const;
         double GetWeightError() const;
         double GetInitialWeight() const;
+        long GetCloudIndex() const;
 
         bool IsMass2Set() const;
 
@@ -84,6 +86,7 @@ class PhasespacePoint
         double _mass2;
         double _weight;
         double _weightError;
+        long _cloudIndex;
         bool _mass2Set;
 };
 
@@ -41,6 +41,8 @@
 #include <map>
 #include <vector>
 
+#include "MemoryUsage.hh"
+
 class PhasespacePoint;
 class PhasespaceCoord;
 
@@ -53,6 +55,9 @@ class PhasespacePointCloud
         void AddPhasespacePoint(PhasespacePoint& newPhasespacePoint, int subset=1);
         void ArrangePointCoordinates(PhasespacePoint& point);
         float CalcPhasespaceDistance(PhasespacePoint* targetPoint, PhasespacePoint* refPoint);
+        virtual MemoryUsage GetMemoryUsage() const;
+        static MemoryUsage EstimateMemoryUsage(unsigned long numPoints, unsigned int numCoords,
+                                               unsigned int meanNameLength=2);
 
         static const double Pi;
         static const bool IS_2PI_CIRCULAR;
@@ -61,6 +66,8 @@ class PhasespacePointCloud
         std::ostream* _qout;
         std::vector<PhasespacePoint*>& GetPointVector(int subset=1);
         std::map<std::string, PhasespaceCoord>& GetCoordNameMap();
+        size_t GetNumPoints(int subset=1) const { return _phasespacePointVectors.at(subset - 1).size(); }
+        unsigned int GetNumCoords() const { return _coordNameMap.size(); }
 
     private:
         std::map< std::string, PhasespaceCoord > _coordNameMap;
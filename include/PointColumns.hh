@@ -0,0 +1,77 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef POINTCOLUMNS_HH
+#define POINTCOLUMNS_HH
+
+#include <vector>
+#include <cstddef>
+
+class PhasespacePoint;
+
+// Block of points in normalized coordinates stored column by column
+// (one contiguous array per coordinate plus one for the weights). Used
+// as resident sample and as tile buffer in the pair loops of EnergyTest.
+class PointColumns
+{
+    public:
+        PointColumns(unsigned int numDims=0, unsigned int capacity=0);
+
+        void Reserve(unsigned int numDims, unsigned int capacity);
+        void SetNumPoints(unsigned int numPoints);
+        void Fill(const std::vector<PhasespacePoint*>& points, const std::vector<double>& invNorms);
+
+        unsigned int GetNumPoints() const { return _numPoints; }
+        unsigned int GetNumDims() const { return _numDims; }
+        unsigned int GetCapacity() const { return _capacity; }
+        double* GetColumn(unsigned int dim) { return _values.data() + dim * _capacity; }
+        const double* GetColumn(unsigned int dim) const { return _values.data() + dim * _capacity; }
+        double* GetWeights() { return _values.data() + _numDims * _capacity; }
+        const double* GetWeights() const { return _values.data() + _numDims * _capacity; }
+        size_t GetMemoryUsage() const { return _values.capacity() * sizeof(double); }
+
+        static size_t GetBytesPerPoint(unsigned int numDims) { return (numDims + 1) * sizeof(double); }
+
+    private:
+        unsigned int _numDims;
+        unsigned int _capacity;
+        unsigned int _numPoints;
+        std::vector<double> _values;
+};
+
+
+#endif // POINTCOLUMNS_HH
@@ -0,0 +1,513 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef SIMPLEXMODELFITTER_HH
+#define SIMPLEXMODELFITTER_HH
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stddef.h>
+
+#include "MixtureModel.hh"
+
+// Fits the MixtureModel of a queue of events, one after another, with a
+// Nelder-Mead minimization instead of Minuit. The neighbors of all queued
+// events are copied into one contiguous store, the likelihood of each fit
+// is vectorized over the neighbors of its event.
+//
+// Bounded parameters are mapped to unbounded ones with the sine transform
+// of Minuit. A converged simplex is restarted once around its best vertex.
+// With SetCalcErrors the covariance is the inverse of the finite
+// difference Hessian of the likelihood at the minimum.
+//
+// Masses are given relative to the lower edge of the fit range. Status
+// codes follow Minuit: 0 converged, 4 call limit reached.
+template<class Signal, class Background, unsigned int Dim=1>
+class SimplexModelFitter
+{
+    public:
+        typedef MixtureModel<Signal, Background, Dim> Model;
+        static const unsigned int NUM_PARAMS = Model::NUM_PARAMS;
+
+        struct Result
+        {
+            unsigned int id;
+            double weight;
+            double weightError;
+            int status;
+            int covQual;
+            unsigned int numCalls;
+            double params[NUM_PARAMS];
+        };
+
+        SimplexModelFitter(const Signal& signal, const Background& background, double range);
+
+        void SetCalcErrors(bool set){ _calcErrors = set; }
+        void SetTolerance(double tolerance){ _tolerance = tolerance; }
+        void SetMaxCalls(unsigned int maxCalls){ _maxCalls = maxCalls; }
+        bool GetCalcErrors() const { return _calcErrors; }
+
+        void AddEvent(unsigned int id, size_t numPoints, const double* masses, const double* masses2,
+                      const double* weights, double eventMass, double eventMass2);
+        size_t GetNumEvents() const { return _events.size(); }
+        void Run(std::vector<Result>& results);
+
+    private:
+        struct Event
+        {
+            unsigned int id;
+            size_t offset;
+            size_t numPoints;
+            double mass;
+            double mass2;
+        };
+
+        double ToExternal(unsigned int i, double internal) const;
+        double ToInternal(unsigned int i, double external) const;
+        double Evaluate(const Event& event, const double* params);
+        double EvaluateInternal(const Event& event, const double* internal);
+        int Simplex(const Event& event, const double* center, unsigned int firstVertex);
+        bool CalcHessian(const Event& event, const double* minimum, double hessian[][NUM_PARAMS]);
+        void Fit(const Event& event, Result& result);
+
+        Model _model;
+        double _min[NUM_PARAMS];
+        double _max[NUM_PARAMS];
+        double _start[NUM_PARAMS];
+        bool _calcErrors;
+        double _tolerance;
+        unsigned int _maxCalls;
+
+        unsigned int _numCalls;
+        unsigned int _best;
+        double _vertices[NUM_PARAMS + 1][NUM_PARAMS];
+        double _values[NUM_PARAMS + 1];
+
+        std::vector<Event> _events;
+        std::vector<double> _masses;
+        std::vector<double> _masses2;
+        std::vector<double> _weights;
+};
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+const unsigned int SimplexModelFitter<Signal, Background, Dim>::NUM_PARAMS;
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+SimplexModelFitter<Signal, Background, Dim>::SimplexModelFitter(const Signal& signal, const Background& background,
+                                                                double range) :
+    _model(signal, background, range),
+    _calcErrors(false),
+    _tolerance(1E-7),
+    _maxCalls(2000),
+    _numCalls(0),
+    _best(0)
+{
+    for(unsigned int i=0; i<NUM_PARAMS; i++){
+        std::string name;
+        _model.GetParameter(i, name, _start[i], _min[i], _max[i]);
+    }
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void SimplexModelFitter<Signal, Background, Dim>::AddEvent(unsigned int id, size_t numPoints,
+                                                           const double* masses, const double* masses2,
+                                                           const double* weights, double eventMass,
+                                                           double eventMass2){
+
+    Event event;
+    event.id = id;
+    event.offset = _masses.size();
+    event.numPoints = numPoints;
+    event.mass = eventMass;
+    event.mass2 = eventMass2;
+    _events.push_back(event);
+
+    _masses.insert(_masses.end(), masses, masses + numPoints);
+    _weights.insert(_weights.end(), weights, weights + numPoints);
+
+    if(Dim == 2)
+        _masses2.insert(_masses2.end(), masses2, masses2 + numPoints);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void SimplexModelFitter<Signal, Background, Dim>::Run(std::vector<Result>& results){
+
+    // Results are in the order in which the events were added
+    results.resize(_events.size());
+
+    for(size_t e=0; e<_events.size(); e++)
+        Fit(_events[e], results[e]);
+
+    _events.clear();
+    _masses.clear();
+    _masses2.clear();
+    _weights.clear();
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double SimplexModelFitter<Signal, Background, Dim>::ToExternal(unsigned int i, double internal) const {
+
+    return _min[i] + (_max[i] - _min[i]) * (sin(internal) + 1.) / 2.;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double SimplexModelFitter<Signal, Background, Dim>::ToInternal(unsigned int i, double external) const {
+
+    double arg = 2. * (external - _min[i]) / (_max[i] - _min[i]) - 1.;
+    arg = (arg > 1.) ? 1. : ((arg < -1.) ? -1. : arg);
+
+    return asin(arg);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double SimplexModelFitter<Signal, Background, Dim>::Evaluate(const Event& event, const double* params){
+
+    _numCalls++;
+    _model.SetParameters(params);
+
+    const double* masses2 = (Dim == 2) ? &_masses2[event.offset] : NULL;
+    double nll;
+
+    if(!_model.GetNegativeLogLikelihood(&_masses[event.offset], masses2, &_weights[event.offset],
+                                        event.numPoints, nll)){
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return nll;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double SimplexModelFitter<Signal, Background, Dim>::EvaluateInternal(const Event& event, const double* internal){
+
+    double params[NUM_PARAMS];
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        params[i] = ToExternal(i, internal[i]);
+
+    return Evaluate(event, params);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+int SimplexModelFitter<Signal, Background, Dim>::Simplex(const Event& event, const double* center,
+                                                         unsigned int firstVertex){
+
+    // Vertex 0 is the center, vertex i+1 is shifted in parameter i by a
+    // tenth of its start value, the wide default limits of the background
+    // coefficients are no useful scale. Vertices below firstVertex keep
+    // their values.
+    for(unsigned int v=0; v<=NUM_PARAMS; v++){
+        for(unsigned int i=0; i<NUM_PARAMS; i++)
+            _vertices[v][i] = center[i];
+
+        if(v > 0){
+            unsigned int i = v - 1;
+            double external = ToExternal(i, center[i]);
+            double step = (_start[i] != 0) ? 0.1 * fabs(_start[i]) : 0.01 * (_max[i] - _min[i]);
+            double shifted = (external + step <= _max[i]) ? external + step : external - step;
+            _vertices[v][i] = center[i] + ToInternal(i, shifted) - ToInternal(i, external);
+        }
+
+        if(v >= firstVertex)
+            _values[v] = EvaluateInternal(event, _vertices[v]);
+    }
+
+    double centroid[NUM_PARAMS];
+    double reflected[NUM_PARAMS];
+    double trial[NUM_PARAMS];
+
+    while(true){
+        unsigned int worst = 0;
+        _best = 0;
+        for(unsigned int v=1; v<=NUM_PARAMS; v++){
+            if(_values[v] < _values[_best])
+                _best = v;
+            if(_values[v] >= _values[worst])
+                worst = v;
+        }
+
+        unsigned int second = _best;
+        for(unsigned int v=0; v<=NUM_PARAMS; v++){
+            if(v != worst && _values[v] >= _values[second])
+                second = v;
+        }
+
+        if(_values[worst] - _values[_best] < _tolerance)
+            return 0;
+
+        if(_numCalls >= _maxCalls)
+            return 4;
+
+        // Reflect the worst vertex at the centroid of the others
+        for(unsigned int i=0; i<NUM_PARAMS; i++){
+            double sum = 0;
+            for(unsigned int v=0; v<=NUM_PARAMS; v++){
+                if(v != worst)
+                    sum += _vertices[v][i];
+            }
+            centroid[i] = sum / NUM_PARAMS;
+            reflected[i] = 2. * centroid[i] - _vertices[worst][i];
+        }
+
+        double reflectedValue = EvaluateInternal(event, reflected);
+
+        if(reflectedValue < _values[_best]){
+            for(unsigned int i=0; i<NUM_PARAMS; i++)
+                trial[i] = centroid[i] + 2. * (reflected[i] - centroid[i]);
+
+            double value = EvaluateInternal(event, trial);
+            bool expanded = value < reflectedValue;
+
+            for(unsigned int i=0; i<NUM_PARAMS; i++)
+                _vertices[worst][i] = expanded ? trial[i] : reflected[i];
+            _values[worst] = expanded ? value : reflectedValue;
+            continue;
+        }
+
+        if(reflectedValue < _values[second]){
+            for(unsigned int i=0; i<NUM_PARAMS; i++)
+                _vertices[worst][i] = reflected[i];
+            _values[worst] = reflectedValue;
+            continue;
+        }
+
+        bool outside = reflectedValue < _values[worst];
+        for(unsigned int i=0; i<NUM_PARAMS; i++){
+            double target = outside ? reflected[i] : _vertices[worst][i];
+            trial[i] = centroid[i] + 0.5 * (target - centroid[i]);
+        }
+
+        double value = EvaluateInternal(event, trial);
+
+        if(outside ? (value <= reflectedValue) : (value < _values[worst])){
+            for(unsigned int i=0; i<NUM_PARAMS; i++)
+                _vertices[worst][i] = trial[i];
+            _values[worst] = value;
+            continue;
+        }
+
+        // Shrink all vertices towards the best one
+        for(unsigned int v=0; v<=NUM_PARAMS; v++){
+            if(v == _best)
+                continue;
+
+            for(unsigned int i=0; i<NUM_PARAMS; i++)
+                _vertices[v][i] = _vertices[_best][i] + 0.5 * (_vertices[v][i] - _vertices[_best][i]);
+            _values[v] = EvaluateInternal(event, _vertices[v]);
+        }
+    }
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+bool SimplexModelFitter<Signal, Background, Dim>::CalcHessian(const Event& event, const double* minimum,
+                                                              double hessian[][NUM_PARAMS]){
+
+    // Symmetric steps that stay inside the parameter limits, starting at
+    // the scale of the initial simplex
+    double steps[NUM_PARAMS];
+    for(unsigned int i=0; i<NUM_PARAMS; i++){
+        double distance = std::min(minimum[i] - _min[i], _max[i] - minimum[i]);
+        double step = (_start[i] != 0) ? 0.01 * fabs(_start[i]) : 1E-3 * (_max[i] - _min[i]);
+        steps[i] = std::min(step, 0.5 * distance);
+
+        if(!(steps[i] > 0))
+            return false;
+    }
+
+    double f0 = _values[_best];
+    double point[NUM_PARAMS];
+    double diagonal[2 * NUM_PARAMS];
+
+    // The diagonal differences f(x+h) + f(x-h) - 2f(x) ~ (h/sigma)^2 should be
+    // about 0.01, i.e. h about a tenth of the parameter error. Otherwise the
+    // steps are rescaled and the diagonal is evaluated again, at most three times.
+    for(unsigned int round=0; ; round++){
+        for(unsigned int k=0; k<2*NUM_PARAMS; k++){
+            std::copy(minimum, minimum + NUM_PARAMS, point);
+            point[k / 2] += (k % 2 == 0) ? steps[k / 2] : -steps[k / 2];
+            diagonal[k] = Evaluate(event, point);
+        }
+
+        if(round == 3)
+            break;
+
+        bool accepted = true;
+        for(unsigned int i=0; i<NUM_PARAMS; i++){
+            double difference = diagonal[2 * i] + diagonal[2 * i + 1] - 2. * f0;
+
+            if(difference > 2E-3 && difference < 5E-2)
+                continue;
+
+            double distance = std::min(minimum[i] - _min[i], _max[i] - minimum[i]);
+            double scale = (difference > 1E-12) ? sqrt(0.01 / difference) : 10.;
+            double step = std::min(steps[i] * std::min(scale, 10.), 0.5 * distance);
+
+            if(step != steps[i]){
+                steps[i] = step;
+                accepted = false;
+            }
+        }
+
+        if(accepted)
+            break;
+    }
+
+    // Central differences, the mixed ones from x +- h_i +- h_j
+    for(unsigned int i=0; i<NUM_PARAMS; i++){
+        hessian[i][i] = (diagonal[2 * i] - 2. * f0 + diagonal[2 * i + 1]) / (steps[i] * steps[i]);
+
+        for(unsigned int j=i+1; j<NUM_PARAMS; j++){
+            double corners[4];
+            for(unsigned int signs=0; signs<4; signs++){
+                std::copy(minimum, minimum + NUM_PARAMS, point);
+                point[i] += (signs < 2) ? steps[i] : -steps[i];
+                point[j] += (signs % 2 == 0) ? steps[j] : -steps[j];
+                corners[signs] = Evaluate(event, point);
+            }
+
+            hessian[i][j] = (corners[0] - corners[1] - corners[2] + corners[3]) / (4. * steps[i] * steps[j]);
+            hessian[j][i] = hessian[i][j];
+        }
+    }
+
+    return true;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void SimplexModelFitter<Signal, Background, Dim>::Fit(const Event& event, Result& result){
+
+    _numCalls = 0;
+
+    double center[NUM_PARAMS];
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        center[i] = ToInternal(i, _start[i]);
+
+    int status = Simplex(event, center, 0);
+
+    if(status == 0){
+        // Restart once around the best vertex, which keeps its value
+        for(unsigned int i=0; i<NUM_PARAMS; i++)
+            center[i] = _vertices[_best][i];
+
+        _values[0] = _values[_best];
+        status = Simplex(event, center, 1);
+    }
+
+    double minimum[NUM_PARAMS];
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        minimum[i] = ToExternal(i, _vertices[_best][i]);
+
+    double hessian[NUM_PARAMS][NUM_PARAMS];
+    bool hesse = (status == 0 && _calcErrors && CalcHessian(event, minimum, hessian));
+
+    _model.SetParameters(minimum);
+
+    result.id = event.id;
+    result.weight = _model.GetQValue(event.mass, event.mass2);
+    result.weightError = 0;
+    result.status = status;
+    result.covQual = 0;
+    result.numCalls = _numCalls;
+
+    for(unsigned int i=0; i<NUM_PARAMS; i++)
+        result.params[i] = minimum[i];
+
+    if(!hesse)
+        return;
+
+    // Inversion of the Hessian with a Cholesky decomposition
+    double lower[NUM_PARAMS][NUM_PARAMS];
+    for(unsigned int i=0; i<NUM_PARAMS; i++){
+        for(unsigned int j=0; j<=i; j++){
+            double sum = hessian[i][j];
+            for(unsigned int m=0; m<j; m++)
+                sum -= lower[i][m] * lower[j][m];
+
+            if(i == j){
+                if(!(sum > 0))
+                    return;
+                lower[i][i] = sqrt(sum);
+            }
+            else{
+                lower[i][j] = sum / lower[j][j];
+            }
+        }
+    }
+
+    // Error of Q = sqrt(g^T H^-1 g) = |L^-1 g|
+    double gradient[NUM_PARAMS];
+    _model.GetQGradient(event.mass, event.mass2, gradient);
+
+    double errsq = 0;
+    for(unsigned int i=0; i<NUM_PARAMS; i++){
+        double sum = gradient[i];
+        for(unsigned int m=0; m<i; m++)
+            sum -= lower[i][m] * gradient[m];
+        gradient[i] = sum / lower[i][i];
+        errsq += gradient[i] * gradient[i];
+    }
+
+    result.weightError = sqrt(errsq);
+    result.covQual = 3;
+}
+
+
+#endif // SIMPLEXMODELFITTER_HH
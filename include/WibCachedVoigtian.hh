@@ -0,0 +1,101 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef WIBCACHEDVOIGTIAN_H
+#define WIBCACHEDVOIGTIAN_H
+
+#include "RooAbsPdf.h"
+#include "RooRealProxy.h"
+#include "NormalizationCache.hh"
+
+class RooAbsReal;
+
+// Voigt profile with the same shape as RooVoigtian, evaluated with the
+// rational Faddeeva approximation of VoigtProfile. The normalization
+// integral over the full range of x is taken from a table over sigma that
+// is built once. Mean and width are expected to stay fixed, the table is
+// rebuilt if they or the range of x change.
+class WibCachedVoigtian : public RooAbsPdf
+{
+    public:
+        WibCachedVoigtian(const char* name,
+                          const char* title,
+                          RooAbsReal& px,
+                          RooAbsReal& pmean,
+                          RooAbsReal& pwidth,
+                          RooAbsReal& psigma,
+                          double sigmaMin,
+                          double sigmaMax,
+                          unsigned int numNodes=256);
+
+        WibCachedVoigtian(const WibCachedVoigtian& other, const char* name=0);
+        virtual TObject* clone(const char* newname) const;
+        virtual ~WibCachedVoigtian();
+
+        virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0) const;
+        virtual Double_t analyticalIntegral(Int_t code, const char* rangeName=0) const;
+
+        static bool GetDerivatives(double px,
+                                   double pmean,
+                                   double pwidth,
+                                   double psigma,
+                                   double& value,
+                                   double& dSigma,
+                                   double& dX);
+
+    protected:
+        virtual Double_t evaluate() const;
+
+    private:
+        double Integrate(double sigmaVal) const;
+        void FillCache() const;
+
+        RooRealProxy x;
+        RooRealProxy mean;
+        RooRealProxy width;
+        RooRealProxy sigma;
+
+        mutable NormalizationCache cache;
+        mutable bool cacheFilled;
+        mutable double cacheMean;
+        mutable double cacheWidth;
+        mutable double cacheMin;
+        mutable double cacheMax;
+};
+
+
+#endif
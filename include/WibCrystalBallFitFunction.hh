@@ -64,10 +64,13 @@ class WibCrystalBallFitFunction : public WibFitFunction
 
     protected:
         virtual double ReturnCurrentQValue();
+        virtual bool GetQGradient(std::vector<double>& gradient);
         virtual void SaveFitToFile(std::string fileName);
         virtual RooArgList GetParamList() const;
+        virtual RooArgList GetBackgroundParamList() const;
 
     private:
+        unsigned int backgroundPolOrder;
         RooRealVar* mean;
         RooRealVar* sigma;
         RooRealVar* a1;
@@ -39,12 +39,20 @@
 #define WIBFITFUNCTION_H
 
 #include <string>
+#include <vector>
 #include "RooArgList.h"
 #include "PhasespacePoint.hh"
+#include "FitStrategy.hh"
 
 class RooRealVar;
+class RooArgSet;
 class RooDataSet;
+class RooDataHist;
+class RooAbsData;
 class RooAddPdf;
+class RooAbsReal;
+class RooMinimizer;
+class RooFitResult;
 class FitResult;
 
 class WibFitFunction
@@ -54,24 +62,68 @@ class WibFitFunction
         virtual ~WibFitFunction();
         virtual FitResult* DoFitD(double eventMass, double eventMass2) = 0;
         void SetCalcErrors(bool set);
+        void SetBinnedFit(unsigned int pnumBins);
+        void SetFitStrategy(const FitStrategy& pfitStrategy);
+        const FitStrategy& GetFitStrategy() const;
+        unsigned int GetNumBins() const;
         void SaveNextFitToFile(std::string fileName);
         void AddData(const PhasespacePoint& phasespacePoint);
+        void SetData(size_t numPoints, const double* masses, const double* masses2, const double* weights);
+        void ClearData();
+        size_t GetNumData() const;
         bool GetCalcError() const;
         double GetMinMass() const;
         double GetMaxMass() const;
         FitResult* DoFit(double eventMass, double eventMass2);
+        FitResult* EvaluateFit(const RooFitResult& rooFitResult, double eventMass, double eventMass2);
+        virtual void SetAlternativeStart(unsigned int attempt);
+        virtual void SetBackgroundFixed(bool fixed);
+        size_t GetMemoryUsage() const;
+        static size_t EstimateMemoryUsage(unsigned int numNeighbors, unsigned int numBins=0);
 
     protected:
         virtual double ReturnCurrentQValue() = 0;
+        RooFitResult* Minimize();
+        virtual bool GetQGradient(std::vector<double>& gradient);
         virtual void SaveFitToFile(std::string fileName) = 0;
         virtual RooArgList GetParamList() const = 0 ;
+        virtual RooArgList GetBackgroundParamList() const;
+        static double GetAlternativeStart(double start, double min, double max, unsigned int attempt, bool background);
+        void CombineQGradient(double share,
+                              double signal,
+                              double background,
+                              const std::vector<double>& signalGradient,
+                              const std::vector<double>& backgroundGradient,
+                              int shareIndex,
+                              std::vector<double>& gradient) const;
+        static void GetPolynomialGradient(double x,
+                                          double range,
+                                          const std::vector<double>& coefs,
+                                          std::vector<double>& gradient);
         RooRealVar* mass;
         RooRealVar* mass2;
         RooRealVar* initialWeight;
         RooDataSet* data;
         RooAddPdf* totalIntensity;
+        std::vector<double> massBuffer;
+        std::vector<double> mass2Buffer;
+        std::vector<double> weightBuffer;
 
     private:
+        void FillDataSet();
+        FitResult* FinishFit(FitResult* fitResult);
+        void ResetMinimizer();
+        void SaveDefaultStart();
+
+        RooArgSet* dataRow;
+        RooDataHist* binnedData;
+        unsigned int numBins;
+        RooAbsReal* nll;
+        RooMinimizer* minimizer;
+        unsigned int lastNumCalls;
+        FitStrategy fitStrategy;
+        std::vector<double> defaultStart;
+        std::vector<double> defaultError;
         bool calcError;
         bool saveNextFitToFile;
         double minMass;
@@ -60,10 +60,13 @@ class WibGaussFitFunction : public WibFitFunction
 
     protected:
         virtual double ReturnCurrentQValue();
+        virtual bool GetQGradient(std::vector<double>& gradient);
         virtual void SaveFitToFile(std::string fileName);
         virtual RooArgList GetParamList() const;
+        virtual RooArgList GetBackgroundParamList() const;
 
     private:
+        unsigned int backgroundPolOrder;
         RooRealVar* mean;
         RooRealVar* sigma;
         RooRealVar* a1;
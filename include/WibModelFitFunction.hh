@@ -0,0 +1,370 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef WIBMODELFITFUNCTION_H
+#define WIBMODELFITFUNCTION_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <iostream>
+
+#include "WibFitFunction.hh"
+#include "FitResult.hh"
+#include "MixtureModel.hh"
+#include "ModelShapes.hh"
+#include "WibProfile.hh"
+
+#include "Math/Minimizer.h"
+#include "Math/Factory.h"
+#include "Math/Functor.h"
+
+#include "TCanvas.h"
+#include "TH1D.h"
+#include "TGraph.h"
+
+// Fit function for any MixtureModel of the shapes in ModelShapes.hh, e.g.
+//
+//   WibModelFitFunction<VoigtShape, PolynomialShape<2> > fitFunction(
+//       VoigtShape(mean - minMass, width, 3, 1, 10), PolynomialShape<2>(), minMass, maxMass);
+//
+// The likelihood is evaluated directly on the neighbor buffers and
+// minimized with ROOT::Math::Minimizer, without a RooFit dataset or
+// expression tree. The fit result carries no RooFitResult, so these fits
+// are not stored by the WiBaS fit cache.
+template<class Signal, class Background, unsigned int Dim=1>
+class WibModelFitFunction : public WibFitFunction
+{
+    public:
+        typedef MixtureModel<Signal, Background, Dim> Model;
+
+        WibModelFitFunction(const Signal& signal,
+                            const Background& background,
+                            double pminMass,
+                            double pmaxMass);
+
+        virtual ~WibModelFitFunction();
+        virtual FitResult* DoFitD(double eventMass, double eventMass2);
+        const Model& GetModel() const { return model; }
+        virtual void SetAlternativeStart(unsigned int attempt);
+        virtual void SetBackgroundFixed(bool fixed);
+
+    protected:
+        virtual double ReturnCurrentQValue();
+        virtual void SaveFitToFile(std::string fileName);
+        virtual RooArgList GetParamList() const;
+
+    private:
+        double EvaluateNLL(const double* params);
+        void CreateMinimizer();
+
+        Model model;
+        ROOT::Math::Minimizer* mathMinimizer;
+        std::string minimizerType;
+        std::string algorithm;
+        double startValues[Model::NUM_PARAMS];
+        bool fixedParams[Model::NUM_PARAMS];
+        bool restoreSteps;
+        bool validNLLSeen;
+        double maxValidNLL;
+        double currentMass;
+        double currentMass2;
+};
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+WibModelFitFunction<Signal, Background, Dim>::WibModelFitFunction(const Signal& signal,
+                                                                  const Background& background,
+                                                                  double pminMass,
+                                                                  double pmaxMass) :
+    WibFitFunction(pminMass, pmaxMass),
+    model(signal, background, pmaxMass - pminMass),
+    mathMinimizer(NULL),
+    restoreSteps(false),
+    validNLLSeen(false),
+    maxValidNLL(0),
+    currentMass(0),
+    currentMass2(0)
+{
+    SetAlternativeStart(0);
+    SetBackgroundFixed(false);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void WibModelFitFunction<Signal, Background, Dim>::SetAlternativeStart(unsigned int attempt){
+
+    // The minimizer keeps the step sizes and the covariance of the last fit
+    // as the seed of the next one, the next fit starts from a new minimizer
+    restoreSteps = true;
+
+    for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+        std::string name;
+        double start, min, max;
+        model.GetParameter(i, name, start, min, max);
+
+        bool background = (i >= Signal::NUM_PARAMS && i < Model::SHARE_INDEX);
+        startValues[i] = (attempt == 0) ? start : GetAlternativeStart(start, min, max, attempt, background);
+    }
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void WibModelFitFunction<Signal, Background, Dim>::SetBackgroundFixed(bool fixed){
+
+    // A fixed background is flat
+    for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+        std::string name;
+        double start, min, max;
+        model.GetParameter(i, name, start, min, max);
+
+        fixedParams[i] = fixed && (i >= Signal::NUM_PARAMS && i < Model::SHARE_INDEX);
+        if(fixedParams[i])
+            startValues[i] = 0;
+        else if(i >= Signal::NUM_PARAMS && i < Model::SHARE_INDEX)
+            startValues[i] = start;
+    }
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+WibModelFitFunction<Signal, Background, Dim>::~WibModelFitFunction(){
+
+    if(mathMinimizer != NULL)
+        delete mathMinimizer;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void WibModelFitFunction<Signal, Background, Dim>::CreateMinimizer(){
+
+    if(mathMinimizer != NULL)
+        delete mathMinimizer;
+
+    const FitStrategy& fitStrategy = GetFitStrategy();
+    minimizerType = fitStrategy.minimizerType;
+    algorithm = fitStrategy.algorithm;
+
+    mathMinimizer = ROOT::Math::Factory::CreateMinimizer(minimizerType, algorithm);
+    if(mathMinimizer == NULL){
+        std::cout << "ERROR: could not create minimizer " << minimizerType << std::endl;
+        return;
+    }
+
+    // Initial steps of a tenth of the parameter range, as in RooMinimizer
+    for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+        std::string name;
+        double start, min, max;
+        model.GetParameter(i, name, start, min, max);
+        mathMinimizer->SetLimitedVariable(i, name, start, 0.1 * (max - min), min, max);
+    }
+
+    ROOT::Math::Functor nllFunctor(this, &WibModelFitFunction::EvaluateNLL, Model::NUM_PARAMS);
+    mathMinimizer->SetFunction(nllFunctor);
+    mathMinimizer->SetErrorDef(0.5);
+    mathMinimizer->SetPrintLevel(-1);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double WibModelFitFunction<Signal, Background, Dim>::EvaluateNLL(const double* params){
+
+    model.SetParameters(params);
+
+    const double* masses2 = (Dim == 2) ? &mass2Buffer[0] : NULL;
+    double nll;
+
+    // Points with a non-positive density push the minimizer back above the
+    // largest valid likelihood value, like RooFit does for evaluation errors.
+    // Before the first valid value there is no such bound yet.
+    if(!model.GetNegativeLogLikelihood(&massBuffer[0], masses2, &weightBuffer[0], massBuffer.size(), nll))
+        return validNLLSeen ? maxValidNLL + 10. : 1E30;
+
+    if(!validNLLSeen || nll > maxValidNLL)
+        maxValidNLL = nll;
+    validNLLSeen = true;
+
+    return nll;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+FitResult* WibModelFitFunction<Signal, Background, Dim>::DoFitD(double eventMass, double eventMass2){
+
+    const FitStrategy& fitStrategy = GetFitStrategy();
+
+    if(mathMinimizer == NULL || restoreSteps || fitStrategy.minimizerType != minimizerType
+       || fitStrategy.algorithm != algorithm)
+        CreateMinimizer();
+
+    restoreSteps = false;
+
+    if(mathMinimizer == NULL || massBuffer.empty())
+        return NULL;
+
+    mathMinimizer->SetStrategy(fitStrategy.strategy);
+
+    if(fitStrategy.tolerance > 0)
+        mathMinimizer->SetTolerance(fitStrategy.tolerance);
+
+    if(fitStrategy.maxCalls > 0){
+        mathMinimizer->SetMaxFunctionCalls(fitStrategy.maxCalls);
+        mathMinimizer->SetMaxIterations(fitStrategy.maxCalls);
+    }
+
+    for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+        mathMinimizer->SetVariableValue(i, startValues[i]);
+
+        if(fixedParams[i])
+            mathMinimizer->FixVariable(i);
+        else
+            mathMinimizer->ReleaseVariable(i);
+    }
+
+    validNLLSeen = false;
+    {
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_MINIMIZE);
+        mathMinimizer->Minimize();
+    }
+
+    FitResult* fitResult = new FitResult;
+    fitResult->status = mathMinimizer->Status();
+
+    bool runHesse = (fitStrategy.hesseMode == FitStrategy::HESSE_ALWAYS) ||
+                    (fitStrategy.hesseMode == FitStrategy::HESSE_AUTO && GetCalcError());
+
+    if(runHesse && fitResult->status == 0){
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_HESSE);
+        mathMinimizer->Hesse();
+    }
+
+    fitResult->covQual = mathMinimizer->CovMatrixStatus();
+    fitResult->edm = mathMinimizer->Edm();
+    fitResult->numCalls = mathMinimizer->NCalls();
+
+    model.SetParameters(mathMinimizer->X());
+    currentMass = eventMass;
+    currentMass2 = eventMass2;
+    fitResult->weight = ReturnCurrentQValue();
+
+    if(GetCalcError()){
+        double gradient[Model::NUM_PARAMS];
+        model.GetQGradient(eventMass, eventMass2, gradient);
+
+        double errsq = 0;
+        for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+            for(unsigned int j=0; j<Model::NUM_PARAMS; j++){
+                errsq += gradient[i] * mathMinimizer->CovMatrix(i, j) * gradient[j];
+            }
+        }
+
+        fitResult->weightError = sqrt(errsq);
+    }
+
+    return fitResult;
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+double WibModelFitFunction<Signal, Background, Dim>::ReturnCurrentQValue(){
+
+    return model.GetQValue(currentMass, currentMass2);
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+void WibModelFitFunction<Signal, Background, Dim>::SaveFitToFile(std::string fileName){
+
+    // Neighbors and the model projected on the first mass
+    const int numBins = 50;
+    const int numCurvePoints = 200;
+    double range = model.GetRange();
+    double sumOfWeights = 0;
+
+    TCanvas canvas("canvas", "My plots", 0, 0, 550, 500);
+    TH1D histogram("data", "data", numBins, 0, range);
+
+    for(size_t i=0; i<massBuffer.size(); i++){
+        histogram.Fill(massBuffer[i], weightBuffer[i]);
+        sumOfWeights += weightBuffer[i];
+    }
+
+    double r = model.GetShare();
+    double scale = sumOfWeights * range / numBins;
+    TGraph total(numCurvePoints);
+    TGraph background(numCurvePoints);
+    TGraph signal(numCurvePoints);
+
+    for(int i=0; i<numCurvePoints; i++){
+        double x = range * i / (numCurvePoints - 1.);
+        double s = r * model.GetSignal().Evaluate(x) * scale;
+        double b = (1 - r) * model.GetBackground().Evaluate(x) * scale;
+        total.SetPoint(i, x, s + b);
+        background.SetPoint(i, x, b);
+        signal.SetPoint(i, x, s);
+    }
+
+    background.SetLineColor(kRed);
+    signal.SetLineColor(kGreen);
+
+    histogram.Draw("E");
+    total.Draw("L");
+    background.Draw("L");
+    signal.Draw("L");
+    canvas.SaveAs(fileName.c_str());
+}
+
+
+
+template<class Signal, class Background, unsigned int Dim>
+RooArgList WibModelFitFunction<Signal, Background, Dim>::GetParamList() const {
+
+    // The parameters live in the minimizer, not in RooRealVars
+    return RooArgList();
+}
+
+
+#endif
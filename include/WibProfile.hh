@@ -0,0 +1,144 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef WIBPROFILE_H
+#define WIBPROFILE_H
+
+#include <chrono>
+#include <iostream>
+
+#include "WibTrace.hh"
+
+// Stage timers and counters of CalcWeight and DoFit. The instrumentation is
+// only compiled in with -DWIBAS_PROFILE (make PROFILEFLAGS=-DWIBAS_PROFILE),
+// otherwise the macros below expand to nothing. Every thread accumulates into
+// its own thread_local record, GetStats merges them.
+class WibProfile
+{
+    public:
+        static const short STAGE_CALCWEIGHT = 0;    // whole CalcWeight
+        static const short STAGE_DISTANCES = 1;     // phasespace distance scan
+        static const short STAGE_SORT = 2;          // sort by distance
+        static const short STAGE_CACHE = 3;         // fit cache lookup
+        static const short STAGE_ADD_DATA = 4;      // AddData of the neighbors
+        static const short STAGE_FILL_DATASET = 5;  // RooDataSet/RooDataHist filling
+        static const short STAGE_FIT = 6;           // DoFitD, contains minimize and hesse
+        static const short STAGE_MINIMIZE = 7;
+        static const short STAGE_HESSE = 8;
+        static const short STAGE_ERROR = 9;         // Q gradient and error propagation
+        static const short STAGE_FALLBACK = 10;     // fallback ladder, contains its fits
+        static const short STAGE_OUTPUT = 11;       // telemetry and progress file writing
+        static const short NUM_STAGES = 12;
+
+        static const short COUNT_EVENTS = 0;
+        static const short COUNT_NEIGHBORS = 1;
+        static const short COUNT_FITS = 2;
+        static const short COUNT_CACHE_HITS = 3;
+        static const short COUNT_FALLBACKS = 4;
+        static const short COUNT_FAILED = 5;
+        static const short COUNT_Q_CLIPPED = 6;
+        static const short COUNT_Q_EVALUATIONS = 7;  // finite-difference Q evaluations
+        static const short NUM_COUNTERS = 8;
+
+        struct Stats
+        {
+            double seconds[NUM_STAGES];
+            unsigned long long calls[NUM_STAGES];
+            unsigned long long counts[NUM_COUNTERS];
+
+            Stats();
+            Stats& operator+=(const Stats& other);
+        };
+
+        static bool IsEnabled();
+        static void AddTime(short stage, double seconds);
+        static void AddCount(short counter, unsigned long long n);
+
+        // Merges the records of all threads, running threads must not be
+        // inside CalcWeight at the same time
+        static Stats GetStats();
+        static void Reset();
+        static void PrintSummary(std::ostream& out = std::cout);
+
+        static const char* GetStageName(short stage);
+        static const char* GetCounterName(short counter);
+};
+
+
+
+class WibStageTimer
+{
+    public:
+        explicit WibStageTimer(short stage) :
+            _stage(stage),
+            _start(std::chrono::steady_clock::now())
+        {}
+
+        ~WibStageTimer(){
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            WibProfile::AddTime(_stage, std::chrono::duration<double>(end - _start).count());
+#ifdef WIBAS_TRACE
+            WibTrace::AddSpan(_stage, _start, end);
+#endif
+        }
+
+    private:
+        short _stage;
+        std::chrono::steady_clock::time_point _start;
+};
+
+
+
+// The stage timers also feed the trace of WibTrace with -DWIBAS_TRACE.
+// Disabled, the macros are still one statement, e.g. the body of an if.
+#if defined(WIBAS_PROFILE) || defined(WIBAS_TRACE)
+#define WIBAS_PROFILE_CONCAT_(a, b) a##b
+#define WIBAS_PROFILE_CONCAT(a, b) WIBAS_PROFILE_CONCAT_(a, b)
+#define WIBAS_PROFILE_SCOPE(stage) WibStageTimer WIBAS_PROFILE_CONCAT(wibStageTimer, __LINE__)(stage)
+#else
+#define WIBAS_PROFILE_SCOPE(stage) ((void)0)
+#endif
+
+#ifdef WIBAS_PROFILE
+#define WIBAS_PROFILE_COUNT(counter, n) WibProfile::AddCount(counter, n)
+#else
+#define WIBAS_PROFILE_COUNT(counter, n) ((void)0)
+#endif
+
+
+#endif
@@ -0,0 +1,125 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef WIBPROGRESS_H
+#define WIBPROGRESS_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Snapshot of a weighting run, rates in events per second
+struct ProgressStatus
+{
+    unsigned long numTotal;
+    unsigned long numDone;
+    unsigned long numFailed;
+    double elapsedSeconds;
+    double eventsPerSecond;        // since the start
+    double recentEventsPerSecond;  // since the previous report
+    double meanLatency;            // moving average of the seconds per event
+    double etaSeconds;             // -1 while unknown
+    std::vector<unsigned long> workerDone;
+    std::vector<unsigned long> workerFailed;
+    std::vector<double> workerLatency;
+};
+
+
+
+// Progress of long weighting runs. Every worker (thread or WiBaS instance)
+// only writes its own counters with relaxed atomics, the workers never wait
+// for each other or for the reporter. The reporter thread of Start
+// periodically rewrites a JSON status file, via a temporary file and
+// rename, so a monitoring script never reads a partial file. Sharded runs
+// use one status file per process.
+class WibProgress
+{
+    public:
+        WibProgress(unsigned long numTotal, unsigned int numWorkers=1);
+        ~WibProgress();
+
+        void AddEvent(unsigned int worker, bool success, double seconds);
+
+        void Start(const std::string& statusFileName, double intervalSeconds=10., bool print=false);
+        void Stop();
+
+        ProgressStatus GetStatus();
+        bool WriteStatusFile(const std::string& fileName, const ProgressStatus& status) const;
+        void PrintStatus(std::ostream& out, const ProgressStatus& status) const;
+
+        static const double LATENCY_SMOOTHING;
+
+    private:
+        // The padding keeps the counters of neighboring workers at least 64
+        // bytes apart, so they never share a cache line. The slots are not
+        // aligned, alignas(64) is not honored by new before C++17.
+        struct WorkerSlot
+        {
+            std::atomic<unsigned long> done;
+            std::atomic<unsigned long> failed;
+            std::atomic<double> latency;
+            char padding[64];
+        };
+
+        unsigned long numTotal;
+        unsigned int numWorkers;
+        WorkerSlot* workerSlots;
+        std::chrono::steady_clock::time_point startTime;
+
+        std::mutex statusMutex;
+        std::chrono::steady_clock::time_point lastReportTime;
+        unsigned long lastReportDone;
+
+        std::thread reportThread;
+        std::mutex reportMutex;
+        std::condition_variable reportCondition;
+        bool running;
+
+        void ReportLoop(std::string statusFileName, double intervalSeconds, bool print);
+
+        WibProgress(const WibProgress&);
+        WibProgress& operator=(const WibProgress&);
+};
+
+
+#endif
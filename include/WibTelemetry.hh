@@ -0,0 +1,174 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#ifndef WIBTELEMETRY_H
+#define WIBTELEMETRY_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+
+// Fit quality of one CalcWeight call. q is the weight before clipping to
+// [0, 1], clip is +1 (q > 1), -1 (q < 0) or 0.
+struct TelemetryRecord
+{
+    unsigned long long event;   // CalcWeight call number of the source
+    unsigned int source;        // WiBaS instance or worker, see WiBaS::SetTelemetry
+    short status;
+    short covQual;
+    short rung;                 // WiBaS::FIT_NOMINAL ... FIT_FAILED
+    short clip;
+    unsigned int numCalls;      // 0 if the minimizer does not report it
+    unsigned int numNeighbors;
+    double q;
+    double weightError;
+    double edm;
+    double seconds;
+};
+
+
+
+// Histogram with equidistant bins in x, or in log10(x) for logScale, plus
+// underflow and overflow counts
+class TelemetryHistogram
+{
+    public:
+        TelemetryHistogram(double low, double high, unsigned int numBins, bool logScale);
+
+        void Fill(double x);
+        void Clear();
+        unsigned long GetBinCount(unsigned int bin) const { return _counts.at(bin); }
+        unsigned long GetUnderflow() const { return _underflow; }
+        unsigned long GetOverflow() const { return _overflow; }
+        unsigned long GetEntries() const { return _entries; }
+        unsigned int GetNumBins() const { return _counts.size(); }
+        double GetBinLowEdge(unsigned int bin) const;
+        void Print(std::ostream& out, const std::string& title) const;
+
+    private:
+        double _low;
+        double _high;
+        bool _logScale;
+        std::vector<unsigned long> _counts;
+        unsigned long _underflow;
+        unsigned long _overflow;
+        unsigned long _entries;
+};
+
+
+
+// Aggregates of all drained records
+struct TelemetrySummary
+{
+    unsigned long numRecords;
+    unsigned long numDropped;
+    unsigned long numClippedHigh;
+    unsigned long numClippedLow;
+    std::map<int, unsigned long> statusCounts;
+    std::map<int, unsigned long> covQualCounts;
+    std::map<int, unsigned long> rungCounts;
+    TelemetryHistogram edm;
+    TelemetryHistogram numCalls;
+    TelemetryHistogram seconds;
+
+    TelemetrySummary();
+};
+
+
+
+// Structured per-event fit telemetry. Producers (CalcWeight in any number
+// of threads) push records into a bounded lock-free ring buffer, records
+// that do not fit are counted as dropped instead of blocking the fit. The
+// ring is drained into the optional CSV or binary sink and the summary
+// histograms, either by calling Drain or by the thread of Start.
+class WibTelemetry
+{
+    public:
+        static const short FORMAT_CSV = 0;
+        static const short FORMAT_BINARY = 1;
+
+        explicit WibTelemetry(unsigned int capacity=65536);
+        ~WibTelemetry();
+
+        bool OpenSink(const std::string& fileName, short format=FORMAT_CSV);
+        bool Push(const TelemetryRecord& record);
+        unsigned long Drain();
+        void Start(unsigned int intervalMilliseconds=100);
+        void Stop();
+
+        TelemetrySummary GetSummary();
+        void PrintSummary(std::ostream& out = std::cout);
+
+        static const char BINARY_MAGIC[8];
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            TelemetryRecord record;
+        };
+
+        Slot* _slots;
+        size_t _mask;
+        std::atomic<size_t> _enqueuePos;
+        std::atomic<size_t> _dequeuePos;
+        std::atomic<unsigned long> _numDropped;
+
+        std::mutex _drainMutex;
+        std::ofstream _sink;
+        short _format;
+        TelemetrySummary _summary;
+
+        std::thread _drainThread;
+        std::atomic<bool> _running;
+
+        bool Pop(TelemetryRecord& record);
+        void Write(const TelemetryRecord& record);
+        void DrainLoop(unsigned int intervalMilliseconds);
+
+        WibTelemetry(const WibTelemetry&);
+        WibTelemetry& operator=(const WibTelemetry&);
+};
+
+
+#endif
@@ -0,0 +1,87 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#ifndef WIBTRACE_H
+#define WIBTRACE_H
+
+#include <chrono>
+#include <string>
+
+// Timeline of the WiBaS stages for Chrome trace-event JSON (chrome://tracing,
+// Perfetto). The spans are the stages of WibProfile: neighbor search
+// (distances, sort), data filling (AddData, fill dataset), minimization
+// (minimize), error propagation (hesse, error propagation) and output
+// writing (output), each tagged with the thread and the event of
+// CalcWeight. They are only recorded with -DWIBAS_TRACE (make
+// PROFILEFLAGS=-DWIBAS_TRACE) and between Start and Stop. Every thread
+// writes into its own ring buffer of capacityPerThread spans (32 bytes each)
+// that overwrites the oldest spans, so a trace holds the latest window of a
+// long run at fixed memory.
+class WibTrace
+{
+    public:
+        static bool IsEnabled();
+
+        static void Start(unsigned int capacityPerThread=65536);
+        static void Stop();
+        static bool IsRecording();
+
+        // Drops all spans, the buffers of finished threads are freed
+        static void Clear();
+
+        // Event of the following spans of the calling thread, -1 for none
+        static void SetEvent(long event);
+        static void AddSpan(short stage, std::chrono::steady_clock::time_point start,
+                            std::chrono::steady_clock::time_point end);
+
+        static unsigned long GetNumSpans();
+        static unsigned long GetNumOverwritten();
+
+        // Threads may keep recording while the trace is written
+        static bool WriteChromeTrace(const std::string& fileName);
+};
+
+
+
+#ifdef WIBAS_TRACE
+#define WIBAS_TRACE_EVENT(event) WibTrace::SetEvent(event)
+#else
+#define WIBAS_TRACE_EVENT(event)
+#endif
+
+
+#endif
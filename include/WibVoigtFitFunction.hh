@@ -41,7 +41,7 @@
 #include "WibFitFunction.hh"
 
 class RooRealVar;
-class RooVoigtian;
+class RooAbsPdf;
 class RooPolynomial;
 
 class WibVoigtFitFunction : public WibFitFunction
@@ -54,17 +54,22 @@ class WibVoigtFitFunction : public WibFitFunction
                             unsigned int backgroundPolOrder,
                             double voigtSigmaStart,
                             double voigtSigmaMin,
-                            double voigtSigmaMax);
+                            double voigtSigmaMax,
+                            bool exactVoigt=false);
 
         virtual ~WibVoigtFitFunction();
         virtual FitResult* DoFitD(double eventMass, double eventMass2);
 
     protected:
         virtual double ReturnCurrentQValue();
+        virtual bool GetQGradient(std::vector<double>& gradient);
         virtual void SaveFitToFile(std::string fileName);
         virtual RooArgList GetParamList() const;
+        virtual RooArgList GetBackgroundParamList() const;
 
     private:
+        unsigned int backgroundPolOrder;
+        bool exactVoigt;
         RooRealVar* mean;
         RooRealVar* sigma;
         RooRealVar* gamma;
@@ -72,7 +77,7 @@ class WibVoigtFitFunction : public WibFitFunction
         RooRealVar* a2;
         RooRealVar* sigshare;
 
-        RooVoigtian* voigtFunction;
+        RooAbsPdf* voigtFunction;
         RooPolynomial* polFunction;
 };
 
@@ -41,7 +41,7 @@
 #include "WibFitFunction.hh"
 
 class RooRealVar;
-class RooVoigtian;
+class WibCachedVoigtian;
 class RooPolynomial;
 class RooProdPdf;
 
@@ -62,10 +62,13 @@ class WibVoigtFitFunction2D : public WibFitFunction
 
     protected:
         virtual double ReturnCurrentQValue();
+        virtual bool GetQGradient(std::vector<double>& gradient);
         virtual void SaveFitToFile(std::string fileName);
         virtual RooArgList GetParamList() const;
+        virtual RooArgList GetBackgroundParamList() const;
 
     private:
+        unsigned int backgroundPolOrder;
         RooRealVar* mean;
         RooRealVar* sigma;
         RooRealVar* gamma;
@@ -73,8 +76,8 @@ class WibVoigtFitFunction2D : public WibFitFunction
         RooRealVar* a2;
         RooRealVar* sigshare;
 
-        RooVoigtian* voigtFunction1;
-        RooVoigtian* voigtFunction2;
+        WibCachedVoigtian* voigtFunction1;
+        WibCachedVoigtian* voigtFunction2;
         RooPolynomial* polFunction1;
         RooPolynomial* polFunction2;
         RooProdPdf* voigtFunctionProd;
@@ -40,9 +40,12 @@
 
 #include <string>
 #include <map>
+#include <deque>
 #include <vector>
+#include <chrono>
 
 #include "PhasespacePointCloud.hh"
+#include "FitStrategy.hh"
 
 class FitResult;
 class RooAbsPdf;
@@ -51,21 +54,96 @@ class RooFitResult;
 class RooDataSet;
 
 class WibFitFunction;
+class FastPointMap;
+class WibTelemetry;
+class WibProgress;
 
 class WiBaS : public PhasespacePointCloud
 {
     public:
         WiBaS(WibFitFunction& pfitFunction);
+        ~WiBaS();
         void SetNearestNeighbors(unsigned int pnumNearestNeighbors);
         void AddPhasespacePoint(PhasespacePoint& newPhasespacePoint);
         void SaveNextFitToFile(std::string fileName);
         void SetCalcErrors(bool set=true);
+        void SetBinnedFit(unsigned int numBins);
+        void SetFitStrategy(const FitStrategy& fitStrategy);
         bool CalcWeight(PhasespacePoint &refPhasespacePoint);
+        unsigned long CalcWeights(std::vector<PhasespacePoint>& points, WibProgress* progress=NULL,
+                                  unsigned int worker=0);
+        void SetFitCache(bool enable=true, double jaccardThreshold=1., unsigned int maxEntries=10000);
+        unsigned long GetNumFits() const;
+        unsigned long GetNumCacheHits() const;
+        void PrintFitCacheStats() const;
+        void SetFitFallback(bool enable=true, unsigned int numStartAttempts=2, double neighborFactor=2.);
+        short int GetLastFitRung() const;
+        unsigned long GetNumFitRung(short int rung) const;
+        void PrintFitFallbackStats() const;
+        void SetTelemetry(WibTelemetry* telemetry, unsigned int source=0);
+        void SetReproducible(bool set=true);
+        virtual MemoryUsage GetMemoryUsage() const;
+        static MemoryUsage EstimateMemoryUsage(unsigned long numPoints, unsigned int numCoords,
+                                               unsigned int numNeighbors, unsigned int numWorkers=1,
+                                               unsigned int cacheEntries=0, unsigned int meanNameLength=2);
+        static unsigned int GetMaxWorkers(size_t memoryBudget, unsigned long numPoints, unsigned int numCoords,
+                                          unsigned int numNeighbors, unsigned int cacheEntries=0,
+                                          unsigned int meanNameLength=2);
+
+        static const short int FIT_NOMINAL;
+        static const short int FIT_START_VALUES;
+        static const short int FIT_FIXED_BACKGROUND;
+        static const short int FIT_MORE_NEIGHBORS;
+        static const short int FIT_NEIGHBOR_AVERAGE;
+        static const short int FIT_FAILED;
+        static const size_t CACHED_FIT_BYTES;
+
+    protected:
+        void SortByDistance(PhasespacePoint& refPhasespacePoint, std::vector<FastPointMap>& pointMapVector);
+        static unsigned int GetCutIndex(const std::vector<FastPointMap>& pointMapVector, double numNeighbors);
 
     private:
+        struct FitCacheEntry
+        {
+            std::vector<unsigned int> neighbors;
+            RooFitResult* rooFitResult;
+        };
+
         unsigned int numNearestNeighbors;
         WibFitFunction* fitFunction;
+        bool useFitCache;
+        double cacheJaccardThreshold;
+        unsigned int cacheMaxEntries;
+        std::map<unsigned long long, FitCacheEntry> fitCache;
+        std::deque<unsigned long long> fitCacheOrder;
+        unsigned long numFits;
+        unsigned long numCacheHits;
+        unsigned long numExactCacheHits;
+        double fitSeconds;
+        bool useFitFallback;
+        unsigned int numFallbackStarts;
+        double fallbackNeighborFactor;
+        short int lastFitRung;
+        std::vector<unsigned long> fitRungCounts;
+        std::vector<double> knownQ;
+        WibTelemetry* telemetry;
+        unsigned int telemetrySource;
+        unsigned long long numWeightCalls;
+        bool reproducible;
+
         bool CheckMassInRange(PhasespacePoint &refPhasespacePoint) const;
+        FitResult* FitNeighborhood(const std::vector<FastPointMap>& pointMapVector, unsigned int cutIndex,
+                                   PhasespacePoint& refPhasespacePoint, bool useCache);
+        FitResult* RetryFit(const std::vector<FastPointMap>& pointMapVector, unsigned int cutIndex,
+                            PhasespacePoint& refPhasespacePoint);
+        static bool IsConverged(const FitResult* fitResult);
+        void PushTelemetry(const FitResult* fitResult, double q, short int clip, unsigned int numNeighbors,
+                           std::chrono::steady_clock::time_point start);
+        const RooFitResult* FindCachedFit(const std::vector<unsigned int>& neighbors, bool& exact) const;
+        void StoreFit(const std::vector<unsigned int>& neighbors, const RooFitResult& rooFitResult);
+        void ClearFitCache();
+        static unsigned long long HashNeighbors(const std::vector<unsigned int>& neighbors);
+        static double GetJaccardIndex(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b);
  };
 
 
@@ -0,0 +1,289 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ColumnarPointFile.hh"
+#include "PhasespacePoint.hh"
+
+
+
+const unsigned int ColumnarPointFile::NUM_EXTRA_COLUMNS = 3;
+
+namespace {
+
+    const char FILE_MAGIC[8] = {'W', 'I', 'B', 'A', 'S', 'C', 'O', 'L'};
+    const uint32_t FILE_VERSION = 1;
+    const size_t COLUMN_ALIGNMENT = 4096;
+}
+
+
+
+
+ColumnarPointFile::ColumnarPointFile(const std::string& fileName) :
+    _fileName(fileName),
+    _numPoints(0),
+    _headerSize(0),
+    _fileSize(0),
+    _data(NULL),
+    _writable(false)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+
+    if(fd < 0){
+        std::cerr << "ERROR: could not open columnar file " << fileName << std::endl;
+        return;
+    }
+
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t numCoords = 0;
+    uint64_t numPoints = 0;
+    off_t offset = 0;
+
+    bool ok = (pread(fd, magic, 8, offset) == 8) &&
+              (pread(fd, &version, 4, offset + 8) == 4) &&
+              (pread(fd, &numCoords, 4, offset + 12) == 4) &&
+              (pread(fd, &numPoints, 8, offset + 16) == 8);
+    offset += 24;
+
+    ok = ok && (memcmp(magic, FILE_MAGIC, 8) == 0) && (version == FILE_VERSION);
+
+    for(uint32_t i=0; ok && i<numCoords; i++){
+        uint32_t length = 0;
+        ok = (pread(fd, &length, 4, offset) == 4);
+        std::vector<char> name(length);
+        ok = ok && (length == 0 || pread(fd, &name[0], length, offset + 4) == static_cast<ssize_t>(length));
+        _coordNames.push_back(std::string(name.begin(), name.end()));
+        offset += 4 + length;
+    }
+
+    struct stat fileStat;
+    ok = ok && (fstat(fd, &fileStat) == 0);
+
+    if(ok){
+        _numPoints = numPoints;
+        _headerSize = ((offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT) * COLUMN_ALIGNMENT;
+        _fileSize = _headerSize + (numCoords + NUM_EXTRA_COLUMNS) * _numPoints * sizeof(double);
+        ok = (static_cast<size_t>(fileStat.st_size) == _fileSize);
+    }
+
+    if(!ok){
+        std::cerr << "ERROR: " << fileName << " is not a valid columnar point file" << std::endl;
+        _coordNames.clear();
+        _numPoints = 0;
+        close(fd);
+        return;
+    }
+
+    Map(fd, false);
+    close(fd);
+}
+
+
+
+ColumnarPointFile::ColumnarPointFile(const std::string& fileName, const std::vector<std::string>& coordNames,
+                                     unsigned long numPoints) :
+    _fileName(fileName),
+    _coordNames(coordNames),
+    _numPoints(numPoints),
+    _headerSize(0),
+    _fileSize(0),
+    _data(NULL),
+    _writable(true)
+{
+    size_t headerSize = 24;
+    for(auto it = coordNames.begin(); it != coordNames.end(); ++it){
+        headerSize += 4 + it->size();
+    }
+
+    _headerSize = ((headerSize + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT) * COLUMN_ALIGNMENT;
+    _fileSize = _headerSize + (coordNames.size() + NUM_EXTRA_COLUMNS) * _numPoints * sizeof(double);
+
+    int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if(fd < 0 || ftruncate(fd, _fileSize) != 0){
+        std::cerr << "ERROR: could not create columnar file " << fileName << std::endl;
+        if(fd >= 0)
+            close(fd);
+        return;
+    }
+
+    Map(fd, true);
+    close(fd);
+
+    if(_data == NULL)
+        return;
+
+    uint32_t version = FILE_VERSION;
+    uint32_t numCoords = coordNames.size();
+    uint64_t numPoints64 = numPoints;
+    char* header = _data;
+
+    memcpy(header, FILE_MAGIC, 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &numCoords, 4);
+    memcpy(header + 16, &numPoints64, 8);
+    header += 24;
+
+    for(auto it = coordNames.begin(); it != coordNames.end(); ++it){
+        uint32_t length = it->size();
+        memcpy(header, &length, 4);
+        memcpy(header + 4, it->data(), length);
+        header += 4 + length;
+    }
+}
+
+
+
+ColumnarPointFile::~ColumnarPointFile(){
+
+    if(_data != NULL)
+        munmap(_data, _fileSize);
+}
+
+
+
+void ColumnarPointFile::Map(int fd, bool writable){
+
+    if(_fileSize == 0)
+        return;
+
+    void* address = mmap(NULL, _fileSize, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                         MAP_SHARED, fd, 0);
+
+    if(address == MAP_FAILED){
+        std::cerr << "ERROR: could not map columnar file " << _fileName << std::endl;
+        return;
+    }
+
+    _data = static_cast<char*>(address);
+}
+
+
+
+int ColumnarPointFile::GetCoordIndex(const std::string& name) const {
+
+    for(unsigned int i=0; i<_coordNames.size(); i++){
+        if(_coordNames[i] == name)
+            return i;
+    }
+
+    return -1;
+}
+
+
+
+double* ColumnarPointFile::GetColumn(unsigned int column) const {
+
+    if(_data == NULL)
+        return NULL;
+
+    return reinterpret_cast<double*>(_data + _headerSize) + column * _numPoints;
+}
+
+
+
+void ColumnarPointFile::SetPoint(unsigned long index, const PhasespacePoint& point){
+
+    if(!_writable || _data == NULL || index >= _numPoints){
+        throw PhasespacePoint::ERR_INDEX_OVERFLOW;
+    }
+
+    if(point.coordValueMap.size() != _coordNames.size()){
+        throw PhasespacePoint::ERR_METRIC_MISMATCH;
+    }
+
+    for(unsigned int i=0; i<_coordNames.size(); i++){
+        auto it = point.coordValueMap.find(_coordNames[i]);
+
+        if(it == point.coordValueMap.end()){
+            throw PhasespacePoint::ERR_UNKNOWN_COORDINATE;
+        }
+
+        GetColumn(i)[index] = it->second;
+    }
+
+    GetColumn(_coordNames.size())[index] = point.GetInitialWeight();
+    GetColumn(_coordNames.size() + 1)[index] = point.GetMass();
+    GetColumn(_coordNames.size() + 2)[index] = point.IsMass2Set() ? point.GetMass2() :
+                                               std::numeric_limits<double>::quiet_NaN();
+}
+
+
+
+void ColumnarPointFile::Advise(unsigned long first, unsigned long num, int advice) const {
+
+    if(_data == NULL || first >= _numPoints)
+        return;
+
+    num = std::min(num, _numPoints - first);
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    for(unsigned int column=0; column < _coordNames.size() + NUM_EXTRA_COLUMNS; column++){
+        char* begin = reinterpret_cast<char*>(GetColumn(column) + first);
+        char* end = reinterpret_cast<char*>(GetColumn(column) + first + num);
+        char* alignedBegin = _data + ((begin - _data) / pageSize) * pageSize;
+        madvise(alignedBegin, end - alignedBegin, advice);
+    }
+}
+
+
+
+void ColumnarPointFile::Prefetch(unsigned long first, unsigned long num) const {
+
+    Advise(first, num, MADV_WILLNEED);
+}
+
+
+
+void ColumnarPointFile::Release(unsigned long first, unsigned long num) const {
+
+    // Dropping the pages of a shared file mapping only reduces the resident
+    // set, the data is read again from the file on the next access
+    Advise(first, num, MADV_DONTNEED);
+}
@@ -40,19 +40,32 @@
 #include <algorithm>
 #include <thread>
 #include <sstream>
+#include <random>
+#include <future>
+#include <memory>
 
 #include "TTree.h"
 #include "TFile.h"
 #include "TH1F.h"
+#include "TMath.h"
 
 #include "EnergyTest.hh"
 #include "PhasespacePoint.hh"
+#include "KernelTree.hh"
+#include "EnergyTestState.hh"
+#include "ColumnarPointFile.hh"
+#include "PointColumns.hh"
+#include "EnergyKernels.hh"
 
 
 
 
 const short EnergyTest::DISTANCE_LOG = 1;
 const short EnergyTest::DISTANCE_GAUSS = 2;
+const short EnergyTest::SUMMATION_EXACT = 1;
+const short EnergyTest::SUMMATION_TREE = 2;
+
+
 
 
 
@@ -62,7 +75,11 @@ EnergyTest::EnergyTest(short distFunc, bool writelog) :
     _initialized(false),
     _epsilon(1E-6),
     _gauss2sigsq(0.04),
-    _distanceFunc(distFunc)
+    _distanceFunc(distFunc),
+    _summationMode(SUMMATION_EXACT),
+    _treeTolerance(1E-2),
+    _phiErrorBound(0),
+    _reproducible(false)
 {
     std::ostringstream filename;
 
@@ -91,6 +108,28 @@ EnergyTest::EnergyTest(short distFunc, bool writelog) :
 
 
 
+void EnergyTest::SetSummationMode(short mode, double relTolerance){
+
+    if(mode == SUMMATION_TREE && _distanceFunc != DISTANCE_LOG){
+        _log << "WARNING: tree summation is only available for the log distance function, "
+             << "using exact summation\n";
+        mode = SUMMATION_EXACT;
+    }
+
+    if(mode == SUMMATION_TREE){
+        _log << "INFO: using tree summation with relative tolerance " << relTolerance << "\n";
+    }
+    else if(mode != SUMMATION_EXACT){
+        _log << "ERROR: summation mode does not exist\n";
+        mode = SUMMATION_EXACT;
+    }
+
+    _summationMode = mode;
+    _treeTolerance = relTolerance;
+}
+
+
+
 void EnergyTest::AddPhasespacePointData(PhasespacePoint& newPhasespacePoint){
     PhasespacePointCloud::AddPhasespacePoint(newPhasespacePoint, 1);
 }
@@ -110,66 +149,137 @@ double EnergyTest::GetPhi(const std::vector<PhasespacePoint*>& phasespacePointVe
         Initialize();
     }
 
+    if(_summationMode == SUMMATION_TREE){
+        double errorBound;
+        return GetPhiTree(phasespacePointVectorData, phasespacePointVectorFit, errorBound);
+    }
+
+    std::vector<double> norms;
+    std::vector<bool> isCircular;
+    GetNormalization(norms, isCircular);
+
+    std::vector<double> invNorms;
+    for(auto it = norms.begin(); it != norms.end(); ++it){
+        invNorms.push_back(1. / *it);
+    }
+
+    PointColumns dataColumns;
+    PointColumns fitColumns;
+    dataColumns.Fill(phasespacePointVectorData, invNorms);
+    fitColumns.Fill(phasespacePointVectorFit, invNorms);
+
     double sumOfWeightsData=0;
     double sumOfWeightsFit=0;
     double sumRData=0;
     double sumRDataFit=0;
 
-    int numData = phasespacePointVectorData.size();
-    int numFit = phasespacePointVectorFit.size();
+    for(unsigned int i=0; i<dataColumns.GetNumPoints(); i++){
+        sumOfWeightsData += dataColumns.GetWeights()[i];
+    }
 
-    for(int i=0; i<numData;i++){
+    for(unsigned int i=0; i<fitColumns.GetNumPoints(); i++){
+        sumOfWeightsFit += fitColumns.GetWeights()[i];
+    }
 
-        sumOfWeightsData += phasespacePointVectorData.at(i)->GetInitialWeight();
+    if(_distanceFunc == EnergyTest::DISTANCE_GAUSS){
+        EnergyGaussKernel kernel(_gauss2sigsq);
+        sumRData = EnergyPairSums::Sum(dataColumns, dataColumns, isCircular, true, kernel);
+        sumRDataFit = EnergyPairSums::Sum(dataColumns, fitColumns, isCircular, false, kernel);
+    }
+    else if(_distanceFunc == EnergyTest::DISTANCE_LOG){
+        EnergyLogKernel kernel(_epsilon);
+        sumRData = EnergyPairSums::Sum(dataColumns, dataColumns, isCircular, true, kernel);
+        sumRDataFit = EnergyPairSums::Sum(dataColumns, fitColumns, isCircular, false, kernel);
+    }
 
-        if(i==numData-1)
-            break;
+    sumRData /= (sumOfWeightsData * sumOfWeightsData);
+    sumRDataFit /= (sumOfWeightsData * sumOfWeightsFit);
 
-        for(int j=i+1; j<numData;j++){
+    double phi = sumRData - sumRDataFit;
+    _log << "INFO: calculated energy " << phi << "\n";
+    _log << "INFO: data weight =  " << sumOfWeightsData << " fit weight = " << sumOfWeightsFit << "\n";
 
-            if(_distanceFunc == EnergyTest::DISTANCE_GAUSS){
-                sumRData += phasespacePointVectorData.at(i)->GetInitialWeight() *
-                   phasespacePointVectorData.at(j)->GetInitialWeight() *
-                   RGauss(CalcPhasespaceDistance(phasespacePointVectorData.at(i),
-                                 phasespacePointVectorData.at(j)));
-            }
-            else if(_distanceFunc == EnergyTest::DISTANCE_LOG){
-                sumRData += phasespacePointVectorData[i]->GetInitialWeight() *
-                   phasespacePointVectorData.at(j)->GetInitialWeight() *
-                   Rlog(CalcPhasespaceDistance(phasespacePointVectorData.at(i),
-                               phasespacePointVectorData.at(j)));
-            }
+    return phi;
+}
+
+
+
+double EnergyTest::GetPhi(){
+    auto _phasespacePointVectorData = GetPointVector(1);
+    auto _phasespacePointVectorFit = GetPointVector(2);
+
+    _phiErrorBound = 0;
 
+    if(_summationMode == SUMMATION_TREE){
+        if(!_initialized){
+            Initialize();
         }
+        return GetPhiTree(_phasespacePointVectorData, _phasespacePointVectorFit, _phiErrorBound);
+    }
+
+    return GetPhi(_phasespacePointVectorData, _phasespacePointVectorFit);
+}
 
+
+
+void EnergyTest::GetNormalization(std::vector<double>& norms, std::vector<bool>& isCircular){
+
+    auto& coordNameMap = GetCoordNameMap();
+    norms.resize(coordNameMap.size());
+    isCircular.resize(coordNameMap.size());
+
+    for(auto it=coordNameMap.begin(); it!=coordNameMap.end();++it){
+        norms.at(it->second.GetID()) = it->second.GetNorm();
+        isCircular.at(it->second.GetID()) = it->second.GetIsCircular();
     }
+}
 
-    sumRData /= (sumOfWeightsData * sumOfWeightsData);
 
-    for(int i=0; i<numFit;i++){
 
-        sumOfWeightsFit += phasespacePointVectorFit.at(i)->GetInitialWeight();
-        for(int j=0; j<numData;j++){
+double EnergyTest::GetPhiTree(const std::vector<PhasespacePoint*>& phasespacePointVectorData,
+                              const std::vector<PhasespacePoint*>& phasespacePointVectorFit,
+                              double& errorBound){
 
-            if(_distanceFunc == EnergyTest::DISTANCE_GAUSS){
-                sumRDataFit += phasespacePointVectorFit.at(i)->GetInitialWeight() *
-                   phasespacePointVectorData.at(j)->GetInitialWeight() *
-                   RGauss(CalcPhasespaceDistance(phasespacePointVectorFit.at(i),
-                                 phasespacePointVectorData.at(j)));
-            }
-            else if(_distanceFunc == EnergyTest::DISTANCE_LOG){
-                sumRDataFit += phasespacePointVectorFit.at(i)->GetInitialWeight() *
-                   phasespacePointVectorData.at(j)->GetInitialWeight() *
-                   Rlog(CalcPhasespaceDistance(phasespacePointVectorFit.at(i),
-                               phasespacePointVectorData.at(j)));
-            }
-        }
+    std::vector<double> norms;
+    std::vector<bool> isCircular;
+    GetNormalization(norms, isCircular);
+
+    KernelTree dataTree(phasespacePointVectorData, norms, isCircular);
+    KernelTree fitTree(phasespacePointVectorFit, norms, isCircular);
+
+    double sumOfWeightsData=0;
+    double sumOfWeightsFit=0;
+    double sumRData=0;
+    double sumRDataFit=0;
+    double errorRData=0;
+    double errorRDataFit=0;
+    std::vector<double> target(norms.size());
+
+    // Each data pair is visited twice when summing the full rows
+    for(auto it = phasespacePointVectorData.begin(); it != phasespacePointVectorData.end(); ++it){
+        double weight = (*it)->GetInitialWeight();
+        double rowError;
+        sumOfWeightsData += weight;
+        dataTree.NormalizePoint(*it, &target[0]);
+
+        sumRData += 0.5 * weight * dataTree.SumLogKernel(&target[0], *it, _epsilon, _treeTolerance, rowError);
+        errorRData += 0.5 * fabs(weight) * rowError;
+
+        sumRDataFit += weight * fitTree.SumLogKernel(&target[0], NULL, _epsilon, _treeTolerance, rowError);
+        errorRDataFit += fabs(weight) * rowError;
+    }
+
+    for(auto it = phasespacePointVectorFit.begin(); it != phasespacePointVectorFit.end(); ++it){
+        sumOfWeightsFit += (*it)->GetInitialWeight();
     }
 
+    sumRData /= (sumOfWeightsData * sumOfWeightsData);
     sumRDataFit /= (sumOfWeightsData * sumOfWeightsFit);
+    errorBound = errorRData / (sumOfWeightsData * sumOfWeightsData) +
+                 errorRDataFit / fabs(sumOfWeightsData * sumOfWeightsFit);
 
     double phi = sumRData - sumRDataFit;
-    _log << "INFO: calculated energy " << phi << "\n";
+    _log << "INFO: calculated energy " << phi << " (tree summation, error bound " << errorBound << ")\n";
     _log << "INFO: data weight =  " << sumOfWeightsData << " fit weight = " << sumOfWeightsFit << "\n";
 
     return phi;
@@ -177,14 +287,6 @@ double EnergyTest::GetPhi(const std::vector<PhasespacePoint*>& phasespacePointVe
 
 
 
-double EnergyTest::GetPhi(){
-    auto _phasespacePointVectorData = GetPointVector(1);
-    auto _phasespacePointVectorFit = GetPointVector(2);
-    return GetPhi(_phasespacePointVectorData, _phasespacePointVectorFit);
-}
-
-
-
 void EnergyTest::Initialize(){
 
     auto& _phasespacePointVectorData = GetPointVector(1);
@@ -258,6 +360,212 @@ void EnergyTest::Initialize(){
 
 
 
+bool EnergyTest::InitializeStreamed(const ColumnarPointFile& fitFile, const std::vector<int>& fitColumns,
+                                    double& scaleFitWeights){
+
+    auto& _phasespacePointVectorData = GetPointVector(1);
+    auto& coordNameMap = GetCoordNameMap();
+    unsigned long numFit = fitFile.GetNumPoints();
+    const unsigned long chunkSize = 1 << 16;
+
+    if(_phasespacePointVectorData.empty() || numFit == 0){
+        _log << "ERROR: streamed energy test requires data and fit points\n";
+        return false;
+    }
+
+    // Normalize the initial data weights wo a mean of 1.0
+    double sumOfWeightsData = 0;
+    for(auto it = _phasespacePointVectorData.begin(); it != _phasespacePointVectorData.end(); ++it){
+        sumOfWeightsData += (*it)->GetInitialWeight();
+    }
+
+    double scaleDataWeights = _phasespacePointVectorData.size() / sumOfWeightsData;
+    for(auto it = _phasespacePointVectorData.begin(); it != _phasespacePointVectorData.end(); ++it){
+        (*it)->SetInitialWeight((*it)->GetInitialWeight() * scaleDataWeights);
+    }
+
+    // Weighted means and variances of the fit sample in one streamed pass
+    // (West's algorithm). The weight normalization cancels in both.
+    unsigned int numDims = fitColumns.size();
+    std::vector<double> means(numDims, 0);
+    std::vector<double> sumsOfSquares(numDims, 0);
+    double sumOfWeightsFit = 0;
+    double f0max = 0;
+    const double* weights = fitFile.GetWeightColumn();
+
+    for(unsigned long first = 0; first < numFit; first += chunkSize){
+        unsigned long last = std::min(first + chunkSize, numFit);
+        fitFile.Prefetch(last, chunkSize);
+
+        for(unsigned long i=first; i<last; i++){
+            double weight = weights[i];
+            sumOfWeightsFit += weight;
+            f0max = std::max(f0max, weight);
+
+            for(unsigned int d=0; d<numDims; d++){
+                double x = fitFile.GetCoordColumn(fitColumns[d])[i];
+                double delta = x - means[d];
+                means[d] += delta * weight / sumOfWeightsFit;
+                sumsOfSquares[d] += weight * delta * (x - means[d]);
+            }
+        }
+
+        fitFile.Release(first, last - first);
+    }
+
+    scaleFitWeights = numFit / sumOfWeightsFit;
+
+    for(auto it=coordNameMap.begin(); it!=coordNameMap.end();++it){
+
+        int id = it->second.GetID();
+        double norm = sqrt(sumsOfSquares[id] / sumOfWeightsFit);
+
+        if(it->second.GetIsCircular() == true){
+            _log << "INFO: Norm of " << (*it).first << " /= 2\n";
+            norm /= 2.;
+        }
+
+        it->second.SetNorm(norm);
+        _log << "INFO: Norm of " << (*it).first << " = " << norm << " Mean = " << means[id] << "\n";
+    }
+
+    // Calculate _epsilon from maximum weight
+    f0max *= scaleFitWeights;
+    _epsilon = 1. / (numFit * f0max * 5.);
+
+    _log << "INFO: f0max = " << f0max << " epsilon = " << _epsilon << "\n";
+    _initialized = true;
+
+    return true;
+}
+
+
+
+double EnergyTest::GetPhiStreamed(const std::string& fitFileName, size_t memoryBudget){
+
+    ColumnarPointFile fitFile(fitFileName);
+
+    if(!fitFile.IsOpen()){
+        _log << "ERROR: could not open fit sample " << fitFileName << "\n";
+        return 0;
+    }
+
+    // Map the registered coordinates to the file columns
+    auto& coordNameMap = GetCoordNameMap();
+    std::vector<int> fitColumns(coordNameMap.size(), -1);
+
+    for(auto it=coordNameMap.begin(); it!=coordNameMap.end();++it){
+        fitColumns.at(it->second.GetID()) = fitFile.GetCoordIndex(it->first);
+
+        if(fitColumns.at(it->second.GetID()) < 0){
+            _log << "ERROR: coordinate " << it->first << " not found in " << fitFileName << "\n";
+            return 0;
+        }
+    }
+
+    double scaleFitWeights;
+    if(!InitializeStreamed(fitFile, fitColumns, scaleFitWeights)){
+        return 0;
+    }
+
+    std::vector<double> norms;
+    std::vector<bool> isCircular;
+    GetNormalization(norms, isCircular);
+
+    std::vector<double> invNorms;
+    for(auto it = norms.begin(); it != norms.end(); ++it){
+        invNorms.push_back(1. / *it);
+    }
+
+    // The data sample stays resident, the fit sample is streamed in tiles
+    // into two buffers: one is filled while the other one is processed.
+    unsigned int numDims = norms.size();
+    unsigned long numFit = fitFile.GetNumPoints();
+    PointColumns dataColumns;
+    dataColumns.Fill(GetPointVector(1), invNorms);
+
+    size_t residentBytes = dataColumns.GetMemoryUsage();
+    size_t tileBytes = (memoryBudget > residentBytes) ? (memoryBudget - residentBytes) / 2 : 0;
+    unsigned long tileSize = tileBytes / PointColumns::GetBytesPerPoint(numDims);
+    const unsigned long minTileSize = 1024;
+
+    if(tileSize < minTileSize){
+        _log << "WARNING: memory budget of " << memoryBudget << " bytes too small, using tiles of "
+             << minTileSize << " points\n";
+        tileSize = minTileSize;
+    }
+    tileSize = std::min(tileSize, numFit);
+
+    PointColumns tiles[2];
+    tiles[0].Reserve(numDims, tileSize);
+    tiles[1].Reserve(numDims, tileSize);
+
+    auto loadTile = [&](unsigned long first, PointColumns& tile){
+        unsigned long num = std::min(tileSize, numFit - first);
+        tile.SetNumPoints(num);
+        fitFile.Prefetch(first + num, tileSize);
+
+        for(unsigned int d=0; d<numDims; d++){
+            const double* source = fitFile.GetCoordColumn(fitColumns[d]) + first;
+            double* column = tile.GetColumn(d);
+            for(unsigned long i=0; i<num; i++){
+                column[i] = source[i] * invNorms[d];
+            }
+        }
+
+        const double* source = fitFile.GetWeightColumn() + first;
+        double* weights = tile.GetWeights();
+        for(unsigned long i=0; i<num; i++){
+            weights[i] = source[i] * scaleFitWeights;
+        }
+
+        fitFile.Release(first, num);
+    };
+
+    bool useGauss = (_distanceFunc == DISTANCE_GAUSS);
+    EnergyGaussKernel gaussKernel(_gauss2sigsq);
+    EnergyLogKernel logKernel(_epsilon);
+    double sumRData = useGauss ? EnergyPairSums::Sum(dataColumns, dataColumns, isCircular, true, gaussKernel) :
+                                 EnergyPairSums::Sum(dataColumns, dataColumns, isCircular, true, logKernel);
+    double sumRDataFit = 0;
+    double sumOfWeightsData = 0;
+    double sumOfWeightsFit = 0;
+
+    for(unsigned int i=0; i<dataColumns.GetNumPoints(); i++){
+        sumOfWeightsData += dataColumns.GetWeights()[i];
+    }
+
+    unsigned long numTiles = (numFit + tileSize - 1) / tileSize;
+    std::future<void> nextTile = std::async(std::launch::async, loadTile, 0UL, std::ref(tiles[0]));
+
+    for(unsigned long t=0; t<numTiles; t++){
+        nextTile.get();
+        PointColumns& tile = tiles[t % 2];
+
+        if(t + 1 < numTiles){
+            nextTile = std::async(std::launch::async, loadTile, (t + 1) * tileSize, std::ref(tiles[(t + 1) % 2]));
+        }
+
+        sumRDataFit += useGauss ? EnergyPairSums::Sum(dataColumns, tile, isCircular, false, gaussKernel) :
+                                  EnergyPairSums::Sum(dataColumns, tile, isCircular, false, logKernel);
+
+        for(unsigned int i=0; i<tile.GetNumPoints(); i++){
+            sumOfWeightsFit += tile.GetWeights()[i];
+        }
+    }
+
+    sumRData /= (sumOfWeightsData * sumOfWeightsData);
+    sumRDataFit /= (sumOfWeightsData * sumOfWeightsFit);
+
+    double phi = sumRData - sumRDataFit;
+    _log << "INFO: calculated energy " << phi << " (streamed " << numTiles << " tiles of " << tileSize << " points)\n";
+    _log << "INFO: data weight =  " << sumOfWeightsData << " fit weight = " << sumOfWeightsFit << "\n";
+
+    return phi;
+}
+
+
+
 std::vector<double> EnergyTest::GetResampledPhis(long n, short threads, unsigned int seed){
 
     _log << "INFO: resampling " << n << " times using " << threads << " threads\n";
@@ -268,14 +576,20 @@ std::vector<double> EnergyTest::GetResampledPhis(long n, short threads, unsigned
         f.close();
     }
 
-    srand(seed);
+    if(!_reproducible)
+        srand(seed);
 
+    // In the reproducible mode every resample draws from its own generator,
+    // seeded with the seed and its number, and rand() is not touched.
+    // Thread i does the resamples i*n ... (i+1)*n-1, so the phis do not
+    // depend on the number of threads.
     std::vector<std::thread> theThreads;
     std::vector<std::vector<double> > tPhis;
     tPhis.resize(threads);
 
     for(int i = 0; i<threads;i++){
-        theThreads.push_back(std::thread(&EnergyTest::Threadfunc, this, n, std::ref(tPhis[i])));
+        long firstResample = _reproducible ? i * n : -1;
+        theThreads.push_back(std::thread(&EnergyTest::Threadfunc, this, n, std::ref(tPhis[i]), firstResample, seed));
     }
     for(auto it = theThreads.begin(); it != theThreads.end(); ++it){
         (*it).join();
@@ -291,7 +605,65 @@ std::vector<double> EnergyTest::GetResampledPhis(long n, short threads, unsigned
 }
 
 
-void EnergyTest::Threadfunc(long n, std::vector<double>& phis){
+PValueResult EnergyTest::GetPValue(double threshold, long maxResamples, short threads, long batchSize,
+                                   double confidenceLevel, unsigned int seed){
+
+    PValueResult result;
+    result.phi = GetPhi();
+
+    // Two-sided Wilson score interval on the fraction of resampled phis
+    // above phi. The interval is checked after every batch, so the error
+    // rate 1 - confidenceLevel is split evenly over the possible looks
+    // (Bonferroni): the probability that any of the intervals misses the
+    // true p-value stays below 1 - confidenceLevel. The last batch may
+    // exceed maxResamples by up to one batch.
+    long resamplesPerThread = std::max(1L, (batchSize + threads - 1) / threads);
+    long resamplesPerBatch = resamplesPerThread * threads;
+    long numLooks = std::max(1L, (maxResamples + resamplesPerBatch - 1) / resamplesPerBatch);
+    double z = TMath::NormQuantile(1. - 0.5 * (1. - confidenceLevel) / numLooks);
+    unsigned int batch = 0;
+
+    while(result.numResamples < maxResamples){
+
+        unsigned int batchSeed = (seed == 0) ? 0 : seed + batch;
+        std::vector<double> phis = GetResampledPhis(resamplesPerThread, threads, batchSeed);
+        batch++;
+
+        for(auto it = phis.begin(); it != phis.end(); ++it){
+            if(result.phi < *it)
+                result.numExceeding++;
+        }
+        result.numResamples += phis.size();
+
+        double n = result.numResamples;
+        double p = result.numExceeding / n;
+        double center = (p + z * z / (2. * n)) / (1. + z * z / n);
+        double halfWidth = z / (1. + z * z / n) * sqrt(p * (1. - p) / n + z * z / (4. * n * n));
+
+        result.pValue = p;
+        // The limits are exactly 0 and 1 at p = 0 and 1, not off by rounding
+        result.lowerLimit = (result.numExceeding == 0) ? 0. : std::max(0., center - halfWidth);
+        result.upperLimit = (result.numExceeding == result.numResamples) ? 1. : std::min(1., center + halfWidth);
+
+        if(result.upperLimit < threshold || result.lowerLimit > threshold){
+            result.decided = true;
+            break;
+        }
+    }
+
+    _log << "INFO: p-value " << result.pValue << " [" << result.lowerLimit << ", " << result.upperLimit
+         << "] after " << result.numResamples << " resamples\n";
+
+    if(!result.decided){
+        _log << "WARNING: p-value undecided at threshold " << threshold << "\n";
+    }
+
+    return result;
+}
+
+
+
+void EnergyTest::Threadfunc(long n, std::vector<double>& phis, long firstResample, unsigned int seed){
 
     phis.clear();
     std::vector<PhasespacePoint*> phasespacePointVectorData;
@@ -313,7 +685,18 @@ void EnergyTest::Threadfunc(long n, std::vector<double>& phis){
         throw;
     }
 
+    // Only the reproducible mode draws from its own generator, reseeded
+    // per resample
+    std::unique_ptr<std::mt19937> generator;
+    if(firstResample >= 0)
+        generator.reset(new std::mt19937);
+
     for(int i = 0; i < n;i++){
+        if(firstResample >= 0){
+            std::seed_seq seedSequence{seed, static_cast<unsigned int>(firstResample + i)};
+            generator->seed(seedSequence);
+        }
+
         phasespacePointVectorFit.clear();
         phasespacePointVectorData.clear();
         phasespacePointVectorTemp.clear();
@@ -325,7 +708,8 @@ void EnergyTest::Threadfunc(long n, std::vector<double>& phis){
 
         double resamplesumofweights=0;
         while(true){
-            long index = rand() % phasespacePointVectorTemp.size();
+            unsigned long draw = (firstResample >= 0) ? (*generator)() : rand();
+            long index = draw % phasespacePointVectorTemp.size();
             resamplesumofweights += phasespacePointVectorTemp.at(index)->GetInitialWeight();
 
             // use copies for better performance
@@ -357,3 +741,121 @@ void EnergyTest::Threadfunc(long n, std::vector<double>& phis){
     }
 }
 
+
+
+
+std::vector<double> EnergyTest::GetSwapChainPhis(long n, unsigned int swapsPerStep, long burnIn, unsigned int seed){
+
+    _log << "INFO: swap chain with " << n << " steps of " << swapsPerStep << " swaps, burn-in " << burnIn << "\n";
+
+    if(seed == 0){
+        ifstream f("/dev/urandom");
+        f.read(reinterpret_cast<char*>(&seed), sizeof(seed));
+        f.close();
+    }
+
+    // Each step exchanges random pairs of data and fit points, keeping the
+    // subset sizes fixed. The first steps are correlated with the observed
+    // split and should be discarded via burnIn.
+    EnergyTestState state(*this);
+    std::mt19937 generator(seed);
+    std::vector<unsigned int> dataIndices;
+    std::vector<unsigned int> fitIndices;
+    std::vector<double> phis;
+
+    for(unsigned int i=0; i<state.GetNumPoints(); i++){
+        (state.IsData(i) ? dataIndices : fitIndices).push_back(i);
+    }
+
+    if(dataIndices.empty() || fitIndices.empty()){
+        _log << "ERROR: swap chain requires data and fit points\n";
+        return phis;
+    }
+
+    std::uniform_int_distribution<unsigned int> dataDist(0, dataIndices.size() - 1);
+    std::uniform_int_distribution<unsigned int> fitDist(0, fitIndices.size() - 1);
+
+    for(long i=0; i < burnIn + n; i++){
+        for(unsigned int j=0; j<swapsPerStep; j++){
+            unsigned int& dataIndex = dataIndices[dataDist(generator)];
+            unsigned int& fitIndex = fitIndices[fitDist(generator)];
+            state.Swap(dataIndex, fitIndex);
+            std::swap(dataIndex, fitIndex);
+        }
+
+        if(i >= burnIn){
+            phis.push_back(state.GetPhi());
+        }
+    }
+
+    return phis;
+}
+
+
+
+MemoryUsage EnergyTest::GetMemoryUsage() const {
+
+    // Peak of a single GetPhi
+    return GetResamplingMemoryUsage(0);
+}
+
+
+
+MemoryUsage EnergyTest::GetResamplingMemoryUsage(short threads) const {
+
+    // The points are stored with the data in subset 1 and the fit in subset 2
+    unsigned long numData = GetNumPoints(1);
+    unsigned long numFit = GetNumPoints(2);
+    unsigned int numCoords = GetNumCoords();
+
+    MemoryUsage usage = PhasespacePointCloud::GetMemoryUsage();
+    size_t numPoints = numData + numFit;
+    size_t pointBytes = MemoryUsage::GetPointBytes() + ((numPoints > 0) ? usage.coordinateMaps / numPoints : 0);
+
+    usage.energyTest = GetWorkspaceBytes(numData, numFit, numCoords, threads, _summationMode, pointBytes);
+
+    return usage;
+}
+
+
+
+MemoryUsage EnergyTest::EstimateMemoryUsage(unsigned long numData, unsigned long numFit, unsigned int numCoords,
+                                            short threads, short summationMode, unsigned int meanNameLength){
+
+    MemoryUsage usage = PhasespacePointCloud::EstimateMemoryUsage(numData, numCoords, meanNameLength);
+    usage += PhasespacePointCloud::EstimateMemoryUsage(numFit, numCoords, meanNameLength);
+
+    size_t pointBytes = MemoryUsage::GetPointBytes() + MemoryUsage::GetCoordinateBytes(numCoords, meanNameLength);
+    usage.energyTest = GetWorkspaceBytes(numData, numFit, numCoords, threads, summationMode, pointBytes);
+
+    return usage;
+}
+
+
+
+size_t EnergyTest::GetWorkspaceBytes(unsigned long numData, unsigned long numFit, unsigned int numCoords,
+                                     short threads, short summationMode, size_t pointBytes){
+
+    // Coordinate columns or kd-trees of one GetPhi call
+    size_t phiBytes;
+
+    if(summationMode == SUMMATION_TREE){
+        phiBytes = KernelTree::EstimateMemoryUsage(numData, numCoords) + KernelTree::EstimateMemoryUsage(numFit, numCoords);
+    }
+    else{
+        phiBytes = MemoryUsage::GetVectorBytes(numData * (numCoords + 1), sizeof(double)) +
+                   MemoryUsage::GetVectorBytes(numFit * (numCoords + 1), sizeof(double));
+    }
+
+    if(threads <= 0)
+        return phiBytes;
+
+    // Every resampling thread copies all points and keeps three pointer
+    // vectors besides its own GetPhi workspace
+    size_t numPoints = numData + numFit;
+    size_t threadBytes = numPoints * pointBytes +
+                         MemoryUsage::GetVectorBytes(MemoryUsage::GetGrownCapacity(numPoints), sizeof(PhasespacePoint*)) * 3 +
+                         phiBytes;
+
+    return threads * threadBytes;
+}
@@ -0,0 +1,207 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <iostream>
+
+#include "EnergyTestState.hh"
+#include "EnergyTest.hh"
+#include "PhasespacePoint.hh"
+#include "EnergyKernels.hh"
+
+
+
+EnergyTestState::EnergyTestState(EnergyTest& energyTest) :
+    _energyTest(&energyTest),
+    _numData(0),
+    _sumRData(0),
+    _sumRDataFit(0),
+    _sumOfWeightsData(0),
+    _sumOfWeightsFit(0)
+{
+    if(!_energyTest->_initialized){
+        _energyTest->Initialize();
+    }
+
+    auto& phasespacePointVectorData = _energyTest->GetPointVector(1);
+    auto& phasespacePointVectorFit = _energyTest->GetPointVector(2);
+
+    _points = phasespacePointVectorData;
+    _points.insert(_points.end(), phasespacePointVectorFit.begin(), phasespacePointVectorFit.end());
+    _isData.resize(_points.size(), false);
+
+    for(unsigned int i=0; i<phasespacePointVectorData.size(); i++){
+        _isData[i] = true;
+    }
+
+    std::vector<double> norms;
+    std::vector<double> invNorms;
+    _energyTest->GetNormalization(norms, _isCircular);
+
+    for(auto it = norms.begin(); it != norms.end(); ++it){
+        invNorms.push_back(1. / *it);
+    }
+
+    _columns.Fill(_points, invNorms);
+    _kernelRow.resize(_points.size());
+
+    Recalculate();
+}
+
+
+
+void EnergyTestState::Recalculate(){
+
+    unsigned int numPoints = _points.size();
+
+    _rowData.assign(numPoints, 0);
+    _rowFit.assign(numPoints, 0);
+    _numData = 0;
+    _sumRData = 0;
+    _sumRDataFit = 0;
+    _sumOfWeightsData = 0;
+    _sumOfWeightsFit = 0;
+
+    const double* weights = _columns.GetWeights();
+
+    for(unsigned int i=0; i<numPoints; i++){
+        CalcKernelRow(i);
+
+        for(unsigned int j=0; j<numPoints; j++){
+            (_isData[j] ? _rowData[i] : _rowFit[i]) += weights[j] * _kernelRow[j];
+        }
+    }
+
+    for(unsigned int i=0; i<numPoints; i++){
+        double weight = weights[i];
+
+        if(_isData[i]){
+            _numData++;
+            _sumOfWeightsData += weight;
+            _sumRData += 0.5 * weight * _rowData[i];
+        }
+        else{
+            _sumOfWeightsFit += weight;
+            _sumRDataFit += weight * _rowData[i];
+        }
+    }
+}
+
+
+
+double EnergyTestState::GetPhi() const {
+
+    return _sumRData / (_sumOfWeightsData * _sumOfWeightsData) -
+           _sumRDataFit / (_sumOfWeightsData * _sumOfWeightsFit);
+}
+
+
+
+void EnergyTestState::CalcKernelRow(unsigned int index){
+
+    if(_energyTest->_distanceFunc == EnergyTest::DISTANCE_GAUSS){
+        EnergyPairSums::Row(_columns, index, _isCircular, EnergyGaussKernel(_energyTest->_gauss2sigsq), &_kernelRow[0]);
+    }
+    else{
+        EnergyPairSums::Row(_columns, index, _isCircular, EnergyLogKernel(_energyTest->_epsilon), &_kernelRow[0]);
+    }
+}
+
+
+
+void EnergyTestState::UpdateRows(unsigned int index, double sign){
+
+    // sign = +1 moves the point from fit to data, -1 from data to fit.
+    // The kernel row has a zero entry for the moved point itself.
+    double weight = sign * _columns.GetWeights()[index];
+    CalcKernelRow(index);
+
+    for(unsigned int i=0; i<_points.size(); i++){
+        _rowData[i] += weight * _kernelRow[i];
+        _rowFit[i] -= weight * _kernelRow[i];
+    }
+}
+
+
+
+void EnergyTestState::MoveToData(unsigned int index){
+
+    if(_isData.at(index)){
+        std::cerr << "ERROR: point " << index << " is already in the data subset" << std::endl;
+        return;
+    }
+
+    double weight = _columns.GetWeights()[index];
+
+    _sumRData += weight * _rowData[index];
+    _sumRDataFit += weight * (_rowFit[index] - _rowData[index]);
+    _sumOfWeightsData += weight;
+    _sumOfWeightsFit -= weight;
+    _isData[index] = true;
+    _numData++;
+
+    UpdateRows(index, 1.);
+}
+
+
+
+void EnergyTestState::MoveToFit(unsigned int index){
+
+    if(!_isData.at(index)){
+        std::cerr << "ERROR: point " << index << " is already in the fit subset" << std::endl;
+        return;
+    }
+
+    double weight = _columns.GetWeights()[index];
+
+    _sumRData -= weight * _rowData[index];
+    _sumRDataFit += weight * (_rowData[index] - _rowFit[index]);
+    _sumOfWeightsData -= weight;
+    _sumOfWeightsFit += weight;
+    _isData[index] = false;
+    _numData--;
+
+    UpdateRows(index, -1.);
+}
+
+
+
+void EnergyTestState::Swap(unsigned int dataIndex, unsigned int fitIndex){
+
+    MoveToFit(dataIndex);
+    MoveToData(fitIndex);
+}
@@ -0,0 +1,362 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+#include "EventGenerator.hh"
+#include "VoigtProfile.hh"
+#include "ColumnarPointFile.hh"
+
+
+const short EventGenerator::SHAPE_GAUSS;
+const short EventGenerator::SHAPE_VOIGT;
+const short EventGenerator::SHAPE_CRYSTALBALL;
+const unsigned int EventGenerator::NUM_TABLE_BINS = 8192;
+
+namespace {
+
+    const double pi = 3.14159265358979323846;
+}
+
+
+
+EventGenerator::EventGenerator(unsigned int numDims, double minMass, double maxMass, unsigned long seed) :
+    _numDims(numDims),
+    _minMass(minMass),
+    _maxMass(maxMass),
+    _circular(numDims, false),
+    _shape(SHAPE_GAUSS),
+    _mean(0.5 * (minMass + maxMass)),
+    _sigma(0.05 * (maxMass - minMass)),
+    _width(0),
+    _alpha(1.5),
+    _n(3),
+    _fraction(0.5),
+    _modulation(0),
+    _minWeight(1),
+    _maxWeight(1),
+    _twoMasses(false),
+    _signalNorm(1),
+    _backgroundNorm(1),
+    _engine(seed),
+    _uniform(0., 1.),
+    _normal(0., 1.)
+{
+    for(unsigned int i=0; i<numDims; i++){
+        std::ostringstream name;
+        name << "x" << i;
+        _coordNames.push_back(name.str());
+    }
+
+    UpdateTables();
+}
+
+
+
+void EventGenerator::SetSeed(unsigned long seed){
+
+    _engine.seed(seed);
+    _uniform.reset();
+    _normal.reset();
+}
+
+
+
+void EventGenerator::SetCircular(unsigned int dim, bool circular){
+
+    _circular.at(dim) = circular;
+}
+
+
+
+void EventGenerator::SetSignal(short shape, double mean, double sigma, double width, double alpha, double n){
+
+    // width is the Breit-Wigner FWHM of the Voigt shape, alpha and n the
+    // tail parameters of the Crystal Ball shape
+    _shape = shape;
+    _mean = mean;
+    _sigma = sigma;
+    _width = width;
+    _alpha = alpha;
+    _n = n;
+
+    UpdateTables();
+}
+
+
+
+void EventGenerator::SetBackground(const std::vector<double>& coefs){
+
+    // 1 + a1*x + a2*x^2 + ... with x = mass - minMass, as in the fit functions
+    _backgroundCoefs = coefs;
+
+    UpdateTables();
+}
+
+
+
+void EventGenerator::SetSignalFraction(double fraction, double modulation){
+
+    // Local fraction * (1 + modulation * x0), clipped to [0, 1], with x0
+    // replaced by cos(x0) for a circular coordinate
+    _fraction = fraction;
+    _modulation = modulation;
+}
+
+
+
+void EventGenerator::SetInitialWeights(double minWeight, double maxWeight){
+
+    _minWeight = minWeight;
+    _maxWeight = maxWeight;
+}
+
+
+
+void EventGenerator::SetTwoMasses(bool set){
+
+    // Signal events are signal in both masses, background events in none
+    _twoMasses = set;
+}
+
+
+
+bool EventGenerator::Generate(PhasespacePoint& point){
+
+    double x0 = 0;
+
+    for(unsigned int i=0; i<_numDims; i++){
+        double value = _circular[i] ? (2. * _uniform(_engine) - 1.) * PhasespacePointCloud::Pi
+                                    : 2. * _uniform(_engine) - 1.;
+        point.SetCoordinate(_coordNames[i], value);
+
+        if(i == 0)
+            x0 = value;
+    }
+
+    bool signal = _uniform(_engine) < GetSignalFraction(x0);
+
+    point.SetMass(signal ? GenerateSignalMass() : GenerateBackgroundMass());
+    if(_twoMasses)
+        point.SetMass2(signal ? GenerateSignalMass() : GenerateBackgroundMass());
+
+    point.SetInitialWeight((_maxWeight > _minWeight) ? _minWeight + (_maxWeight - _minWeight) * _uniform(_engine)
+                                                     : _minWeight);
+
+    return signal;
+}
+
+
+
+double EventGenerator::GetTrueQ(const PhasespacePoint& point) const {
+
+    double x0 = (_numDims > 0) ? point.coordValueMap.find(_coordNames[0])->second : 0;
+    double fraction = GetSignalFraction(x0);
+
+    double signal = SignalDensity(point.GetMass()) / _signalNorm;
+    double background = BackgroundDensity(point.GetMass()) / _backgroundNorm;
+
+    if(_twoMasses){
+        signal *= SignalDensity(point.GetMass2()) / _signalNorm;
+        background *= BackgroundDensity(point.GetMass2()) / _backgroundNorm;
+    }
+
+    double denom = fraction * signal + (1 - fraction) * background;
+    return (denom > 0) ? fraction * signal / denom : 0;
+}
+
+
+
+bool EventGenerator::WriteColumnarFile(const std::string& fileName, unsigned long numEvents){
+
+    ColumnarPointFile file(fileName, _coordNames, numEvents);
+
+    if(!file.IsOpen())
+        return false;
+
+    PhasespacePoint point;
+
+    for(unsigned long i=0; i<numEvents; i++){
+        Generate(point);
+        file.SetPoint(i, point);
+    }
+
+    return true;
+}
+
+
+
+double EventGenerator::GenerateSignalMass(){
+
+    // Gauss and Voigt are sampled exactly and truncated to the mass range,
+    // the Crystal Ball from its table
+    if(_shape == SHAPE_CRYSTALBALL)
+        return SampleTable(_signalTable);
+
+    for(;;){
+        double mass = _mean + _sigma * _normal(_engine);
+
+        if(_shape == SHAPE_VOIGT && _width > 0)
+            mass += 0.5 * _width * tan(pi * (_uniform(_engine) - 0.5));
+
+        if(mass >= _minMass && mass < _maxMass)
+            return mass;
+    }
+}
+
+
+
+double EventGenerator::GenerateBackgroundMass(){
+
+    if(_backgroundCoefs.empty())
+        return _minMass + (_maxMass - _minMass) * _uniform(_engine);
+
+    return SampleTable(_backgroundTable);
+}
+
+
+
+double EventGenerator::SampleTable(const std::vector<double>& table){
+
+    // Inverse of the piecewise linear cumulative distribution
+    double u = _uniform(_engine);
+    size_t bin = std::upper_bound(table.begin(), table.end(), u) - table.begin();
+    bin = std::min(std::max(bin, (size_t)1), table.size() - 1);
+
+    double low = table[bin - 1];
+    double high = table[bin];
+    double position = (high > low) ? (u - low) / (high - low) : 0.5;
+
+    return _minMass + (bin - 1 + position) * (_maxMass - _minMass) / NUM_TABLE_BINS;
+}
+
+
+
+double EventGenerator::GetSignalFraction(double x0) const {
+
+    double modulated = _fraction * (1 + _modulation * ((_numDims > 0 && _circular[0]) ? cos(x0) : x0));
+    return std::min(std::max(modulated, 0.), 1.);
+}
+
+
+
+double EventGenerator::SignalDensity(double mass) const {
+
+    double t = (mass - _mean) / _sigma;
+
+    if(_shape == SHAPE_VOIGT)
+        return VoigtProfile(_mean, _width, _sigma).Evaluate(mass);
+
+    if(_shape == SHAPE_CRYSTALBALL && t < -_alpha){
+        // Power law tail of RooCBShape
+        double a = pow(_n / _alpha, _n) * exp(-0.5 * _alpha * _alpha);
+        double b = _n / _alpha - _alpha;
+        return a / pow(b - t, _n);
+    }
+
+    return exp(-0.5 * t * t);
+}
+
+
+
+double EventGenerator::BackgroundDensity(double mass) const {
+
+    double x = mass - _minMass;
+    double value = 1;
+    double xpow = 1;
+
+    for(size_t k=0; k<_backgroundCoefs.size(); k++){
+        xpow *= x;
+        value += _backgroundCoefs[k] * xpow;
+    }
+
+    return std::max(value, 0.);
+}
+
+
+
+double EventGenerator::FillTable(std::vector<double>& table, bool signal) const {
+
+    // Trapezoidal cumulative integral, normalized to one at maxMass
+    double step = (_maxMass - _minMass) / NUM_TABLE_BINS;
+    table.resize(NUM_TABLE_BINS + 1);
+    table[0] = 0;
+
+    double previous = signal ? SignalDensity(_minMass) : BackgroundDensity(_minMass);
+
+    for(unsigned int i=1; i<=NUM_TABLE_BINS; i++){
+        double mass = _minMass + i * step;
+        double current = signal ? SignalDensity(mass) : BackgroundDensity(mass);
+        table[i] = table[i - 1] + 0.5 * (previous + current) * step;
+        previous = current;
+    }
+
+    double integral = table.back();
+
+    if(integral <= 0){
+        std::cout << "ERROR: " << (signal ? "signal" : "background")
+                  << " density is not positive in the mass range" << std::endl;
+        return 1;
+    }
+
+    for(unsigned int i=0; i<=NUM_TABLE_BINS; i++)
+        table[i] /= integral;
+
+    return integral;
+}
+
+
+
+void EventGenerator::UpdateTables(){
+
+    _signalNorm = FillTable(_signalTable, true);
+    _backgroundNorm = FillTable(_backgroundTable, false);
+
+    // Exact integrals of the shapes that are not sampled from the table
+    if(_shape == SHAPE_GAUSS){
+        double c = 1. / (sqrt(2.) * _sigma);
+        _signalNorm = sqrt(0.5 * pi) * _sigma *
+                      (erf(c * (_maxMass - _mean)) - erf(c * (_minMass - _mean)));
+    }
+    else if(_shape == SHAPE_VOIGT){
+        _signalNorm = VoigtProfile(_mean, _width, _sigma).Integrate(_minMass, _maxMass);
+    }
+}
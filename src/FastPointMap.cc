@@ -42,15 +42,17 @@
 
 FastPointMap::FastPointMap() :
     _phasespacePoint(NULL),
-    _distance(0.0)
+    _distance(0.0),
+    _index(0)
 {
 }
 
 
 
-FastPointMap::FastPointMap(PhasespacePoint* phasespacePoint, float distance) :
+FastPointMap::FastPointMap(PhasespacePoint* phasespacePoint, float distance, unsigned int index) :
     _phasespacePoint(phasespacePoint),
-    _distance(distance)
+    _distance(distance),
+    _index(index)
 {
 }
 
@@ -61,3 +63,13 @@ bool FastPointMap::operator() (const FastPointMap& i, const FastPointMap& j){
     return (i._distance < j._distance);
 }
 
+
+
+bool FastPointMap::CompareStable(const FastPointMap& i, const FastPointMap& j){
+
+    if(i._distance != j._distance)
+        return (i._distance < j._distance);
+
+    return (i._index < j._index);
+}
+
@@ -0,0 +1,356 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "KernelTree.hh"
+#include "PhasespacePoint.hh"
+#include "MemoryUsage.hh"
+
+
+
+namespace {
+
+    class CoordCompare
+    {
+        public:
+            CoordCompare(const std::vector<double>& coords, unsigned int numDims, unsigned int dim) :
+                _coords(coords), _numDims(numDims), _dim(dim) {}
+
+            bool operator() (unsigned int i, unsigned int j) const {
+                return _coords[i * _numDims + _dim] < _coords[j * _numDims + _dim];
+            }
+
+        private:
+            const std::vector<double>& _coords;
+            unsigned int _numDims;
+            unsigned int _dim;
+    };
+
+
+
+    // Distance of circular coordinates in units of the norm. The period is 2,
+    // see PhasespacePointCloud::CalcPhasespaceDistance
+    inline double CircularDistance(double absDiff){
+
+        double wrapped = fabs(2. - absDiff);
+        return (absDiff < wrapped) ? absDiff : wrapped;
+    }
+}
+
+
+
+
+KernelTree::KernelTree(const std::vector<PhasespacePoint*>& points,
+                       const std::vector<double>& norms,
+                       const std::vector<bool>& isCircular,
+                       unsigned int leafSize) :
+    _numDims(norms.size()),
+    _leafSize(std::max(leafSize, 1u)),
+    _isCircular(isCircular)
+{
+    for(unsigned int i=0; i<_numDims; i++){
+        _invNorms.push_back(1. / norms.at(i));
+    }
+
+    unsigned int numPoints = points.size();
+    _coords.resize(numPoints * _numDims);
+    _weights.resize(numPoints);
+    _points.resize(numPoints);
+
+    for(unsigned int i=0; i<numPoints; i++){
+        NormalizePoint(points[i], &_coords[i * _numDims]);
+        _weights[i] = points[i]->GetInitialWeight();
+        _points[i] = points[i];
+    }
+
+    if(numPoints == 0)
+        return;
+
+    std::vector<unsigned int> order(numPoints);
+    for(unsigned int i=0; i<numPoints; i++){
+        order[i] = i;
+    }
+
+    Build(order, 0, numPoints);
+
+    // Store the points in tree order, so that each node covers a contiguous range
+    std::vector<double> sortedCoords(_coords.size());
+    std::vector<double> sortedWeights(numPoints);
+    std::vector<const PhasespacePoint*> sortedPoints(numPoints);
+
+    for(unsigned int i=0; i<numPoints; i++){
+        std::copy(_coords.begin() + order[i] * _numDims, _coords.begin() + (order[i] + 1) * _numDims,
+                  sortedCoords.begin() + i * _numDims);
+        sortedWeights[i] = _weights[order[i]];
+        sortedPoints[i] = _points[order[i]];
+    }
+
+    _coords.swap(sortedCoords);
+    _weights.swap(sortedWeights);
+    _points.swap(sortedPoints);
+}
+
+
+
+void KernelTree::NormalizePoint(const PhasespacePoint* point, double* normalized) const {
+
+    for(unsigned int i=0; i<_numDims; i++){
+        normalized[i] = point->GetCoordValue(i) * _invNorms[i];
+    }
+}
+
+
+
+int KernelTree::Build(std::vector<unsigned int>& order, unsigned int begin, unsigned int end){
+
+    int nodeIndex = _nodes.size();
+
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    node.left = -1;
+    node.right = -1;
+    node.weightSum = 0;
+    node.absWeightSum = 0;
+
+    std::vector<double> lo(_numDims, HUGE_VAL);
+    std::vector<double> hi(_numDims, -HUGE_VAL);
+    std::vector<double> centroid(_numDims, 0);
+
+    for(unsigned int i=begin; i<end; i++){
+        const double* x = &_coords[order[i] * _numDims];
+        double absWeight = fabs(_weights[order[i]]);
+        node.weightSum += _weights[order[i]];
+        node.absWeightSum += absWeight;
+
+        for(unsigned int d=0; d<_numDims; d++){
+            lo[d] = std::min(lo[d], x[d]);
+            hi[d] = std::max(hi[d], x[d]);
+            centroid[d] += absWeight * x[d];
+        }
+    }
+
+    // The centroid has to lie inside the bounding box to keep the error bound valid
+    for(unsigned int d=0; d<_numDims; d++){
+        centroid[d] = (node.absWeightSum > 0) ? centroid[d] / node.absWeightSum : 0.5 * (lo[d] + hi[d]);
+        centroid[d] = std::min(std::max(centroid[d], lo[d]), hi[d]);
+    }
+
+    // Moments about the centroid entering the Taylor remainder of the kernel.
+    // The first moment vanishes for positive weights.
+    std::vector<double> firstMoment(_numDims, 0);
+    node.firstMoment = 0;
+    node.secondMoment = 0;
+
+    for(unsigned int i=begin; i<end; i++){
+        const double* x = &_coords[order[i] * _numDims];
+        for(unsigned int d=0; d<_numDims; d++){
+            double diff = x[d] - centroid[d];
+            firstMoment[d] += _weights[order[i]] * diff;
+            node.secondMoment += fabs(_weights[order[i]]) * diff * diff;
+        }
+    }
+
+    for(unsigned int d=0; d<_numDims; d++){
+        node.firstMoment += firstMoment[d] * firstMoment[d];
+    }
+    node.firstMoment = sqrt(node.firstMoment);
+
+    _nodes.push_back(node);
+    _lo.insert(_lo.end(), lo.begin(), lo.end());
+    _hi.insert(_hi.end(), hi.begin(), hi.end());
+    _centroid.insert(_centroid.end(), centroid.begin(), centroid.end());
+
+    if(end - begin <= _leafSize)
+        return nodeIndex;
+
+    // Split at the median of the widest dimension
+    unsigned int splitDim = 0;
+    double maxExtent = 0;
+    for(unsigned int d=0; d<_numDims; d++){
+        if(hi[d] - lo[d] > maxExtent){
+            maxExtent = hi[d] - lo[d];
+            splitDim = d;
+        }
+    }
+
+    if(maxExtent <= 0)
+        return nodeIndex;
+
+    unsigned int mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     CoordCompare(_coords, _numDims, splitDim));
+
+    int left = Build(order, begin, mid);
+    int right = Build(order, mid, end);
+    _nodes[nodeIndex].left = left;
+    _nodes[nodeIndex].right = right;
+
+    return nodeIndex;
+}
+
+
+
+double KernelTree::PointDistance(const double* target, const double* point) const {
+
+    double distance = 0;
+
+    for(unsigned int d=0; d<_numDims; d++){
+        double diff = fabs(target[d] - point[d]);
+
+        if(_isCircular[d])
+            diff = CircularDistance(diff);
+
+        distance += diff * diff;
+    }
+
+    return sqrt(distance);
+}
+
+
+
+bool KernelTree::NodeMinDistance(const double* target, int node, double& dmin) const {
+
+    const double* lo = &_lo[node * _numDims];
+    const double* hi = &_hi[node * _numDims];
+    double dminsq = 0;
+    bool smooth = true;
+
+    for(unsigned int d=0; d<_numDims; d++){
+        double gapMin = std::max(0., std::max(lo[d] - target[d], target[d] - hi[d]));
+        double gapMax = std::max(fabs(target[d] - lo[d]), fabs(target[d] - hi[d]));
+        double low = gapMin;
+
+        // The circular distance min(u, |2-u|) has its zero at u=2 and
+        // a kink at u=1, where the metric is not differentiable
+        if(_isCircular[d]){
+            low = (gapMin <= 2. && gapMax >= 2.) ? 0. :
+                  std::min(CircularDistance(gapMin), CircularDistance(gapMax));
+            if(gapMin <= 1. && gapMax >= 1.)
+                smooth = false;
+        }
+
+        dminsq += low * low;
+    }
+
+    dmin = sqrt(dminsq);
+    return smooth;
+}
+
+
+
+double KernelTree::SumLogKernel(const double* target, const PhasespacePoint* exclude,
+                                double epsilon, double tolerance, double& errorBound) const {
+
+    double sum = 0;
+    errorBound = 0;
+
+    if(_nodes.empty())
+        return 0;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while(!stack.empty()){
+
+        int nodeIndex = stack.back();
+        stack.pop_back();
+        const Node& node = _nodes[nodeIndex];
+
+        // Far field: Taylor expansion of -log(r + epsilon) about the centroid. Gradient
+        // and Hessian are bounded by 1/(r + epsilon) and 1/(r (r + epsilon)) inside the node.
+        double dmin;
+        if(tolerance > 0 && NodeMinDistance(target, nodeIndex, dmin) && dmin > 0){
+            double nodeError = node.firstMoment / (dmin + epsilon) +
+                               0.5 * node.secondMoment / (dmin * (dmin + epsilon));
+
+            if(nodeError <= tolerance * node.absWeightSum){
+                double dcentroid = PointDistance(target, &_centroid[nodeIndex * _numDims]);
+                sum -= node.weightSum * log(dcentroid + epsilon);
+                errorBound += nodeError;
+                continue;
+            }
+        }
+
+        // Near field: exact evaluation
+        if(node.left < 0){
+            for(unsigned int i=node.begin; i<node.end; i++){
+                if(_points[i] == exclude)
+                    continue;
+                sum -= _weights[i] * log(PointDistance(target, &_coords[i * _numDims]) + epsilon);
+            }
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+
+    return sum;
+}
+
+
+
+size_t KernelTree::GetMemoryUsage() const {
+
+    return MemoryUsage::GetVectorBytes(_coords.capacity(), sizeof(double)) +
+           MemoryUsage::GetVectorBytes(_weights.capacity(), sizeof(double)) +
+           MemoryUsage::GetVectorBytes(_points.capacity(), sizeof(const PhasespacePoint*)) +
+           MemoryUsage::GetVectorBytes(_nodes.capacity(), sizeof(Node)) +
+           MemoryUsage::GetVectorBytes(_lo.capacity(), sizeof(double)) +
+           MemoryUsage::GetVectorBytes(_hi.capacity(), sizeof(double)) +
+           MemoryUsage::GetVectorBytes(_centroid.capacity(), sizeof(double));
+}
+
+
+
+size_t KernelTree::EstimateMemoryUsage(unsigned long numPoints, unsigned int numDims, unsigned int leafSize){
+
+    // Median splits give at most the next power of two of N / leafSize leaves
+    size_t numLeaves = MemoryUsage::GetGrownCapacity((numPoints + leafSize - 1) / leafSize);
+    size_t numNodes = MemoryUsage::GetGrownCapacity(2 * numLeaves);
+
+    return MemoryUsage::GetVectorBytes(numPoints * numDims, sizeof(double)) +
+           MemoryUsage::GetVectorBytes(numPoints, sizeof(double)) +
+           MemoryUsage::GetVectorBytes(numPoints, sizeof(const PhasespacePoint*)) +
+           MemoryUsage::GetVectorBytes(numNodes, sizeof(Node)) +
+           3 * MemoryUsage::GetVectorBytes(numNodes * numDims, sizeof(double));
+}
@@ -0,0 +1,195 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <map>
+#include <iomanip>
+
+#include "MemoryUsage.hh"
+#include "PhasespacePoint.hh"
+
+
+
+namespace {
+
+    // Red-black tree node header of std::map: color and three pointers
+    const size_t MAP_NODE_HEADER = 4 * sizeof(void*);
+
+    // Characters that std::string keeps without a heap allocation, and the
+    // header in front of the characters of a heap string. The old
+    // reference-counted strings of libstdc++ (_GLIBCXX_USE_CXX11_ABI=0)
+    // share one empty string and keep length, capacity and reference count
+    // with the characters. Otherwise the 15-character buffer of the C++11
+    // string of libstdc++ is assumed.
+#if defined(_GLIBCXX_USE_CXX11_ABI) && !_GLIBCXX_USE_CXX11_ABI
+    const size_t STRING_LOCAL_CAPACITY = 0;
+    const size_t STRING_HEAP_HEADER = 3 * sizeof(size_t);
+#else
+    const size_t STRING_LOCAL_CAPACITY = 15;
+    const size_t STRING_HEAP_HEADER = 0;
+#endif
+}
+
+
+
+MemoryUsage::MemoryUsage() :
+    pointStorage(0),
+    coordinateMaps(0),
+    neighborIndex(0),
+    fitWorkspace(0),
+    energyTest(0)
+{
+}
+
+
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other){
+
+    pointStorage += other.pointStorage;
+    coordinateMaps += other.coordinateMaps;
+    neighborIndex += other.neighborIndex;
+    fitWorkspace += other.fitWorkspace;
+    energyTest += other.energyTest;
+
+    return *this;
+}
+
+
+
+MemoryUsage MemoryUsage::operator*(size_t factor) const {
+
+    MemoryUsage result(*this);
+    result.pointStorage *= factor;
+    result.coordinateMaps *= factor;
+    result.neighborIndex *= factor;
+    result.fitWorkspace *= factor;
+    result.energyTest *= factor;
+
+    return result;
+}
+
+
+
+size_t MemoryUsage::GetTotal() const {
+
+    return pointStorage + coordinateMaps + neighborIndex + fitWorkspace + energyTest;
+}
+
+
+
+void MemoryUsage::Print(std::ostream& out, const std::string& title) const {
+
+    const double mb = 1024. * 1024.;
+
+    out << "INFO: memory usage of " << title << " (MB)" << std::endl;
+    out << std::fixed << std::setprecision(1)
+        << "  point storage:   " << std::setw(10) << pointStorage / mb << std::endl
+        << "  coordinate maps: " << std::setw(10) << coordinateMaps / mb << std::endl
+        << "  neighbor index:  " << std::setw(10) << neighborIndex / mb << std::endl
+        << "  fit workspaces:  " << std::setw(10) << fitWorkspace / mb << std::endl
+        << "  energy test:     " << std::setw(10) << energyTest / mb << std::endl
+        << "  total:           " << std::setw(10) << GetTotal() / mb << std::endl;
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+}
+
+
+
+size_t MemoryUsage::GetAllocationSize(size_t bytes){
+
+    if(bytes == 0)
+        return 0;
+
+    size_t chunk = (bytes + 8 + 15) & ~static_cast<size_t>(15);
+    return (chunk < 32) ? 32 : chunk;
+}
+
+
+
+size_t MemoryUsage::GetStringSize(size_t length){
+
+    // Heap part only, the string object itself is part of its owner
+    return (length > STRING_LOCAL_CAPACITY) ? GetAllocationSize(STRING_HEAP_HEADER + length + 1) : 0;
+}
+
+
+
+size_t MemoryUsage::GetVectorBytes(size_t capacity, size_t elementSize){
+
+    return GetAllocationSize(capacity * elementSize);
+}
+
+
+
+size_t MemoryUsage::GetGrownCapacity(size_t size){
+
+    // Capacity of a vector filled by push_back, which doubles its capacity
+    size_t capacity = (size > 0) ? 1 : 0;
+    while(capacity < size)
+        capacity *= 2;
+
+    return capacity;
+}
+
+
+
+size_t MemoryUsage::GetPointBytes(){
+
+    return GetAllocationSize(sizeof(PhasespacePoint));
+}
+
+
+
+size_t MemoryUsage::GetCoordinateBytes(size_t numCoords, size_t meanNameLength){
+
+    size_t mapNode = GetAllocationSize(MAP_NODE_HEADER + sizeof(std::pair<const std::string, double>));
+    return numCoords * (mapNode + GetStringSize(meanNameLength)) + GetVectorBytes(numCoords, sizeof(double));
+}
+
+
+
+size_t MemoryUsage::GetPointCoordinateBytes(const PhasespacePoint& point){
+
+    size_t mapNode = GetAllocationSize(MAP_NODE_HEADER + sizeof(std::pair<const std::string, double>));
+    size_t bytes = GetVectorBytes(point.coordValueVector.capacity(), sizeof(double));
+
+    std::map<std::string, double>::const_iterator it;
+    for(it=point.coordValueMap.begin(); it!=point.coordValueMap.end(); ++it)
+        bytes += mapNode + GetStringSize(it->first.capacity());
+
+    return bytes;
+}
@@ -0,0 +1,93 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#include "NormalizationCache.hh"
+
+
+
+NormalizationCache::NormalizationCache(double paramMin, double paramMax, unsigned int numNodes) :
+    _paramMin(paramMin),
+    _paramMax(paramMax),
+    _step(0),
+    _values(numNodes < 2 ? 2 : numNodes, 0.),
+    _derivatives(numNodes < 2 ? 2 : numNodes, 0.)
+{
+    _step = (_paramMax - _paramMin) / (_values.size() - 1);
+}
+
+
+
+double NormalizationCache::GetNode(unsigned int index) const {
+
+    return _paramMin + index * _step;
+}
+
+
+
+void NormalizationCache::SetNode(unsigned int index, double value, double derivative){
+
+    _values.at(index) = value;
+    _derivatives.at(index) = derivative;
+}
+
+
+
+bool NormalizationCache::IsInRange(double param) const {
+
+    return param >= _paramMin && param <= _paramMax;
+}
+
+
+
+double NormalizationCache::GetValue(double param) const {
+
+    if(_step <= 0)
+        return _values[0];
+
+    double pos = (param - _paramMin) / _step;
+    unsigned int last = _values.size() - 1;
+    unsigned int i = (pos <= 0) ? 0 : static_cast<unsigned int>(pos);
+    if(i >= last)
+        i = last - 1;
+
+    double t = pos - i;
+    double t2 = t * t;
+    double t3 = t2 * t;
+
+    return (2 * t3 - 3 * t2 + 1) * _values[i] + (t3 - 2 * t2 + t) * _step * _derivatives[i] +
+           (-2 * t3 + 3 * t2) * _values[i + 1] + (t3 - t2) * _step * _derivatives[i + 1];
+}
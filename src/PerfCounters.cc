@@ -0,0 +1,169 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.hh"
+
+
+const short PerfCounters::CYCLES;
+const short PerfCounters::INSTRUCTIONS;
+const short PerfCounters::LLC_MISSES;
+const short PerfCounters::BRANCH_MISSES;
+const short PerfCounters::NUM_EVENTS;
+
+
+
+namespace {
+
+const char* eventNames[] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+
+#ifdef __linux__
+// PERF_COUNT_HW_CACHE_MISSES counts the last level cache on common CPUs
+const unsigned long long eventConfigs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+#endif
+
+}
+
+
+
+PerfCounters::PerfCounters(bool inherit){
+
+    for(short i=0; i<NUM_EVENTS; i++){
+        _fds[i] = -1;
+        _counts[i] = 0;
+    }
+
+#ifdef __linux__
+    // Separate counters instead of one group, group reads are not allowed
+    // together with inherit
+    for(short i=0; i<NUM_EVENTS; i++){
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = eventConfigs[i];
+        attr.disabled = 1;
+        attr.inherit = inherit ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        _fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+
+
+PerfCounters::~PerfCounters(){
+
+#ifdef __linux__
+    for(short i=0; i<NUM_EVENTS; i++){
+        if(_fds[i] >= 0)
+            close(_fds[i]);
+    }
+#endif
+}
+
+
+
+bool PerfCounters::IsAvailable() const {
+
+    for(short i=0; i<NUM_EVENTS; i++){
+        if(_fds[i] >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+
+void PerfCounters::Start(){
+
+#ifdef __linux__
+    for(short i=0; i<NUM_EVENTS; i++){
+        if(_fds[i] < 0)
+            continue;
+
+        ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+
+
+void PerfCounters::Stop(){
+
+#ifdef __linux__
+    for(short i=0; i<NUM_EVENTS; i++){
+        if(_fds[i] >= 0)
+            ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for(short i=0; i<NUM_EVENTS; i++){
+        _counts[i] = 0;
+        if(_fds[i] < 0)
+            continue;
+
+        // value, time enabled, time running
+        unsigned long long values[3] = {0, 0, 0};
+        if(read(_fds[i], values, sizeof(values)) != sizeof(values))
+            continue;
+
+        if(values[2] > 0)
+            _counts[i] = values[0] * (static_cast<double>(values[1]) / values[2]);
+    }
+#endif
+}
+
+
+
+const char* PerfCounters::GetEventName(short event){
+
+    return (event >= 0 && event < NUM_EVENTS) ? eventNames[event] : "";
+}
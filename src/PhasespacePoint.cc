@@ -56,6 +56,7 @@ PhasespacePoint::PhasespacePoint() :
     _mass2(0.),
     _weight(0.),
     _weightError(0.),
+    _cloudIndex(-1),
     _mass2Set(false)
 {
 }
@@ -152,6 +153,22 @@ void PhasespacePoint::SetInitialWeight(double weight){
 
 
 
+void PhasespacePoint::SetCloudIndex(long index){
+
+    // Position of the copy of this point in the subset of the cloud it was
+    // added to last, -1 if it was never added
+    _cloudIndex = index;
+}
+
+
+
+long PhasespacePoint::GetCloudIndex() const {
+
+    return _cloudIndex;
+}
+
+
+
 void PhasespacePoint::ArrangeCoordinates(const std::map< std::string, PhasespaceCoord >& coordNameMap){
 
     if(coordNameMap.size() != coordValueMap.size()){
@@ -105,6 +105,7 @@ void PhasespacePointCloud::RegisterPhasespaceCoord(const std::string& name, doub
 void PhasespacePointCloud::AddPhasespacePoint(PhasespacePoint &newPhasespacePoint, int subset){
 
     ArrangePointCoordinates(newPhasespacePoint);
+    newPhasespacePoint.SetCloudIndex(_phasespacePointVectors.at(subset - 1).size());
 
     PhasespacePoint* copiedPhasespacePoint = new PhasespacePoint(newPhasespacePoint);
 
@@ -181,3 +182,34 @@ std::map<std::string, PhasespaceCoord>& PhasespacePointCloud::GetCoordNameMap(){
     return _coordNameMap;
 }
 
+
+
+MemoryUsage PhasespacePointCloud::GetMemoryUsage() const {
+
+    MemoryUsage usage;
+
+    for(size_t i=0; i<_phasespacePointVectors.size(); i++){
+        const std::vector<PhasespacePoint*>& points = _phasespacePointVectors[i];
+        usage.pointStorage += MemoryUsage::GetVectorBytes(points.capacity(), sizeof(PhasespacePoint*)) +
+                              points.size() * MemoryUsage::GetPointBytes();
+
+        for(size_t j=0; j<points.size(); j++)
+            usage.coordinateMaps += MemoryUsage::GetPointCoordinateBytes(*points[j]);
+    }
+
+    return usage;
+}
+
+
+
+MemoryUsage PhasespacePointCloud::EstimateMemoryUsage(unsigned long numPoints, unsigned int numCoords,
+                                                      unsigned int meanNameLength){
+
+    // Points added one by one to a single subset
+    MemoryUsage usage;
+    usage.pointStorage = MemoryUsage::GetVectorBytes(MemoryUsage::GetGrownCapacity(numPoints), sizeof(PhasespacePoint*)) +
+                         numPoints * MemoryUsage::GetPointBytes();
+    usage.coordinateMaps = numPoints * MemoryUsage::GetCoordinateBytes(numCoords, meanNameLength);
+
+    return usage;
+}
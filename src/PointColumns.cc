@@ -0,0 +1,91 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include "PointColumns.hh"
+#include "PhasespacePoint.hh"
+
+
+
+PointColumns::PointColumns(unsigned int numDims, unsigned int capacity) :
+    _numDims(0),
+    _capacity(0),
+    _numPoints(0)
+{
+    Reserve(numDims, capacity);
+}
+
+
+
+void PointColumns::Reserve(unsigned int numDims, unsigned int capacity){
+
+    _numDims = numDims;
+    _capacity = capacity;
+    _numPoints = 0;
+    _values.assign((numDims + 1) * static_cast<size_t>(capacity), 0.);
+}
+
+
+
+void PointColumns::SetNumPoints(unsigned int numPoints){
+
+    if(numPoints > _capacity){
+        throw PhasespacePoint::ERR_INDEX_OVERFLOW;
+    }
+
+    _numPoints = numPoints;
+}
+
+
+
+void PointColumns::Fill(const std::vector<PhasespacePoint*>& points, const std::vector<double>& invNorms){
+
+    Reserve(invNorms.size(), points.size());
+    SetNumPoints(points.size());
+
+    for(unsigned int d=0; d<_numDims; d++){
+        double* column = GetColumn(d);
+        for(unsigned int i=0; i<_numPoints; i++){
+            column[i] = points[i]->GetCoordValue(d) * invNorms[d];
+        }
+    }
+
+    double* weights = GetWeights();
+    for(unsigned int i=0; i<_numPoints; i++){
+        weights[i] = points[i]->GetInitialWeight();
+    }
+}
@@ -0,0 +1,376 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#include <cmath>
+#include "VoigtProfile.hh"
+
+
+
+namespace {
+
+const double invRootPi = 0.56418958354775628;
+
+// Weideman's L = sqrt(N / sqrt(2)) and the expansion coefficients a_N ... a_1
+// for N = 32, computed from the FFT formula of the paper in long double
+const double weidemanL = 4.7568284600108841;
+const unsigned int numCoefs = 32;
+const double weidemanCoefs[numCoefs] = {
+    -1.30334710586001791e-12,
+    +3.74103564136440232e-12,
+    +8.03039463912076906e-12,
+    -2.15436232746971058e-11,
+    -5.54424746232104731e-11,
+    +1.16582386285583222e-10,
+    +4.15374227225165154e-10,
+    -5.23102211341056750e-10,
+    -3.20801521969343948e-09,
+    +8.12488920577897431e-10,
+    +2.37975567047031588e-08,
+    +2.29304390310998852e-08,
+    -1.48130789179670187e-07,
+    -4.18407637117788141e-07,
+    +4.25583313736475378e-07,
+    +4.40153173153005049e-06,
+    +6.82103194400087185e-06,
+    -2.14096192018163649e-05,
+    -1.30754492546099571e-04,
+    -2.45329802700180761e-04,
+    +3.92591360700790168e-04,
+    +4.51954110534928503e-03,
+    +1.90061557848454736e-02,
+    +5.73044035298371918e-02,
+    +1.40607162268937852e-01,
+    +2.95444510715087316e-01,
+    +5.46013972063934205e-01,
+    +9.01925489364799993e-01,
+    +1.34554416923454512e+00,
+    +1.82566962963248125e+00,
+    +2.26353729990026764e+00,
+    +2.57225340812456915e+00
+};
+
+
+
+// w(x + iy) for y >= 0, written in real arithmetic so that it inlines into
+// vectorized loops. With q = 1/(L - iz) and Z = (L + iz) q the approximation
+// is w = 2 p(Z) q^2 + q / sqrt(pi).
+inline void WeidemanW(double x, double y, double& re, double& im){
+
+    double a = weidemanL - y;
+    double c = weidemanL + y;
+    double invDenom = 1. / (c * c + x * x);
+
+    double qre = c * invDenom;
+    double qim = x * invDenom;
+    double zre = (a * c - x * x) * invDenom;
+    double zim = x * (a + c) * invDenom;
+
+    double pre = weidemanCoefs[0];
+    double pim = 0.;
+    for(unsigned int k=1; k<numCoefs; k++){
+        double tmp = pre * zre - pim * zim + weidemanCoefs[k];
+        pim = pre * zim + pim * zre;
+        pre = tmp;
+    }
+
+    double q2re = qre * qre - qim * qim;
+    double q2im = 2. * qre * qim;
+
+    re = 2. * (pre * q2re - pim * q2im) + invRootPi * qre;
+    im = 2. * (pre * q2im + pim * q2re) + invRootPi * qim;
+}
+
+
+
+// Same as WeidemanW for up to TILE_SIZE points. The Horner loop runs over
+// the coefficients outside and over the points inside, so every inner loop
+// is vectorized.
+const size_t TILE_SIZE = 64;
+
+void WeidemanTile(const double* x, double y, double* re, double* im, size_t numPoints){
+
+    double zre[TILE_SIZE], zim[TILE_SIZE], qre[TILE_SIZE], qim[TILE_SIZE];
+    double pre[TILE_SIZE], pim[TILE_SIZE];
+
+    double a = weidemanL - y;
+    double c = weidemanL + y;
+
+    for(size_t i=0; i<numPoints; i++){
+        double invDenom = 1. / (c * c + x[i] * x[i]);
+        qre[i] = c * invDenom;
+        qim[i] = x[i] * invDenom;
+        zre[i] = (a * c - x[i] * x[i]) * invDenom;
+        zim[i] = x[i] * (a + c) * invDenom;
+        pre[i] = weidemanCoefs[0];
+        pim[i] = 0.;
+    }
+
+    for(unsigned int k=1; k<numCoefs; k++){
+        double coef = weidemanCoefs[k];
+        for(size_t i=0; i<numPoints; i++){
+            double tmp = pre[i] * zre[i] - pim[i] * zim[i] + coef;
+            pim[i] = pre[i] * zim[i] + pim[i] * zre[i];
+            pre[i] = tmp;
+        }
+    }
+
+    for(size_t i=0; i<numPoints; i++){
+        double q2re = qre[i] * qre[i] - qim[i] * qim[i];
+        double q2im = 2. * qre[i] * qim[i];
+        re[i] = 2. * (pre[i] * q2re - pim[i] * q2im) + invRootPi * qre[i];
+        im[i] = 2. * (pre[i] * q2im + pim[i] * q2re) + invRootPi * qim[i];
+    }
+}
+
+}
+
+
+
+VoigtProfile::VoigtProfile(double mean, double width, double sigma){
+
+    SetParameters(mean, width, sigma);
+}
+
+
+
+void VoigtProfile::SetParameters(double mean, double width, double sigma){
+
+    _mean = mean;
+    _width = fabs(width);
+    _sigma = fabs(sigma);
+    _isVoigt = (_width > 0 && _sigma > 0);
+    _c = _isVoigt ? 1. / (sqrt(2.) * _sigma) : 0.;
+    _y = 0.5 * _c * _width;
+}
+
+
+
+double VoigtProfile::EvaluateLimit(double x) const {
+
+    // Pure Breit-Wigner or Gaussian limits, as in RooVoigtian
+    double arg = x - _mean;
+
+    if(_sigma == 0. && _width == 0.)
+        return 1.;
+
+    if(_sigma == 0.)
+        return 1. / (arg * arg + 0.25 * _width * _width);
+
+    return exp(-0.5 * arg * arg / (_sigma * _sigma));
+}
+
+
+
+double VoigtProfile::Evaluate(double x) const {
+
+    if(!_isVoigt)
+        return EvaluateLimit(x);
+
+    double re, im;
+    WeidemanW(_c * (x - _mean), _y, re, im);
+
+    return _c * invRootPi * re;
+}
+
+
+
+void VoigtProfile::Evaluate(double x, double& value, double& dSigma, double& dX) const {
+
+    if(!_isVoigt){
+        value = EvaluateLimit(x);
+        dSigma = 0;
+        dX = 0;
+        return;
+    }
+
+    // w'(z) = -2 z w + 2i/sqrt(pi) and dz/dsigma = -z/sigma
+    double u = _c * (x - _mean);
+    double re, im;
+    WeidemanW(u, _y, re, im);
+
+    double dwre = -2. * (u * re - _y * im);
+    double dwim = -2. * (u * im + _y * re) + 2. * invRootPi;
+
+    value = _c * invRootPi * re;
+    dSigma = -_c / _sigma * invRootPi * (re + u * dwre - _y * dwim);
+    dX = _c * _c * invRootPi * dwre;
+}
+
+
+
+void VoigtProfile::EvaluateBatch(const double* x, double* values, size_t numPoints) const {
+
+    if(!_isVoigt){
+        for(size_t i=0; i<numPoints; i++)
+            values[i] = EvaluateLimit(x[i]);
+        return;
+    }
+
+    double u[TILE_SIZE], re[TILE_SIZE], im[TILE_SIZE];
+    const double scale = _c * invRootPi;
+
+    for(size_t start=0; start<numPoints; start+=TILE_SIZE){
+        size_t n = (numPoints - start < TILE_SIZE) ? numPoints - start : TILE_SIZE;
+
+        for(size_t i=0; i<n; i++)
+            u[i] = _c * (x[start + i] - _mean);
+
+        WeidemanTile(u, _y, re, im, n);
+
+        for(size_t i=0; i<n; i++)
+            values[start + i] = scale * re[i];
+    }
+}
+
+
+
+void VoigtProfile::EvaluateBatch(const double* x, double* values, double* dSigma, size_t numPoints) const {
+
+    if(!_isVoigt){
+        for(size_t i=0; i<numPoints; i++){
+            values[i] = EvaluateLimit(x[i]);
+            dSigma[i] = 0;
+        }
+        return;
+    }
+
+    double u[TILE_SIZE], re[TILE_SIZE], im[TILE_SIZE];
+    const double y = _y;
+    const double scale = _c * invRootPi;
+    const double scaleSigma = -_c / _sigma * invRootPi;
+
+    for(size_t start=0; start<numPoints; start+=TILE_SIZE){
+        size_t n = (numPoints - start < TILE_SIZE) ? numPoints - start : TILE_SIZE;
+
+        for(size_t i=0; i<n; i++)
+            u[i] = _c * (x[start + i] - _mean);
+
+        WeidemanTile(u, y, re, im, n);
+
+        // w'(z) = -2 z w + 2i/sqrt(pi) and dz/dsigma = -z/sigma
+        for(size_t i=0; i<n; i++){
+            double dwre = -2. * (u[i] * re[i] - y * im[i]);
+            double dwim = -2. * (u[i] * im[i] + y * re[i]) + 2. * invRootPi;
+
+            values[start + i] = scale * re[i];
+            dSigma[start + i] = scaleSigma * (re[i] + u[i] * dwre - y * dwim);
+        }
+    }
+}
+
+
+
+double VoigtProfile::Integrate(double xmin, double xmax) const {
+
+    // Split the range around the peak, so the adaptive steps start below its width
+    double scale = _sigma + _width;
+    double offsets[] = {-10., -1., 0., 1., 10.};
+    double edges[7];
+    int numEdges = 0;
+
+    edges[numEdges++] = xmin;
+    for(int i=0; i<5; i++){
+        double edge = _mean + offsets[i] * scale;
+        if(edge > edges[numEdges - 1] && edge < xmax)
+            edges[numEdges++] = edge;
+    }
+    edges[numEdges++] = xmax;
+
+    double integral = 0;
+    for(int i=0; i+1<numEdges; i++){
+        double a = edges[i];
+        double b = edges[i + 1];
+        double fa = Evaluate(a);
+        double fm = Evaluate(0.5 * (a + b));
+        double fb = Evaluate(b);
+        double whole = (b - a) / 6. * (fa + 4 * fm + fb);
+
+        integral += AdaptiveSimpson(a, b, fa, fm, fb, whole, 1E-10, 40);
+    }
+
+    return integral;
+}
+
+
+
+double VoigtProfile::IntegralDSigma(double xmin, double xmax) const {
+
+    // dV/dsigma = sigma * d2V/dx2, so the sigma derivative of the integral
+    // is sigma times the difference of dV/dx at the range limits
+    double lowValue, lowDSigma, lowDX, highValue, highDSigma, highDX;
+    Evaluate(xmin, lowValue, lowDSigma, lowDX);
+    Evaluate(xmax, highValue, highDSigma, highDX);
+
+    return _sigma * (highDX - lowDX);
+}
+
+
+
+double VoigtProfile::AdaptiveSimpson(double a, double b, double fa, double fm, double fb,
+                                     double whole, double tolerance, int depth) const {
+
+    double m = 0.5 * (a + b);
+    double lm = 0.5 * (a + m);
+    double rm = 0.5 * (m + b);
+    double flm = Evaluate(lm);
+    double frm = Evaluate(rm);
+    double left = (m - a) / 6. * (fa + 4 * flm + fm);
+    double right = (b - m) / 6. * (fm + 4 * frm + fb);
+
+    if(depth <= 0 || fabs(left + right - whole) <= 15 * tolerance)
+        return left + right + (left + right - whole) / 15.;
+
+    return AdaptiveSimpson(a, m, fa, flm, fm, left, 0.5 * tolerance, depth - 1) +
+           AdaptiveSimpson(m, b, fm, frm, fb, right, 0.5 * tolerance, depth - 1);
+}
+
+
+
+void VoigtProfile::Faddeeva(double x, double y, double& re, double& im){
+
+    WeidemanW(x, y, re, im);
+}
+
+
+
+void VoigtProfile::FaddeevaBatch(const double* x, double y, double* re, double* im, size_t numPoints){
+
+    for(size_t start=0; start<numPoints; start+=TILE_SIZE){
+        size_t n = (numPoints - start < TILE_SIZE) ? numPoints - start : TILE_SIZE;
+        WeidemanTile(x + start, y, re + start, im + start, n);
+    }
+}
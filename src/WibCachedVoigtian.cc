@@ -0,0 +1,173 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#include "WibCachedVoigtian.hh"
+#include "VoigtProfile.hh"
+
+#include "RooAbsReal.h"
+
+#include <cmath>
+
+
+
+WibCachedVoigtian::WibCachedVoigtian(const char* name,
+                                     const char* title,
+                                     RooAbsReal& px,
+                                     RooAbsReal& pmean,
+                                     RooAbsReal& pwidth,
+                                     RooAbsReal& psigma,
+                                     double sigmaMin,
+                                     double sigmaMax,
+                                     unsigned int numNodes) :
+    RooAbsPdf(name, title),
+    x("x", "Dependent", this, px),
+    mean("mean", "Mean", this, pmean),
+    width("width", "Breit-Wigner width", this, pwidth),
+    sigma("sigma", "Gauss width", this, psigma),
+    cache(sigmaMin, sigmaMax, numNodes),
+    cacheFilled(false),
+    cacheMean(0),
+    cacheWidth(0),
+    cacheMin(0),
+    cacheMax(0)
+{
+}
+
+
+
+WibCachedVoigtian::WibCachedVoigtian(const WibCachedVoigtian& other, const char* name) :
+    RooAbsPdf(other, name),
+    x("x", this, other.x),
+    mean("mean", this, other.mean),
+    width("width", this, other.width),
+    sigma("sigma", this, other.sigma),
+    cache(other.cache),
+    cacheFilled(other.cacheFilled),
+    cacheMean(other.cacheMean),
+    cacheWidth(other.cacheWidth),
+    cacheMin(other.cacheMin),
+    cacheMax(other.cacheMax)
+{
+}
+
+
+
+bool WibCachedVoigtian::GetDerivatives(double px,
+                                       double pmean,
+                                       double pwidth,
+                                       double psigma,
+                                       double& value,
+                                       double& dSigma,
+                                       double& dX){
+
+    if(psigma <= 0 || pwidth <= 0)
+        return false;
+
+    VoigtProfile profile(pmean, pwidth, psigma);
+    profile.Evaluate(px, value, dSigma, dX);
+
+    return true;
+}
+
+
+
+TObject* WibCachedVoigtian::clone(const char* newname) const {
+
+    return new WibCachedVoigtian(*this, newname);
+}
+
+
+
+WibCachedVoigtian::~WibCachedVoigtian(){
+}
+
+
+
+Double_t WibCachedVoigtian::evaluate() const {
+
+    return VoigtProfile(mean, width, sigma).Evaluate(x);
+}
+
+
+
+Int_t WibCachedVoigtian::getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName) const {
+
+    // Only the full range with a proper Voigt profile is tabulated
+    if(rangeName != 0 || width <= 0 || sigma <= 0 || cache.GetNode(0) <= 0)
+        return 0;
+
+    if(matchArgs(allVars, analVars, x))
+        return 1;
+
+    return 0;
+}
+
+
+
+Double_t WibCachedVoigtian::analyticalIntegral(Int_t code, const char* rangeName) const {
+
+    if(!cache.IsInRange(sigma))
+        return Integrate(sigma);
+
+    if(!cacheFilled || cacheMean != mean || cacheWidth != width || cacheMin != x.min() || cacheMax != x.max())
+        FillCache();
+
+    return cache.GetValue(sigma);
+}
+
+
+
+double WibCachedVoigtian::Integrate(double sigmaVal) const {
+
+    return VoigtProfile(mean, width, sigmaVal).Integrate(x.min(), x.max());
+}
+
+
+
+void WibCachedVoigtian::FillCache() const {
+
+    for(unsigned int i=0; i<cache.GetNumNodes(); i++){
+        VoigtProfile profile(mean, width, cache.GetNode(i));
+        cache.SetNode(i, profile.Integrate(x.min(), x.max()), profile.IntegralDSigma(x.min(), x.max()));
+    }
+
+    cacheFilled = true;
+    cacheMean = mean;
+    cacheWidth = width;
+    cacheMin = x.min();
+    cacheMax = x.max();
+}
@@ -46,6 +46,38 @@
 
 #include "TCanvas.h"
 
+#include <cmath>
+#include <algorithm>
+
+
+
+namespace {
+
+// Unnormalized RooCBShape in t = (x - mean) / sigma (mirrored for alpha < 0)
+double CrystalBallShape(double t, double absAlpha, double n){
+
+    if(t >= -absAlpha)
+        return exp(-0.5 * t * t);
+
+    double a = pow(n / absAlpha, n) * exp(-0.5 * absAlpha * absAlpha);
+    double b = n / absAlpha - absAlpha;
+
+    return a / pow(b - t, n);
+}
+
+
+
+// Antiderivative of u^-k
+double PowerIntegral(double u, double k){
+
+    if(k == 1)
+        return log(u);
+
+    return pow(u, 1 - k) / (1 - k);
+}
+
+}
+
 WibCrystalBallFitFunction::WibCrystalBallFitFunction(double particleMeanMass,
                                                      double minMass,
                                                      double maxMass,
@@ -57,7 +89,8 @@ WibCrystalBallFitFunction::WibCrystalBallFitFunction(double particleMeanMass,
                                                      double alphaMin,
                                                      double alphaMax,
                                                      int pn) :
-    WibFitFunction(minMass, maxMass)
+    WibFitFunction(minMass, maxMass),
+    backgroundPolOrder(backgroundPolOrder)
 {
     mean = new RooRealVar("mean", "mean", particleMeanMass - minMass);
     sigma = new RooRealVar("sigma", "sigma", sigmaStart, sigmaMin, sigmaMax);
@@ -95,8 +128,7 @@ WibCrystalBallFitFunction::~WibCrystalBallFitFunction(){
 
 FitResult* WibCrystalBallFitFunction::DoFitD(double eventMass, double eventMass2){
  
-    RooFitResult* rooFitResult = totalIntensity->fitTo(*data, RooFit::Save(true),  RooFit::Verbose(false),
-                                                       RooFit::PrintLevel(-1), RooFit::PrintEvalErrors(-1));
+    RooFitResult* rooFitResult = Minimize();
 
     FitResult* fitResult = new FitResult;
     fitResult->rooFitResult = rooFitResult;
@@ -122,6 +154,90 @@ double WibCrystalBallFitFunction::ReturnCurrentQValue(){
 
 
 
+bool WibCrystalBallFitFunction::GetQGradient(std::vector<double>& gradient){
+
+    RooArgSet invMassArgSet(*mass);
+
+    double r = sigshare->getVal();
+    double s = cbFunction->getVal(&invMassArgSet);
+    double b = polFunction->getVal(&invMassArgSet);
+
+    double x = mass->getVal();
+    double range = GetMaxMass() - GetMinMass();
+    double sig = sigma->getVal();
+    double nVal = n->getVal();
+    double absAlpha = fabs(alpha->getVal());
+    double alphaSign = (alpha->getVal() < 0) ? -1. : 1.;
+
+    double raw = cbFunction->getVal();
+    if(sig <= 0 || absAlpha <= 0 || raw <= 0 || s <= 0)
+        return false;
+
+    double integral = raw / s;
+
+    double t = alphaSign * (x - mean->getVal()) / sig;
+    double tlow = alphaSign * (0 - mean->getVal()) / sig;
+    double thigh = alphaSign * (range - mean->getVal()) / sig;
+    if(tlow > thigh)
+        std::swap(tlow, thigh);
+
+    // Tail A / (B - t)^n, continuous with the core at t = -|alpha|,
+    // with d ln(f) / d|alpha| = tailDA + tailDB / (B - t)
+    double tailB = nVal / absAlpha - absAlpha;
+    double tailDA = -nVal / absAlpha - absAlpha;
+    double tailDB = nVal * (nVal / (absAlpha * absAlpha) + 1);
+
+    double rawDSigma = 0;
+    double rawDAlpha = 0;
+    if(t >= -absAlpha){
+        rawDSigma = raw * t * t / sig;
+    }
+    else{
+        rawDSigma = -nVal * t * raw / (sig * (tailB - t));
+        rawDAlpha = alphaSign * raw * (tailDA + tailDB / (tailB - t));
+    }
+
+    // Pure scale dependence: dI/dsigma = I/sigma - [t * f(t)] over the range
+    double integralDSigma = integral / sig - thigh * CrystalBallShape(thigh, absAlpha, nVal)
+                                           + tlow * CrystalBallShape(tlow, absAlpha, nVal);
+
+    // Only the tail depends on alpha, its integrand is a sum of powers of (B - t)
+    double integralDAlpha = 0;
+    if(tlow < -absAlpha){
+        double tend = (thigh < -absAlpha) ? thigh : -absAlpha;
+        double tailA = pow(nVal / absAlpha, nVal) * exp(-0.5 * absAlpha * absAlpha);
+        double ulow = tailB - tlow;
+        double uhigh = tailB - tend;
+
+        integralDAlpha = alphaSign * sig * tailA *
+                         (tailDA * (PowerIntegral(ulow, nVal) - PowerIntegral(uhigh, nVal)) +
+                          tailDB * (PowerIntegral(ulow, nVal + 1) - PowerIntegral(uhigh, nVal + 1)));
+    }
+
+    std::vector<double> signalGradient(5, 0.);
+    std::vector<double> backgroundGradient(5, 0.);
+
+    signalGradient[0] = (rawDSigma - s * integralDSigma) / integral;
+    signalGradient[4] = (rawDAlpha - s * integralDAlpha) / integral;
+
+    std::vector<double> coefs;
+    if(backgroundPolOrder == 1 || backgroundPolOrder == 2)
+        coefs.push_back(a1->getVal());
+    if(backgroundPolOrder == 2)
+        coefs.push_back(a2->getVal());
+
+    std::vector<double> polGradient;
+    GetPolynomialGradient(x, range, coefs, polGradient);
+    for(size_t k=0; k<polGradient.size(); k++)
+        backgroundGradient[1 + k] = polGradient[k];
+
+    CombineQGradient(r, s, b, signalGradient, backgroundGradient, 3, gradient);
+
+    return true;
+}
+
+
+
 void WibCrystalBallFitFunction::SaveFitToFile(std::string fileName){
 
     double sumOfWeights = data->sumEntries();
@@ -150,3 +266,10 @@ RooArgList WibCrystalBallFitFunction::GetParamList() const {
 
     return RooArgList(*sigma, *a1, *a2, *sigshare, *alpha);
 }
+
+
+
+RooArgList WibCrystalBallFitFunction::GetBackgroundParamList() const {
+
+    return RooArgList(*a1, *a2);
+}
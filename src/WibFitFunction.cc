@@ -36,16 +36,28 @@
 
 #include "WibFitFunction.hh"
 #include "FitResult.hh"
+#include "WibProfile.hh"
+#include "MemoryUsage.hh"
 
 #include "RooRealVar.h"
 #include "RooDataSet.h"
+#include "RooDataHist.h"
 #include "RooAddPdf.h"
+#include "RooMinimizer.h"
+#include "Fit/Fitter.h"
 
+#include <cmath>
+#include <limits>
 
 
 WibFitFunction::WibFitFunction(double pminMass, double pmaxMass) :
     data(NULL),
     totalIntensity(NULL),
+    binnedData(NULL),
+    numBins(0),
+    nll(NULL),
+    minimizer(NULL),
+    lastNumCalls(0),
     calcError(false),
     saveNextFitToFile(false),
     minMass(pminMass),
@@ -54,12 +66,19 @@ WibFitFunction::WibFitFunction(double pminMass, double pmaxMass) :
     mass = new RooRealVar("mass", "mass", 0, maxMass - minMass);
     mass2 = new RooRealVar("mass2", "mass2", 0, maxMass - minMass);
     initialWeight = new RooRealVar("initialWeight", "initialWeight", 0);
+    dataRow = new RooArgSet(*mass, *mass2, *initialWeight);
 }
 
 
 
 WibFitFunction::~WibFitFunction(){
 
+    ResetMinimizer();
+
+    if(binnedData != NULL)
+        delete binnedData;
+
+    delete dataRow;
     delete mass;
     delete mass2;
     delete initialWeight;
@@ -88,23 +107,125 @@ void WibFitFunction::SetCalcErrors(bool set){
 
 
 
+void WibFitFunction::SetBinnedFit(unsigned int pnumBins){
+
+    // 0 switches back to the unbinned likelihood
+    if(pnumBins == numBins)
+        return;
+
+    numBins = pnumBins;
+    ResetMinimizer();
+
+    if(binnedData != NULL){
+        delete binnedData;
+        binnedData = NULL;
+    }
+}
+
+
+
+unsigned int WibFitFunction::GetNumBins() const {
+
+    return numBins;
+}
+
+
+
+void WibFitFunction::SetFitStrategy(const FitStrategy& pfitStrategy){
+
+    fitStrategy = pfitStrategy;
+}
+
+
+
+const FitStrategy& WibFitFunction::GetFitStrategy() const {
+
+    return fitStrategy;
+}
+
+
+
 FitResult* WibFitFunction::DoFit(double eventMass, double eventMass2){
 
-    if(data == NULL)
-        return NULL;
+    // The start values and errors of the constructor, before a fit or a
+    // stored result changes them
+    SaveDefaultStart();
+
+    // Fit functions without RooFit work on the buffers and have no dataset
+    if(data != NULL){
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_FILL_DATASET);
+        FillDataSet();
+    }
 
+    FitResult* fitResult;
+    lastNumCalls = 0;
+    {
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_FIT);
+        fitResult = DoFitD(eventMass - minMass, eventMass2 - minMass);
+    }
 
-    FitResult* fitResult = DoFitD(eventMass - minMass, eventMass2 - minMass);
+    if(fitResult != NULL && fitResult->numCalls == 0)
+        fitResult->numCalls = lastNumCalls;
 
     if(saveNextFitToFile){
         SaveFitToFile(saveNextFitFileName);
         saveNextFitToFile = false;
     }
 
-    data->reset();
+    ClearData();
+
+    return FinishFit(fitResult);
+}
+
+
+
+FitResult* WibFitFunction::EvaluateFit(const RooFitResult& rooFitResult, double eventMass, double eventMass2){
+
+    // Restore the converged parameters of an earlier fit and only evaluate
+    // Q and its error at the new event mass
+    SaveDefaultStart();
+
+    const RooArgList& finalParams = rooFitResult.floatParsFinal();
+    RooArgList unorderedLocalParams = GetParamList();
+
+    for(int i=0; i<finalParams.getSize(); i++){
+        RooRealVar* currentRefVar = dynamic_cast<RooRealVar*>(finalParams.at(i));
+        int index = unorderedLocalParams.index(currentRefVar->GetName());
+
+        if(index < 0){
+            std::cout << "ERROR: could not find parameter " << currentRefVar->GetName()
+                      << " in ::GetParamList() List" << std::endl;
+            return NULL;
+        }
+
+        RooRealVar* currentModVar = dynamic_cast<RooRealVar*>(unorderedLocalParams.at(index));
+        currentModVar->setVal(currentRefVar->getVal());
+        currentModVar->setError(currentRefVar->getError());
+    }
+
+    FitResult* fitResult = new FitResult;
+    fitResult->rooFitResult = new RooFitResult(rooFitResult);
+
+    mass->setVal(eventMass - minMass);
+    fitResult->weight = ReturnCurrentQValue();
+
+    return FinishFit(fitResult);
+}
+
+
+
+FitResult* WibFitFunction::FinishFit(FitResult* fitResult){
+
+    // Fits without RooFit fill the result themselves
+    if(fitResult == NULL || fitResult->rooFitResult == NULL)
+        return fitResult;
 
-    // Check parameters
     RooFitResult* rooFitResult = fitResult->rooFitResult;
+    fitResult->status = rooFitResult->status();
+    fitResult->covQual = rooFitResult->covQual();
+    fitResult->edm = rooFitResult->edm();
+
+    // Check parameters
     const RooArgList finalParams = rooFitResult->floatParsFinal();
     const int nFreeParams = finalParams.getSize();
     const RooArgList initialParams = rooFitResult->floatParsInit();
@@ -123,13 +244,23 @@ FitResult* WibFitFunction::DoFit(double eventMass, double eventMass2){
 
     // Calculate error
     if(GetCalcError()){
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_ERROR);
+        std::vector<double> gradient;
+        bool analytic = GetQGradient(gradient);
         std::vector<double> derivatives;
 
         for(int i=0; i<nFreeParams; i++){
             RooRealVar* currentRefVar = dynamic_cast<RooRealVar*>(finalParams.at(i));              // Insert better idea to match
             int index = unorderedLocalParams.index(currentRefVar->GetName());                      // covariances with local scoped
             RooRealVar* currentModVar = dynamic_cast<RooRealVar*>(unorderedLocalParams.at(index)); // fit parameters
+
+            if(analytic){
+                derivatives.push_back(gradient.at(index));
+                continue;
+            }
+
             double epsilon = currentRefVar->getError() * 0.01;
+            WIBAS_PROFILE_COUNT(WibProfile::COUNT_Q_EVALUATIONS, 2);
 
             currentModVar->setVal(currentRefVar->getVal() + epsilon);
             double whigh = ReturnCurrentQValue();
@@ -143,7 +274,7 @@ FitResult* WibFitFunction::DoFit(double eventMass, double eventMass2){
         }
 
         // Do gaussian error propagation
-        const TMatrixDSym cov = rooFitResult->covarianceMatrix();
+        const TMatrixDSym& cov = rooFitResult->covarianceMatrix();
 
         double errsq = 0;
         for(int i=0; i<nFreeParams; i++){
@@ -168,6 +299,149 @@ FitResult* WibFitFunction::DoFit(double eventMass, double eventMass2){
 
 
 
+void WibFitFunction::SaveDefaultStart(){
+
+    if(!defaultStart.empty())
+        return;
+
+    RooArgList params = GetParamList();
+    for(int i=0; i<params.getSize(); i++){
+        defaultStart.push_back(dynamic_cast<RooRealVar*>(params.at(i))->getVal());
+        defaultError.push_back(dynamic_cast<RooRealVar*>(params.at(i))->getError());
+    }
+}
+
+
+
+void WibFitFunction::SetAlternativeStart(unsigned int attempt){
+
+    // Attempt 0 restores the start values of the constructor. The errors
+    // are the initial step sizes of Minuit, the fit writes them back, so
+    // every attempt also restores them.
+    SaveDefaultStart();
+
+    RooArgList params = GetParamList();
+    RooArgList backgroundParams = GetBackgroundParamList();
+
+    for(int i=0; i<params.getSize(); i++){
+        RooRealVar* param = dynamic_cast<RooRealVar*>(params.at(i));
+        bool background = backgroundParams.index(param->GetName()) >= 0;
+
+        param->setError(defaultError.at(i));
+        if(attempt == 0)
+            param->setVal(defaultStart.at(i));
+        else if(!param->isConstant())
+            param->setVal(GetAlternativeStart(defaultStart.at(i), param->getMin(), param->getMax(), attempt, background));
+    }
+}
+
+
+
+void WibFitFunction::SetBackgroundFixed(bool fixed){
+
+    // A fixed background is flat, releasing it restores the start values
+    SaveDefaultStart();
+
+    RooArgList params = GetParamList();
+    RooArgList backgroundParams = GetBackgroundParamList();
+
+    for(int i=0; i<params.getSize(); i++){
+        RooRealVar* param = dynamic_cast<RooRealVar*>(params.at(i));
+
+        if(backgroundParams.index(param->GetName()) < 0)
+            continue;
+
+        param->setVal(fixed ? 0. : defaultStart.at(i));
+        param->setConstant(fixed);
+    }
+}
+
+
+
+RooArgList WibFitFunction::GetBackgroundParamList() const {
+
+    return RooArgList();
+}
+
+
+
+double WibFitFunction::GetAlternativeStart(double start, double min, double max, unsigned int attempt, bool background){
+
+    // Odd attempts move the start value towards the lower limit, even ones
+    // towards the upper limit, by a third of the distance per pair of
+    // attempts. Background coefficients start flat.
+    if(background)
+        return 0.;
+
+    double fraction = ((attempt + 1) / 2) / 3.;
+    fraction = (fraction > 0.9) ? 0.9 : fraction;
+
+    return (attempt % 2 == 1) ? start + fraction * (min - start) : start + fraction * (max - start);
+}
+
+
+
+bool WibFitFunction::GetQGradient(std::vector<double>& gradient){
+
+    // No analytic derivatives available, DoFit falls back to finite differences
+    return false;
+}
+
+
+
+void WibFitFunction::CombineQGradient(double share,
+                                      double signal,
+                                      double background,
+                                      const std::vector<double>& signalGradient,
+                                      const std::vector<double>& backgroundGradient,
+                                      int shareIndex,
+                                      std::vector<double>& gradient) const {
+
+    // Q = r*s / (r*s + (1-r)*b), with s and b the normalized densities at the event
+    double denom = share * signal + (1 - share) * background;
+    double scale = share * (1 - share) / (denom * denom);
+
+    gradient.resize(signalGradient.size());
+    for(size_t i=0; i<gradient.size(); i++)
+        gradient[i] = scale * (background * signalGradient[i] - signal * backgroundGradient[i]);
+
+    gradient.at(shareIndex) += signal * background / (denom * denom);
+}
+
+
+
+void WibFitFunction::GetPolynomialGradient(double x,
+                                           double range,
+                                           const std::vector<double>& coefs,
+                                           std::vector<double>& gradient){
+
+    // Background density (1 + a1*x + a2*x^2 + ...) / I normalized on [0, range]
+    double value = 1;
+    double integral = range;
+    double xpow = 1;
+    double rpow = range;
+
+    for(size_t k=0; k<coefs.size(); k++){
+        xpow *= x;
+        rpow *= range;
+        value += coefs[k] * xpow;
+        integral += coefs[k] * rpow / (k + 2);
+    }
+
+    double density = value / integral;
+
+    gradient.resize(coefs.size());
+    xpow = 1;
+    rpow = range;
+    for(size_t k=0; k<coefs.size(); k++){
+        xpow *= x;
+        rpow *= range;
+        gradient[k] = (xpow - density * rpow / (k + 2)) / integral;
+    }
+}
+
+
+
 void WibFitFunction::SaveNextFitToFile(std::string fileName){
 
     saveNextFitToFile = true;
@@ -178,16 +452,190 @@ void WibFitFunction::SaveNextFitToFile(std::string fileName){
 
 void WibFitFunction::AddData(const PhasespacePoint& phasespacePoint){
 
-    mass->setVal(phasespacePoint.GetMass() - minMass);
-    initialWeight->setVal(phasespacePoint.GetInitialWeight());
+    massBuffer.push_back(phasespacePoint.GetMass() - minMass);
+    mass2Buffer.push_back(phasespacePoint.IsMass2Set() ? phasespacePoint.GetMass2() - minMass
+                                                       : std::numeric_limits<double>::quiet_NaN());
+    weightBuffer.push_back(phasespacePoint.GetInitialWeight());
+}
+
+
+
+void WibFitFunction::SetData(size_t numPoints, const double* masses, const double* masses2, const double* weights){
+
+    // Masses are absolute like in AddData, masses2 may be NULL for 1D fits
+    massBuffer.resize(numPoints);
+    mass2Buffer.resize(numPoints);
+    weightBuffer.resize(numPoints);
+
+    for(size_t i=0; i<numPoints; i++){
+        massBuffer[i] = masses[i] - minMass;
+        mass2Buffer[i] = (masses2 != NULL) ? masses2[i] - minMass : std::numeric_limits<double>::quiet_NaN();
+        weightBuffer[i] = weights[i];
+    }
+}
+
+
+
+void WibFitFunction::ClearData(){
+
+    massBuffer.clear();
+    mass2Buffer.clear();
+    weightBuffer.clear();
+}
 
-    if(phasespacePoint.IsMass2Set()){
-        mass2->setVal(phasespacePoint.GetMass2() - minMass);
-        data->add(RooArgSet(*mass, *mass2, *initialWeight));
+
+
+size_t WibFitFunction::GetNumData() const {
+
+    return massBuffer.size();
+}
+
+
+
+void WibFitFunction::FillDataSet(){
+
+    // The unbinned dataset is only needed for the plot in binned mode
+    if(numBins == 0 || saveNextFitToFile){
+        data->reset();
+
+        for(size_t i=0; i<massBuffer.size(); i++){
+            mass->setVal(massBuffer[i]);
+
+            if(!std::isnan(mass2Buffer[i]))
+                mass2->setVal(mass2Buffer[i]);
+
+            initialWeight->setVal(weightBuffer[i]);
+            data->add(*dataRow, weightBuffer[i]);
+        }
+    }
+
+    if(numBins == 0)
         return;
+
+    // Histogram of the neighbors in numBins bins over [minMass, maxMass]
+    // per mass dimension of the dataset
+    if(binnedData == NULL){
+        mass->setBins(numBins);
+        mass2->setBins(numBins);
+        binnedData = new RooDataHist("binnedData", "binnedData", *data->get());
     }
 
-    data->add(RooArgSet(*mass, *initialWeight));
+    binnedData->reset();
+
+    for(size_t i=0; i<massBuffer.size(); i++){
+        mass->setVal(massBuffer[i]);
+
+        if(!std::isnan(mass2Buffer[i]))
+            mass2->setVal(mass2Buffer[i]);
+
+        binnedData->add(*dataRow, weightBuffer[i], weightBuffer[i] * weightBuffer[i]);
+    }
+}
+
+
+
+void WibFitFunction::ResetMinimizer(){
+
+    if(minimizer != NULL){
+        delete minimizer;
+        minimizer = NULL;
+    }
+
+    if(nll != NULL){
+        delete nll;
+        nll = NULL;
+    }
+}
+
+
+
+RooFitResult* WibFitFunction::Minimize(){
+
+    // The likelihood and the minimizer are built once and only see a new
+    // dataset per event, instead of rebuilding the RooFit caches in fitTo.
+    // On a RooDataHist the NLL is the weighted sum -sum_i w_i log pdf(c_i)
+    // over the bin contents w_i at the bin centres c_i. This is not the
+    // extended Poisson likelihood of the bins, the pdf is not integrated over
+    // the bins, which biases shapes narrow against the bin width. Its cost
+    // only depends on the number of bins.
+    RooAbsData* fitData = (numBins > 0) ? static_cast<RooAbsData*>(binnedData) : static_cast<RooAbsData*>(data);
+
+    if(nll == NULL){
+        nll = totalIntensity->createNLL(*fitData, RooFit::CloneData(false));
+        minimizer = new RooMinimizer(*nll);
+        minimizer->setPrintLevel(-1);
+        minimizer->setPrintEvalErrors(-1);
+        minimizer->setVerbose(false);
+    }
+    else{
+        nll->setData(*fitData, false);
+    }
+
+    minimizer->setStrategy(fitStrategy.strategy);
+
+    if(fitStrategy.tolerance > 0)
+        minimizer->setEps(fitStrategy.tolerance);
+
+    if(fitStrategy.maxCalls > 0){
+        minimizer->setMaxFunctionCalls(fitStrategy.maxCalls);
+        minimizer->setMaxIterations(fitStrategy.maxCalls);
+    }
+
+    int status;
+    {
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_MINIMIZE);
+        status = minimizer->minimize(fitStrategy.minimizerType.c_str(), fitStrategy.algorithm.c_str());
+    }
+
+    // HESSE only runs on converged fits, so the saved status still reports
+    // a failed minimization
+    bool runHesse = (fitStrategy.hesseMode == FitStrategy::HESSE_ALWAYS) ||
+                    (fitStrategy.hesseMode == FitStrategy::HESSE_AUTO && calcError);
+
+    if(runHesse && status == 0){
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_HESSE);
+        minimizer->hesse();
+    }
+
+    if(minimizer->fitter() != NULL)
+        lastNumCalls = minimizer->fitter()->Result().NCalls();
+
+    return minimizer->save();
+}
+
+
+
+size_t WibFitFunction::GetMemoryUsage() const {
+
+    // Neighbor buffers and the columns of the dataset (mass, mass2,
+    // initialWeight and the event weights), the RooFit objects are not counted
+    size_t bytes = MemoryUsage::GetVectorBytes(massBuffer.capacity(), sizeof(double)) +
+                   MemoryUsage::GetVectorBytes(mass2Buffer.capacity(), sizeof(double)) +
+                   MemoryUsage::GetVectorBytes(weightBuffer.capacity(), sizeof(double));
+
+    if(data != NULL && (numBins == 0 || saveNextFitToFile))
+        bytes += 4 * MemoryUsage::GetVectorBytes(massBuffer.capacity(), sizeof(double));
+
+    if(binnedData != NULL)
+        bytes += 4 * MemoryUsage::GetVectorBytes(binnedData->numEntries(), sizeof(double));
+
+    return bytes;
+}
+
+
+
+size_t WibFitFunction::EstimateMemoryUsage(unsigned int numNeighbors, unsigned int numBins){
+
+    // RooFit fit functions in unbinned mode, or binned in both masses
+    size_t capacity = MemoryUsage::GetGrownCapacity(numNeighbors);
+    size_t bytes = 3 * MemoryUsage::GetVectorBytes(capacity, sizeof(double));
+
+    if(numBins == 0)
+        bytes += 4 * MemoryUsage::GetVectorBytes(capacity, sizeof(double));
+    else
+        bytes += 4 * MemoryUsage::GetVectorBytes(numBins * numBins, sizeof(double));
+
+    return bytes;
 }
 
 
@@ -46,6 +46,8 @@
 
 #include "TCanvas.h"
 
+#include <cmath>
+
 
 
 WibGaussFitFunction::WibGaussFitFunction(double particleMeanMass,
@@ -55,7 +57,8 @@ WibGaussFitFunction::WibGaussFitFunction(double particleMeanMass,
                                          double gaussSigmaStart,
                                          double gaussSigmaMin,
                                          double gaussSigmaMax) :
-    WibFitFunction(minMass, maxMass)
+    WibFitFunction(minMass, maxMass),
+    backgroundPolOrder(backgroundPolOrder)
 {
     mean = new RooRealVar("mean", "mean", particleMeanMass - minMass);
     sigma = new RooRealVar("sigma", "sigma", gaussSigmaStart, gaussSigmaMin, gaussSigmaMax);
@@ -89,8 +92,7 @@ WibGaussFitFunction::~WibGaussFitFunction(){
 
 FitResult* WibGaussFitFunction::DoFitD(double eventMass, double eventMass2){
  
-    RooFitResult* rooFitResult = totalIntensity->fitTo(*data, RooFit::Save(true),  RooFit::Verbose(false),
-                                                       RooFit::PrintLevel(-1), RooFit::PrintEvalErrors(-1));
+    RooFitResult* rooFitResult = Minimize();
 
     FitResult* fitResult = new FitResult;
     fitResult->rooFitResult = rooFitResult;
@@ -116,6 +118,49 @@ double WibGaussFitFunction::ReturnCurrentQValue(){
 
 
 
+bool WibGaussFitFunction::GetQGradient(std::vector<double>& gradient){
+
+    RooArgSet invMassArgSet(*mass);
+
+    double r = sigshare->getVal();
+    double s = gaussFunction->getVal(&invMassArgSet);
+    double b = polFunction->getVal(&invMassArgSet);
+
+    double x = mass->getVal();
+    double range = GetMaxMass() - GetMinMass();
+    double sig = sigma->getVal();
+
+    // Gaussian exp(-t^2/2) with t = (x - mean) / sigma, normalized on [0, range].
+    // For a pure scale dependence dI/dsigma = I/sigma - [t * exp(-t^2/2)] over the range.
+    double t = (x - mean->getVal()) / sig;
+    double tlow = -mean->getVal() / sig;
+    double thigh = (range - mean->getVal()) / sig;
+    double integral = sig * sqrt(M_PI / 2.) * (erf(thigh / sqrt(2.)) - erf(tlow / sqrt(2.)));
+    double integralDSigma = integral / sig - thigh * exp(-0.5 * thigh * thigh) + tlow * exp(-0.5 * tlow * tlow);
+
+    std::vector<double> signalGradient(4, 0.);
+    std::vector<double> backgroundGradient(4, 0.);
+
+    signalGradient[0] = (exp(-0.5 * t * t) * t * t / sig - s * integralDSigma) / integral;
+
+    std::vector<double> coefs;
+    if(backgroundPolOrder == 1 || backgroundPolOrder == 2)
+        coefs.push_back(a1->getVal());
+    if(backgroundPolOrder == 2)
+        coefs.push_back(a2->getVal());
+
+    std::vector<double> polGradient;
+    GetPolynomialGradient(x, range, coefs, polGradient);
+    for(size_t k=0; k<polGradient.size(); k++)
+        backgroundGradient[1 + k] = polGradient[k];
+
+    CombineQGradient(r, s, b, signalGradient, backgroundGradient, 3, gradient);
+
+    return true;
+}
+
+
+
 void WibGaussFitFunction::SaveFitToFile(std::string fileName){
 
     double sumOfWeights = data->sumEntries();
@@ -144,3 +189,10 @@ RooArgList WibGaussFitFunction::GetParamList() const {
 
     return RooArgList(*sigma, *a1, *a2, *sigshare);
 }
+
+
+
+RooArgList WibGaussFitFunction::GetBackgroundParamList() const {
+
+    return RooArgList(*a1, *a2);
+}
@@ -0,0 +1,231 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+#include "WibProfile.hh"
+
+
+const short WibProfile::STAGE_CALCWEIGHT;
+const short WibProfile::STAGE_DISTANCES;
+const short WibProfile::STAGE_SORT;
+const short WibProfile::STAGE_CACHE;
+const short WibProfile::STAGE_ADD_DATA;
+const short WibProfile::STAGE_FILL_DATASET;
+const short WibProfile::STAGE_FIT;
+const short WibProfile::STAGE_MINIMIZE;
+const short WibProfile::STAGE_HESSE;
+const short WibProfile::STAGE_ERROR;
+const short WibProfile::STAGE_FALLBACK;
+const short WibProfile::STAGE_OUTPUT;
+const short WibProfile::NUM_STAGES;
+const short WibProfile::COUNT_EVENTS;
+const short WibProfile::COUNT_NEIGHBORS;
+const short WibProfile::COUNT_FITS;
+const short WibProfile::COUNT_CACHE_HITS;
+const short WibProfile::COUNT_FALLBACKS;
+const short WibProfile::COUNT_FAILED;
+const short WibProfile::COUNT_Q_CLIPPED;
+const short WibProfile::COUNT_Q_EVALUATIONS;
+const short WibProfile::NUM_COUNTERS;
+
+
+
+namespace {
+
+const char* stageNames[] = {"CalcWeight", "distances", "sort", "cache lookup", "AddData",
+                            "fill dataset", "fit", "minimize", "hesse", "error propagation",
+                            "fallback", "output"};
+
+const char* counterNames[] = {"events", "neighbors", "fits", "cache hits", "fallbacks",
+                              "failed", "Q clipped", "Q evaluations"};
+
+
+// Records of the running threads and the sum of the finished ones
+std::mutex registryMutex;
+std::vector<WibProfile::Stats*> liveStats;
+WibProfile::Stats finishedStats;
+
+
+class ThreadStats
+{
+    public:
+        ThreadStats(){
+            std::lock_guard<std::mutex> lock(registryMutex);
+            liveStats.push_back(&_stats);
+        }
+
+        ~ThreadStats(){
+            std::lock_guard<std::mutex> lock(registryMutex);
+            finishedStats += _stats;
+            liveStats.erase(std::remove(liveStats.begin(), liveStats.end(), &_stats), liveStats.end());
+        }
+
+        WibProfile::Stats _stats;
+};
+
+
+thread_local ThreadStats threadStats;
+
+}
+
+
+
+WibProfile::Stats::Stats(){
+
+    std::fill(seconds, seconds + NUM_STAGES, 0.);
+    std::fill(calls, calls + NUM_STAGES, 0ULL);
+    std::fill(counts, counts + NUM_COUNTERS, 0ULL);
+}
+
+
+
+WibProfile::Stats& WibProfile::Stats::operator+=(const Stats& other){
+
+    for(short i=0; i<NUM_STAGES; i++){
+        seconds[i] += other.seconds[i];
+        calls[i] += other.calls[i];
+    }
+
+    for(short i=0; i<NUM_COUNTERS; i++)
+        counts[i] += other.counts[i];
+
+    return *this;
+}
+
+
+
+bool WibProfile::IsEnabled(){
+
+#ifdef WIBAS_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+void WibProfile::AddTime(short stage, double seconds){
+
+    threadStats._stats.seconds[stage] += seconds;
+    threadStats._stats.calls[stage]++;
+}
+
+
+
+void WibProfile::AddCount(short counter, unsigned long long n){
+
+    threadStats._stats.counts[counter] += n;
+}
+
+
+
+WibProfile::Stats WibProfile::GetStats(){
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Stats merged = finishedStats;
+
+    for(size_t i=0; i<liveStats.size(); i++)
+        merged += *liveStats[i];
+
+    return merged;
+}
+
+
+
+void WibProfile::Reset(){
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    finishedStats = Stats();
+
+    for(size_t i=0; i<liveStats.size(); i++)
+        *liveStats[i] = Stats();
+}
+
+
+
+void WibProfile::PrintSummary(std::ostream& out){
+
+    if(!IsEnabled()){
+        out << "INFO: stage timers are disabled, rebuild with -DWIBAS_PROFILE" << std::endl;
+        return;
+    }
+
+    Stats stats = GetStats();
+    double total = stats.seconds[STAGE_CALCWEIGHT];
+
+    out << "INFO: CalcWeight stage timers (summed over threads)" << std::endl;
+    out << std::left << std::setw(20) << "stage" << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "seconds" << std::setw(14) << "us/call" << std::setw(10) << "share" << std::endl;
+
+    for(short i=0; i<NUM_STAGES; i++){
+        if(stats.calls[i] == 0)
+            continue;
+
+        // Minimize and hesse are part of the fit stage
+        bool nested = (i == STAGE_MINIMIZE || i == STAGE_HESSE);
+
+        out << std::left << std::setw(20) << (std::string(nested ? "  " : "") + stageNames[i]) << std::right
+            << std::setw(12) << stats.calls[i]
+            << std::setw(14) << stats.seconds[i]
+            << std::setw(14) << stats.seconds[i] / stats.calls[i] * 1E6
+            << std::setw(9) << ((total > 0) ? 100. * stats.seconds[i] / total : 0.) << "%" << std::endl;
+    }
+
+    for(short i=0; i<NUM_COUNTERS; i++)
+        out << std::left << std::setw(20) << counterNames[i] << std::right << std::setw(12) << stats.counts[i] << std::endl;
+}
+
+
+
+const char* WibProfile::GetStageName(short stage){
+
+    return stageNames[stage];
+}
+
+
+
+const char* WibProfile::GetCounterName(short counter){
+
+    return counterNames[counter];
+}
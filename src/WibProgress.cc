@@ -0,0 +1,248 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <cstdio>
+#include <fstream>
+
+#include "WibProgress.hh"
+#include "WibProfile.hh"
+
+
+const double WibProgress::LATENCY_SMOOTHING = 0.05;
+
+
+
+WibProgress::WibProgress(unsigned long pnumTotal, unsigned int pnumWorkers) :
+    numTotal(pnumTotal),
+    numWorkers(pnumWorkers > 0 ? pnumWorkers : 1),
+    workerSlots(NULL),
+    startTime(std::chrono::steady_clock::now()),
+    lastReportTime(startTime),
+    lastReportDone(0),
+    running(false)
+{
+    workerSlots = new WorkerSlot[numWorkers];
+
+    for(unsigned int i=0; i<numWorkers; i++){
+        workerSlots[i].done.store(0, std::memory_order_relaxed);
+        workerSlots[i].failed.store(0, std::memory_order_relaxed);
+        workerSlots[i].latency.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+
+WibProgress::~WibProgress(){
+
+    Stop();
+    delete[] workerSlots;
+}
+
+
+
+void WibProgress::AddEvent(unsigned int worker, bool success, double seconds){
+
+    // Only the worker itself writes its slot, so plain loads and stores suffice
+    WorkerSlot& slot = workerSlots[worker % numWorkers];
+    unsigned long done = slot.done.load(std::memory_order_relaxed);
+    double latency = slot.latency.load(std::memory_order_relaxed);
+
+    latency = (done == 0) ? seconds : (1 - LATENCY_SMOOTHING) * latency + LATENCY_SMOOTHING * seconds;
+
+    slot.latency.store(latency, std::memory_order_relaxed);
+    slot.done.store(done + 1, std::memory_order_relaxed);
+
+    if(!success)
+        slot.failed.store(slot.failed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+
+ProgressStatus WibProgress::GetStatus(){
+
+    std::lock_guard<std::mutex> lock(statusMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    ProgressStatus status;
+    status.numTotal = numTotal;
+    status.numDone = 0;
+    status.numFailed = 0;
+    status.meanLatency = 0;
+
+    unsigned int numActive = 0;
+
+    for(unsigned int i=0; i<numWorkers; i++){
+        unsigned long done = workerSlots[i].done.load(std::memory_order_relaxed);
+        unsigned long failed = workerSlots[i].failed.load(std::memory_order_relaxed);
+        double latency = workerSlots[i].latency.load(std::memory_order_relaxed);
+
+        status.workerDone.push_back(done);
+        status.workerFailed.push_back(failed);
+        status.workerLatency.push_back(latency);
+        status.numDone += done;
+        status.numFailed += failed;
+
+        if(done > 0){
+            status.meanLatency += latency;
+            numActive++;
+        }
+    }
+
+    if(numActive > 0)
+        status.meanLatency /= numActive;
+
+    status.elapsedSeconds = std::chrono::duration<double>(now - startTime).count();
+    double sinceLastReport = std::chrono::duration<double>(now - lastReportTime).count();
+
+    status.eventsPerSecond = (status.elapsedSeconds > 0) ? status.numDone / status.elapsedSeconds : 0;
+    status.recentEventsPerSecond = (sinceLastReport > 0) ? (status.numDone - lastReportDone) / sinceLastReport
+                                                         : status.eventsPerSecond;
+
+    double rate = (status.recentEventsPerSecond > 0) ? status.recentEventsPerSecond : status.eventsPerSecond;
+    status.etaSeconds = (rate > 0 && status.numDone <= numTotal) ? (numTotal - status.numDone) / rate : -1;
+
+    lastReportTime = now;
+    lastReportDone = status.numDone;
+
+    return status;
+}
+
+
+
+bool WibProgress::WriteStatusFile(const std::string& fileName, const ProgressStatus& status) const {
+
+    WIBAS_PROFILE_SCOPE(WibProfile::STAGE_OUTPUT);
+
+    std::string tempFileName = fileName + ".tmp";
+    std::ofstream out(tempFileName.c_str());
+
+    if(!out.is_open())
+        return false;
+
+    out << "{\n"
+        << "  \"total\": " << status.numTotal << ",\n"
+        << "  \"done\": " << status.numDone << ",\n"
+        << "  \"failed\": " << status.numFailed << ",\n"
+        << "  \"elapsed_s\": " << status.elapsedSeconds << ",\n"
+        << "  \"events_per_s\": " << status.eventsPerSecond << ",\n"
+        << "  \"recent_events_per_s\": " << status.recentEventsPerSecond << ",\n"
+        << "  \"mean_latency_s\": " << status.meanLatency << ",\n"
+        << "  \"eta_s\": " << status.etaSeconds << ",\n"
+        << "  \"workers\": [";
+
+    for(size_t i=0; i<status.workerDone.size(); i++){
+        out << ((i > 0) ? ",\n" : "\n") << "    {\"done\": " << status.workerDone[i]
+            << ", \"failed\": " << status.workerFailed[i]
+            << ", \"latency_s\": " << status.workerLatency[i] << "}";
+    }
+
+    out << "\n  ]\n}\n";
+    out.close();
+
+    if(out.fail())
+        return false;
+
+    // rename replaces the old status file atomically
+    return std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+}
+
+
+
+void WibProgress::PrintStatus(std::ostream& out, const ProgressStatus& status) const {
+
+    out << "INFO: " << status.numDone << " / " << status.numTotal << " events ("
+        << ((status.numTotal > 0) ? 100. * status.numDone / status.numTotal : 0.) << "%), "
+        << status.recentEventsPerSecond << " events/s, "
+        << status.meanLatency * 1E3 << " ms per event, "
+        << status.numFailed << " failed, ETA ";
+
+    if(status.etaSeconds < 0)
+        out << "unknown" << std::endl;
+    else
+        out << status.etaSeconds << " s" << std::endl;
+}
+
+
+
+void WibProgress::Start(const std::string& statusFileName, double intervalSeconds, bool print){
+
+    std::lock_guard<std::mutex> lock(reportMutex);
+
+    if(running)
+        return;
+
+    running = true;
+    reportThread = std::thread(&WibProgress::ReportLoop, this, statusFileName, intervalSeconds, print);
+}
+
+
+
+void WibProgress::Stop(){
+
+    {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        if(!running)
+            return;
+        running = false;
+    }
+
+    reportCondition.notify_all();
+    reportThread.join();
+}
+
+
+
+void WibProgress::ReportLoop(std::string statusFileName, double intervalSeconds, bool print){
+
+    std::unique_lock<std::mutex> lock(reportMutex);
+    bool finished = false;
+
+    // One report per interval and a final one after Stop
+    while(!finished){
+        finished = reportCondition.wait_for(lock, std::chrono::duration<double>(intervalSeconds),
+                                            [this](){ return !running; });
+
+        ProgressStatus status = GetStatus();
+
+        if(!statusFileName.empty() && !WriteStatusFile(statusFileName, status))
+            std::cout << "WARNING: could not write progress file " << statusFileName << std::endl;
+
+        if(print)
+            PrintStatus(std::cout, status);
+    }
+}
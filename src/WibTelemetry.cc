@@ -0,0 +1,387 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+
+#include "WibTelemetry.hh"
+#include "WibProfile.hh"
+
+
+const short WibTelemetry::FORMAT_CSV;
+const short WibTelemetry::FORMAT_BINARY;
+const char WibTelemetry::BINARY_MAGIC[8] = {'W', 'I', 'B', 'A', 'S', 'T', 'E', 'L'};
+
+
+
+TelemetryHistogram::TelemetryHistogram(double low, double high, unsigned int numBins, bool logScale) :
+    _low(logScale ? log10(low) : low),
+    _high(logScale ? log10(high) : high),
+    _logScale(logScale),
+    _counts(numBins, 0),
+    _underflow(0),
+    _overflow(0),
+    _entries(0)
+{
+}
+
+
+
+void TelemetryHistogram::Fill(double x){
+
+    _entries++;
+
+    if(_logScale && x <= 0){
+        _underflow++;
+        return;
+    }
+
+    // NaN goes to the underflow, values just below _high may round up to
+    // the number of bins
+    double value = _logScale ? log10(x) : x;
+
+    if(!(value >= _low)){
+        _underflow++;
+    }
+    else if(value >= _high){
+        _overflow++;
+    }
+    else{
+        unsigned int bin = static_cast<unsigned int>((value - _low) / (_high - _low) * _counts.size());
+        _counts[std::min(bin, static_cast<unsigned int>(_counts.size() - 1))]++;
+    }
+}
+
+
+
+void TelemetryHistogram::Clear(){
+
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _underflow = 0;
+    _overflow = 0;
+    _entries = 0;
+}
+
+
+
+double TelemetryHistogram::GetBinLowEdge(unsigned int bin) const {
+
+    double edge = _low + bin * (_high - _low) / _counts.size();
+    return _logScale ? pow(10., edge) : edge;
+}
+
+
+
+void TelemetryHistogram::Print(std::ostream& out, const std::string& title) const {
+
+    out << title << " (" << _entries << " entries)" << std::endl;
+    out << "  " << std::setw(12) << "< " << std::setw(10) << GetBinLowEdge(0) << ": " << _underflow << std::endl;
+
+    for(unsigned int i=0; i<_counts.size(); i++){
+        if(_counts[i] > 0)
+            out << "  " << std::setw(12) << GetBinLowEdge(i) << " - " << std::setw(10) << GetBinLowEdge(i + 1)
+                << ": " << _counts[i] << std::endl;
+    }
+
+    out << "  " << std::setw(12) << ">= " << std::setw(10) << GetBinLowEdge(_counts.size()) << ": " << _overflow << std::endl;
+}
+
+
+
+TelemetrySummary::TelemetrySummary() :
+    numRecords(0),
+    numDropped(0),
+    numClippedHigh(0),
+    numClippedLow(0),
+    edm(1E-12, 1., 12, true),
+    numCalls(10, 1E5, 8, true),
+    seconds(1E-5, 10., 12, true)
+{
+}
+
+
+
+WibTelemetry::WibTelemetry(unsigned int capacity) :
+    _slots(NULL),
+    _mask(0),
+    _enqueuePos(0),
+    _dequeuePos(0),
+    _numDropped(0),
+    _format(FORMAT_CSV),
+    _running(false)
+{
+    // Capacity rounded up to a power of two
+    size_t size = 2;
+    while(size < capacity)
+        size *= 2;
+
+    _slots = new Slot[size];
+    _mask = size - 1;
+
+    for(size_t i=0; i<size; i++)
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+
+WibTelemetry::~WibTelemetry(){
+
+    Stop();
+    Drain();
+    delete[] _slots;
+}
+
+
+
+bool WibTelemetry::OpenSink(const std::string& fileName, short format){
+
+    std::lock_guard<std::mutex> lock(_drainMutex);
+
+    if(_sink.is_open())
+        _sink.close();
+
+    _format = format;
+    _sink.open(fileName.c_str(), (format == FORMAT_BINARY) ? std::ios::out | std::ios::binary : std::ios::out);
+
+    if(!_sink.is_open()){
+        std::cout << "ERROR: could not open telemetry sink " << fileName << std::endl;
+        return false;
+    }
+
+    if(format == FORMAT_BINARY){
+        unsigned int recordSize = sizeof(TelemetryRecord);
+        _sink.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        _sink.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+    }
+    else{
+        _sink << "event,source,status,covQual,rung,clip,numCalls,numNeighbors,q,weightError,edm,seconds\n";
+    }
+
+    return true;
+}
+
+
+
+bool WibTelemetry::Push(const TelemetryRecord& record){
+
+    // Bounded multi-producer queue after D. Vyukov: a slot is free for
+    // position pos if its sequence equals pos, and filled if it is pos + 1
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for(;;){
+        slot = &_slots[pos & _mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long difference = static_cast<long>(sequence) - static_cast<long>(pos);
+
+        if(difference == 0){
+            if(_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0){
+            _numDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else{
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+
+bool WibTelemetry::Pop(TelemetryRecord& record){
+
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for(;;){
+        slot = &_slots[pos & _mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long difference = static_cast<long>(sequence) - static_cast<long>(pos + 1);
+
+        if(difference == 0){
+            if(_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0){
+            return false;
+        }
+        else{
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record = slot->record;
+    slot->sequence.store(pos + _mask + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+
+unsigned long WibTelemetry::Drain(){
+
+    std::lock_guard<std::mutex> lock(_drainMutex);
+    TelemetryRecord record;
+    unsigned long numDrained = 0;
+
+    while(Pop(record)){
+        numDrained++;
+
+        _summary.numRecords++;
+        _summary.statusCounts[record.status]++;
+        _summary.covQualCounts[record.covQual]++;
+        _summary.rungCounts[record.rung]++;
+
+        if(record.clip > 0)
+            _summary.numClippedHigh++;
+        else if(record.clip < 0)
+            _summary.numClippedLow++;
+
+        // Cache hits and neighbor averages have no calls and land in the underflow
+        _summary.edm.Fill(record.edm);
+        _summary.numCalls.Fill(record.numCalls);
+        _summary.seconds.Fill(record.seconds);
+
+        if(_sink.is_open())
+            Write(record);
+    }
+
+    if(_sink.is_open())
+        _sink.flush();
+
+    return numDrained;
+}
+
+
+
+void WibTelemetry::Write(const TelemetryRecord& record){
+
+    // Traced as output of the written event, on the drain thread
+    WIBAS_TRACE_EVENT(record.event);
+    WIBAS_PROFILE_SCOPE(WibProfile::STAGE_OUTPUT);
+
+    if(_format == FORMAT_BINARY){
+        _sink.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        return;
+    }
+
+    _sink << record.event << ',' << record.source << ',' << record.status << ',' << record.covQual << ','
+          << record.rung << ',' << record.clip << ',' << record.numCalls << ',' << record.numNeighbors << ','
+          << record.q << ',' << record.weightError << ',' << record.edm << ',' << record.seconds << '\n';
+}
+
+
+
+void WibTelemetry::Start(unsigned int intervalMilliseconds){
+
+    if(_running.exchange(true))
+        return;
+
+    _drainThread = std::thread(&WibTelemetry::DrainLoop, this, intervalMilliseconds);
+}
+
+
+
+void WibTelemetry::Stop(){
+
+    if(!_running.exchange(false))
+        return;
+
+    _drainThread.join();
+    Drain();
+}
+
+
+
+void WibTelemetry::DrainLoop(unsigned int intervalMilliseconds){
+
+    while(_running.load()){
+        Drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMilliseconds));
+    }
+}
+
+
+
+TelemetrySummary WibTelemetry::GetSummary(){
+
+    Drain();
+
+    std::lock_guard<std::mutex> lock(_drainMutex);
+    TelemetrySummary summary = _summary;
+    summary.numDropped = _numDropped.load();
+
+    return summary;
+}
+
+
+
+void WibTelemetry::PrintSummary(std::ostream& out){
+
+    TelemetrySummary summary = GetSummary();
+
+    out << "INFO: fit telemetry of " << summary.numRecords << " events ("
+        << summary.numDropped << " records dropped)" << std::endl;
+
+    std::map<int, unsigned long>::const_iterator it;
+    out << "status:";
+    for(it=summary.statusCounts.begin(); it!=summary.statusCounts.end(); ++it)
+        out << "  " << it->first << ": " << it->second;
+    out << std::endl << "covQual:";
+    for(it=summary.covQualCounts.begin(); it!=summary.covQualCounts.end(); ++it)
+        out << "  " << it->first << ": " << it->second;
+    out << std::endl << "fallback rung:";
+    for(it=summary.rungCounts.begin(); it!=summary.rungCounts.end(); ++it)
+        out << "  " << it->first << ": " << it->second;
+    out << std::endl;
+
+    out << "Q > 1: " << summary.numClippedHigh << ", Q < 0: " << summary.numClippedLow << std::endl;
+
+    summary.edm.Print(out, "EDM");
+    summary.numCalls.Print(out, "function calls");
+    summary.seconds.Print(out, "seconds per event");
+}
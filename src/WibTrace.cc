@@ -0,0 +1,307 @@
+/**************************************************************
+ *                                                            *
+ *  WiBaS                                                     *
+ *                                                            *
+ *  Williams' Background Suppression                          *
+ *                                                            *
+ *  Author: Julian Pychy                                      *
+ *   email: julian@ep1.rub.de                                 *
+ *                                                            *
+ *  Copyright (C) 2016  Julian Pychy                          *
+ *                                                            *
+ *                                                            *
+ *  Description:                                              *
+ *                                                            *
+ *  License:                                                  *
+ *                                                            *
+ *  This file is part of WiBaS                                *
+ *                                                            *
+ *  WiBaS is free software: you can redistribute it and/or    *
+ *  modify it under the terms of the GNU General Public       *
+ *  License as published by the Free Software Foundation,     *
+ *  either version 3 of the License, or (at your option) any  *
+ *  later version.                                            *
+ *                                                            *
+ *  WiBaS is distributed in the hope that it will be useful,  *
+ *  but WITHOUT ANY WARRANTY; without even the implied        *
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR   *
+ *  PURPOSE. See the GNU General Public License for more      *
+ *  details.                                                  *
+ *                                                            *
+ *  You should have received a copy of the GNU General        *
+ *  Public License along with WiBaS (license.txt). If not,    *
+ *  see <http://www.gnu.org/licenses/>.                       *
+ *                                                            *
+ *************************************************************/
+
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+#include "WibTrace.hh"
+#include "WibProfile.hh"
+
+
+
+namespace {
+
+struct Span
+{
+    double start;       // us since the trace epoch
+    double duration;    // us
+    long event;
+    short stage;
+};
+
+
+class ThreadBuffer
+{
+    public:
+        ThreadBuffer(unsigned int id, unsigned int capacity) :
+            _id(id),
+            _spans(capacity),
+            _numWritten(0),
+            _finished(false)
+        {}
+
+        unsigned int _id;
+        std::mutex _mutex;
+        std::vector<Span> _spans;
+        unsigned long _numWritten;
+        bool _finished;
+};
+
+
+std::atomic<bool> recording(false);
+std::mutex registryMutex;
+std::vector<ThreadBuffer*> buffers;
+unsigned int nextThreadId = 1;
+unsigned int capacity = 65536;
+std::atomic<std::chrono::steady_clock::rep> epochTicks(std::chrono::steady_clock::now().time_since_epoch().count());
+
+
+// Marks the buffer of an exiting thread, Clear frees it
+class ThreadHandle
+{
+    public:
+        ThreadHandle() : _buffer(NULL), _event(-1) {}
+
+        ~ThreadHandle(){
+            if(_buffer == NULL)
+                return;
+
+            std::lock_guard<std::mutex> lock(registryMutex);
+            _buffer->_finished = true;
+        }
+
+        ThreadBuffer* GetBuffer(){
+            if(_buffer == NULL){
+                std::lock_guard<std::mutex> lock(registryMutex);
+                _buffer = new ThreadBuffer(nextThreadId++, capacity);
+                buffers.push_back(_buffer);
+            }
+            return _buffer;
+        }
+
+        ThreadBuffer* _buffer;
+        long _event;
+};
+
+
+thread_local ThreadHandle threadHandle;
+
+
+
+double Microseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to){
+
+    return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+}
+
+
+
+bool WibTrace::IsEnabled(){
+
+#ifdef WIBAS_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+void WibTrace::Start(unsigned int capacityPerThread){
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        capacity = (capacityPerThread > 0) ? capacityPerThread : 1;
+
+        for(size_t i=0; i<buffers.size(); i++){
+            std::lock_guard<std::mutex> bufferLock(buffers[i]->_mutex);
+            if(buffers[i]->_spans.size() != capacity){
+                buffers[i]->_spans.assign(capacity, Span());
+                buffers[i]->_numWritten = 0;
+            }
+        }
+    }
+
+    recording.store(true);
+}
+
+
+
+void WibTrace::Stop(){
+
+    recording.store(false);
+}
+
+
+
+bool WibTrace::IsRecording(){
+
+    return recording.load(std::memory_order_relaxed);
+}
+
+
+
+void WibTrace::Clear(){
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<ThreadBuffer*> live;
+
+    for(size_t i=0; i<buffers.size(); i++){
+        if(buffers[i]->_finished){
+            delete buffers[i];
+            continue;
+        }
+
+        std::lock_guard<std::mutex> bufferLock(buffers[i]->_mutex);
+        buffers[i]->_numWritten = 0;
+        live.push_back(buffers[i]);
+    }
+
+    buffers.swap(live);
+    epochTicks.store(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+
+
+void WibTrace::SetEvent(long event){
+
+    threadHandle._event = event;
+}
+
+
+
+void WibTrace::AddSpan(short stage, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end){
+
+    if(!recording.load(std::memory_order_relaxed))
+        return;
+
+    ThreadBuffer* buffer = threadHandle.GetBuffer();
+    Span span;
+    std::chrono::steady_clock::time_point epoch(std::chrono::steady_clock::duration(epochTicks.load(std::memory_order_relaxed)));
+    span.start = Microseconds(epoch, start);
+    span.duration = Microseconds(start, end);
+    span.event = threadHandle._event;
+    span.stage = stage;
+
+    // Only contended while the trace is written
+    std::lock_guard<std::mutex> lock(buffer->_mutex);
+    buffer->_spans[buffer->_numWritten % buffer->_spans.size()] = span;
+    buffer->_numWritten++;
+}
+
+
+
+unsigned long WibTrace::GetNumSpans(){
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    unsigned long numSpans = 0;
+
+    for(size_t i=0; i<buffers.size(); i++){
+        std::lock_guard<std::mutex> bufferLock(buffers[i]->_mutex);
+        numSpans += std::min<unsigned long>(buffers[i]->_numWritten, buffers[i]->_spans.size());
+    }
+
+    return numSpans;
+}
+
+
+
+unsigned long WibTrace::GetNumOverwritten(){
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    unsigned long numOverwritten = 0;
+
+    for(size_t i=0; i<buffers.size(); i++){
+        std::lock_guard<std::mutex> bufferLock(buffers[i]->_mutex);
+        if(buffers[i]->_numWritten > buffers[i]->_spans.size())
+            numOverwritten += buffers[i]->_numWritten - buffers[i]->_spans.size();
+    }
+
+    return numOverwritten;
+}
+
+
+
+bool WibTrace::WriteChromeTrace(const std::string& fileName){
+
+    std::ofstream out(fileName.c_str());
+
+    if(!out.is_open()){
+        std::cout << "ERROR: could not open trace file " << fileName << std::endl;
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"WiBaS\"}}";
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<Span> spans;
+
+    for(size_t i=0; i<buffers.size(); i++){
+        unsigned int tid = buffers[i]->_id;
+
+        // Copy the ring oldest first, so the thread can go on recording
+        {
+            std::lock_guard<std::mutex> bufferLock(buffers[i]->_mutex);
+            const std::vector<Span>& ring = buffers[i]->_spans;
+            unsigned long numWritten = buffers[i]->_numWritten;
+            unsigned long first = (numWritten > ring.size()) ? numWritten - ring.size() : 0;
+
+            spans.clear();
+            for(unsigned long s=first; s<numWritten; s++)
+                spans.push_back(ring[s % ring.size()]);
+        }
+
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+            << ", \"args\": {\"name\": \"thread " << tid << "\"}}";
+
+        for(size_t s=0; s<spans.size(); s++){
+            out << ",\n{\"name\": \"" << WibProfile::GetStageName(spans[s].stage)
+                << "\", \"cat\": \"wibas\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                << ", \"ts\": " << spans[s].start << ", \"dur\": " << spans[s].duration
+                << ", \"args\": {\"event\": " << spans[s].event << "}}";
+        }
+    }
+
+    out << "\n]}\n";
+    out.close();
+
+    if(out.fail()){
+        std::cout << "ERROR: could not write trace file " << fileName << std::endl;
+        return false;
+    }
+
+    return true;
+}
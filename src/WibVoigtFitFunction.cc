@@ -35,6 +35,7 @@
  *************************************************************/
 
 #include "WibVoigtFitFunction.hh"
+#include "WibCachedVoigtian.hh"
 #include "FitResult.hh"
 
 #include "RooRealVar.h"
@@ -46,6 +47,8 @@
 
 #include "TCanvas.h"
 
+#include <cmath>
+
 
 
 WibVoigtFitFunction::WibVoigtFitFunction(double particleMeanMass,
@@ -55,8 +58,11 @@ WibVoigtFitFunction::WibVoigtFitFunction(double particleMeanMass,
                                          unsigned int backgroundPolOrder,
                                          double voigtSigmaStart,
                                          double voigtSigmaMin,
-                                         double voigtSigmaMax) :
-    WibFitFunction(pminMass, pmaxMass)
+                                         double voigtSigmaMax,
+                                         bool exactVoigt) :
+    WibFitFunction(pminMass, pmaxMass),
+    backgroundPolOrder(backgroundPolOrder),
+    exactVoigt(exactVoigt)
 {
 
     mean = new RooRealVar("mean", "mean", particleMeanMass - pminMass);
@@ -69,7 +75,13 @@ WibVoigtFitFunction::WibVoigtFitFunction(double particleMeanMass,
     RooArgSet bkgArgSet = (backgroundPolOrder == 2) ?
                            RooArgSet(*a1,*a2) : ((backgroundPolOrder == 1) ? RooArgSet(*a1) : RooArgSet());
 
-    voigtFunction = new RooVoigtian("voigt", "signal", *mass, *mean, *gamma, *sigma);
+    // The exact RooVoigtian (numerical normalization, complex error function
+    // of ROOT) serves as a reference for the tabulated WibCachedVoigtian
+    if(exactVoigt)
+        voigtFunction = new RooVoigtian("voigt", "signal", *mass, *mean, *gamma, *sigma);
+    else
+        voigtFunction = new WibCachedVoigtian("voigt", "signal", *mass, *mean, *gamma, *sigma,
+                                              voigtSigmaMin, voigtSigmaMax);
     polFunction = new RooPolynomial("background","background", *mass, bkgArgSet);
 
     totalIntensity = new RooAddPdf("total","total", RooArgList(*voigtFunction, *polFunction), RooArgList(*sigshare));
@@ -93,8 +105,7 @@ WibVoigtFitFunction::~WibVoigtFitFunction(){
 
 FitResult* WibVoigtFitFunction::DoFitD(double eventMass, double eventMass2){
  
-    RooFitResult* rooFitResult = totalIntensity->fitTo(*data, RooFit::Save(true),  RooFit::Verbose(false),
-                                                       RooFit::PrintLevel(-1), RooFit::PrintEvalErrors(-1));
+    RooFitResult* rooFitResult = Minimize();
 
     FitResult* fitResult = new FitResult;
     fitResult->rooFitResult = rooFitResult;
@@ -120,6 +131,59 @@ double WibVoigtFitFunction::ReturnCurrentQValue(){
 
 
 
+bool WibVoigtFitFunction::GetQGradient(std::vector<double>& gradient){
+
+    // The analytic derivatives assume the normalization of WibCachedVoigtian,
+    // the exact profile falls back to finite differences
+    if(exactVoigt)
+        return false;
+
+    RooArgSet invMassArgSet(*mass);
+
+    double r = sigshare->getVal();
+    double s = voigtFunction->getVal(&invMassArgSet);
+    double b = polFunction->getVal(&invMassArgSet);
+
+    double x = mass->getVal();
+    double range = GetMaxMass() - GetMinMass();
+    double sig = sigma->getVal();
+
+    double raw, rawDSigma, rawDX;
+    if(!WibCachedVoigtian::GetDerivatives(x, mean->getVal(), gamma->getVal(), sig, raw, rawDSigma, rawDX) || raw <= 0)
+        return false;
+
+    // The profile obeys dV/dsigma = sigma * d2V/dx2, so the derivative of the
+    // normalization integral only needs dV/dx at the range limits.
+    double lowValue, lowDSigma, lowDX, highValue, highDSigma, highDX;
+    WibCachedVoigtian::GetDerivatives(0, mean->getVal(), gamma->getVal(), sig, lowValue, lowDSigma, lowDX);
+    WibCachedVoigtian::GetDerivatives(range, mean->getVal(), gamma->getVal(), sig, highValue, highDSigma, highDX);
+
+    double integral = raw / s;
+    double integralDSigma = sig * (highDX - lowDX);
+
+    std::vector<double> signalGradient(4, 0.);
+    std::vector<double> backgroundGradient(4, 0.);
+
+    signalGradient[0] = (rawDSigma - s * integralDSigma) / integral;
+
+    std::vector<double> coefs;
+    if(backgroundPolOrder == 1 || backgroundPolOrder == 2)
+        coefs.push_back(a1->getVal());
+    if(backgroundPolOrder == 2)
+        coefs.push_back(a2->getVal());
+
+    std::vector<double> polGradient;
+    GetPolynomialGradient(x, range, coefs, polGradient);
+    for(size_t k=0; k<polGradient.size(); k++)
+        backgroundGradient[1 + k] = polGradient[k];
+
+    CombineQGradient(r, s, b, signalGradient, backgroundGradient, 3, gradient);
+
+    return true;
+}
+
+
+
 void WibVoigtFitFunction::SaveFitToFile(std::string fileName){
 
     double sumOfWeights = data->sumEntries();
@@ -148,3 +212,10 @@ RooArgList WibVoigtFitFunction::GetParamList() const {
 
     return RooArgList(*sigma, *a1, *a2, *sigshare);
 }
+
+
+
+RooArgList WibVoigtFitFunction::GetBackgroundParamList() const {
+
+    return RooArgList(*a1, *a2);
+}
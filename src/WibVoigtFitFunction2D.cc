@@ -35,12 +35,12 @@
  *************************************************************/
 
 #include "WibVoigtFitFunction2D.hh"
+#include "WibCachedVoigtian.hh"
 #include "FitResult.hh"
 
 #include "RooRealVar.h"
 #include "RooDataSet.h"
 #include "RooPolynomial.h"
-#include "RooVoigtian.h"
 #include "RooPlot.h"
 #include "RooAddPdf.h"
 #include "RooProdPdf.h"
@@ -48,6 +48,8 @@
 #include "TCanvas.h"
 #include "TH2F.h"
 
+#include <cmath>
+
 
 
 WibVoigtFitFunction2D::WibVoigtFitFunction2D(double particleMeanMass,
@@ -58,7 +60,8 @@ WibVoigtFitFunction2D::WibVoigtFitFunction2D(double particleMeanMass,
                                              double voigtSigmaStart,
                                              double voigtSigmaMin,
                                              double voigtSigmaMax) :
-    WibFitFunction(pminMass, pmaxMass)
+    WibFitFunction(pminMass, pmaxMass),
+    backgroundPolOrder(backgroundPolOrder)
 {
 
     mean = new RooRealVar("mean", "mean", particleMeanMass - pminMass);
@@ -71,8 +74,10 @@ WibVoigtFitFunction2D::WibVoigtFitFunction2D(double particleMeanMass,
     RooArgSet bkgArgSet = (backgroundPolOrder == 2) ?
                            RooArgSet(*a1,*a2) : ((backgroundPolOrder == 1) ? RooArgSet(*a1) : RooArgSet());
 
-    voigtFunction1 = new RooVoigtian("voigt1", "signal1", *mass, *mean, *gamma, *sigma);
-    voigtFunction2 = new RooVoigtian("voigt2", "signal2", *mass2, *mean, *gamma, *sigma);
+    voigtFunction1 = new WibCachedVoigtian("voigt1", "signal1", *mass, *mean, *gamma, *sigma,
+                                           voigtSigmaMin, voigtSigmaMax);
+    voigtFunction2 = new WibCachedVoigtian("voigt2", "signal2", *mass2, *mean, *gamma, *sigma,
+                                           voigtSigmaMin, voigtSigmaMax);
     polFunction1 = new RooPolynomial("background1","background1", *mass, bkgArgSet);
     polFunction2 = new RooPolynomial("background2","background2", *mass2, bkgArgSet);
     voigtFunctionProd = new RooProdPdf("voigt", "signal", *voigtFunction1, *voigtFunction2);
@@ -103,8 +108,7 @@ WibVoigtFitFunction2D::~WibVoigtFitFunction2D(){
 
 FitResult* WibVoigtFitFunction2D::DoFitD(double eventMass, double eventMass2){
  
-    RooFitResult* rooFitResult = totalIntensity->fitTo(*data, RooFit::Save(true),  RooFit::Verbose(false),
-                                                       RooFit::PrintLevel(-1), RooFit::PrintEvalErrors(-1));
+    RooFitResult* rooFitResult = Minimize();
 
     FitResult* fitResult = new FitResult;
     fitResult->rooFitResult = rooFitResult;
@@ -130,6 +134,77 @@ double WibVoigtFitFunction2D::ReturnCurrentQValue(){
 
 
 
+bool WibVoigtFitFunction2D::GetQGradient(std::vector<double>& gradient){
+
+    RooArgSet invMassArgSet(*mass);
+
+    double r = sigshare->getVal();
+    double s = voigtFunctionProd->getVal(&invMassArgSet);
+    double b = polFunctionProd->getVal(&invMassArgSet);
+
+    double x = mass->getVal();
+    double x2 = mass2->getVal();
+    double range = GetMaxMass() - GetMinMass();
+    double sig = sigma->getVal();
+
+    double raw, rawDSigma, rawDX;
+    double raw2, raw2DSigma, raw2DX;
+    if(!WibCachedVoigtian::GetDerivatives(x, mean->getVal(), gamma->getVal(), sig, raw, rawDSigma, rawDX) ||
+       !WibCachedVoigtian::GetDerivatives(x2, mean->getVal(), gamma->getVal(), sig, raw2, raw2DSigma, raw2DX) ||
+       raw <= 0 || raw2 <= 0)
+        return false;
+
+    // ReturnCurrentQValue normalizes the products over mass only, the mass2
+    // factors enter unnormalized. Fall back to finite differences if the
+    // products do not factorize like that.
+    std::vector<double> coefs;
+    if(backgroundPolOrder == 1 || backgroundPolOrder == 2)
+        coefs.push_back(a1->getVal());
+    if(backgroundPolOrder == 2)
+        coefs.push_back(a2->getVal());
+
+    double b2 = 1;
+    double x2pow = 1;
+    for(size_t k=0; k<coefs.size(); k++){
+        x2pow *= x2;
+        b2 += coefs[k] * x2pow;
+    }
+
+    double s1 = voigtFunction1->getVal(&invMassArgSet);
+    double b1 = polFunction1->getVal(&invMassArgSet);
+
+    if(fabs(s - s1 * raw2) > 1E-6 * s || fabs(b - b1 * b2) > 1E-6 * b)
+        return false;
+
+    double lowValue, lowDSigma, lowDX, highValue, highDSigma, highDX;
+    WibCachedVoigtian::GetDerivatives(0, mean->getVal(), gamma->getVal(), sig, lowValue, lowDSigma, lowDX);
+    WibCachedVoigtian::GetDerivatives(range, mean->getVal(), gamma->getVal(), sig, highValue, highDSigma, highDX);
+
+    double integral = raw / s1;
+    double integralDSigma = sig * (highDX - lowDX);
+    double s1DSigma = (rawDSigma - s1 * integralDSigma) / integral;
+
+    std::vector<double> signalGradient(4, 0.);
+    std::vector<double> backgroundGradient(4, 0.);
+
+    signalGradient[0] = s1DSigma * raw2 + s1 * raw2DSigma;
+
+    std::vector<double> polGradient;
+    GetPolynomialGradient(x, range, coefs, polGradient);
+
+    x2pow = 1;
+    for(size_t k=0; k<polGradient.size(); k++){
+        x2pow *= x2;
+        backgroundGradient[1 + k] = polGradient[k] * b2 + b1 * x2pow;
+    }
+
+    CombineQGradient(r, s, b, signalGradient, backgroundGradient, 3, gradient);
+
+    return true;
+}
+
+
+
 void WibVoigtFitFunction2D::SaveFitToFile(std::string fileName){
 
     using namespace RooFit;
@@ -167,3 +242,10 @@ RooArgList WibVoigtFitFunction2D::GetParamList() const {
 
     return RooArgList(*sigma, *a1, *a2, *sigshare);
 }
+
+
+
+RooArgList WibVoigtFitFunction2D::GetBackgroundParamList() const {
+
+    return RooArgList(*a1, *a2);
+}
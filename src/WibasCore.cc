@@ -38,21 +38,52 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <limits>
 
 #include "WibasCore.hh"
 #include "FitResult.hh"
 #include "PhasespacePoint.hh"
 #include "WibFitFunction.hh"
 #include "FastPointMap.hh"
+#include "WibProfile.hh"
+#include "WibTelemetry.hh"
+#include "WibProgress.hh"
 
 #include "RooMsgService.h"
 
 
 
+const short int WiBaS::FIT_NOMINAL = 0;
+const short int WiBaS::FIT_START_VALUES = 1;
+const short int WiBaS::FIT_FIXED_BACKGROUND = 2;
+const short int WiBaS::FIT_MORE_NEIGHBORS = 3;
+const short int WiBaS::FIT_NEIGHBOR_AVERAGE = 4;
+const short int WiBaS::FIT_FAILED = 5;
+const size_t WiBaS::CACHED_FIT_BYTES = 16384;
+
+
+
 WiBaS::WiBaS(WibFitFunction& pfitFunction) :
     PhasespacePointCloud(1),
     numNearestNeighbors(200),
-    fitFunction(&pfitFunction)
+    fitFunction(&pfitFunction),
+    useFitCache(false),
+    cacheJaccardThreshold(1.),
+    cacheMaxEntries(10000),
+    numFits(0),
+    numCacheHits(0),
+    numExactCacheHits(0),
+    fitSeconds(0),
+    useFitFallback(false),
+    numFallbackStarts(2),
+    fallbackNeighborFactor(2.),
+    lastFitRung(FIT_NOMINAL),
+    fitRungCounts(FIT_FAILED + 1, 0),
+    telemetry(NULL),
+    telemetrySource(0),
+    numWeightCalls(0),
+    reproducible(false)
 {
     RooMsgService::instance().setSilentMode(true);
     RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
@@ -60,6 +91,13 @@ WiBaS::WiBaS(WibFitFunction& pfitFunction) :
 
 
 
+WiBaS::~WiBaS(){
+
+    ClearFitCache();
+}
+
+
+
 void WiBaS::SetNearestNeighbors(unsigned int pnumNearestNeighbors){
 
     numNearestNeighbors = pnumNearestNeighbors;
@@ -84,6 +122,13 @@ void WiBaS::AddPhasespacePoint(PhasespacePoint& newPhasespacePoint){
 
 bool WiBaS::CalcWeight(PhasespacePoint &refPhasespacePoint){
 
+    WIBAS_PROFILE_SCOPE(WibProfile::STAGE_CALCWEIGHT);
+    WIBAS_PROFILE_COUNT(WibProfile::COUNT_EVENTS, 1);
+
+    std::chrono::steady_clock::time_point eventStart = std::chrono::steady_clock::now();
+    numWeightCalls++;
+    WIBAS_TRACE_EVENT(numWeightCalls);
+
     ArrangePointCoordinates(refPhasespacePoint);
 
     if(!CheckMassInRange(refPhasespacePoint)){
@@ -94,94 +139,350 @@ bool WiBaS::CalcWeight(PhasespacePoint &refPhasespacePoint){
     }
 
 
-    // calculate phasespace distances
     std::vector<FastPointMap> pointMapVector;
-    std::vector<PhasespacePoint*>::iterator it;
-    std::vector<PhasespacePoint*> phasespacePointVector = GetPointVector();
+    SortByDistance(refPhasespacePoint, pointMapVector);
+
 
+    // Cut vector
+    unsigned int cutIndex = GetCutIndex(pointMapVector, numNearestNeighbors);
 
-    for (it=phasespacePointVector.begin(); it!=phasespacePointVector.end(); ++it){
-        FastPointMap newMapEntry((*it), CalcPhasespaceDistance((*it), &refPhasespacePoint));
-        pointMapVector.push_back(newMapEntry);
+    if(cutIndex == 0){
+        *_qout << "ERROR: Too few events available for numNearestNeighbors = " << numNearestNeighbors << std::endl;
+        return false;
     }
 
+    WIBAS_PROFILE_COUNT(WibProfile::COUNT_NEIGHBORS, cutIndex);
 
-    // sort list
-    FastPointMap compHelper(NULL, 0);
-    std::sort(pointMapVector.begin(), pointMapVector.end(), compHelper);
 
+    // Do the fit, with the fallbacks on the same sorted neighbor list. In
+    // the reproducible mode the fit does not start from the result of the
+    // previous event of this object.
+    lastFitRung = FIT_NOMINAL;
+    if(reproducible)
+        fitFunction->SetAlternativeStart(0);
 
-    // Cut vector
-    int cutIndex=-1;
-    double weightsum=0;
+    FitResult* fitResult = FitNeighborhood(pointMapVector, cutIndex, refPhasespacePoint, useFitCache);
 
-    for(unsigned int i=1; i<pointMapVector.size();i++){
+    if(!IsConverged(fitResult) && useFitFallback){
+        delete fitResult;
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_FALLBACK);
+        WIBAS_PROFILE_COUNT(WibProfile::COUNT_FALLBACKS, 1);
+        fitResult = RetryFit(pointMapVector, cutIndex, refPhasespacePoint);
+    }
 
-        weightsum += pointMapVector.at(i)._phasespacePoint->GetInitialWeight();
 
-        if(weightsum >= numNearestNeighbors){
-            cutIndex = i;
-            break;
+    // Check fit result. With telemetry the fit problems of single events
+    // are only recorded there instead of being printed.
+    if(!IsConverged(fitResult)){
+        if(telemetry == NULL)
+            *_qout << "ERROR: Fit did not converge or returned NULL pointer" << std::endl;
+        lastFitRung = FIT_FAILED;
+        fitRungCounts.at(lastFitRung)++;
+        WIBAS_PROFILE_COUNT(WibProfile::COUNT_FAILED, 1);
+        PushTelemetry(fitResult, std::numeric_limits<double>::quiet_NaN(), 0, cutIndex, eventStart);
+        delete fitResult;
+        return false;
+    }
+
+    fitRungCounts.at(lastFitRung)++;
+
+    // The covariance is only used (and computed by HESSE) for event errors
+    if(fitFunction->GetCalcError() && lastFitRung != FIT_NEIGHBOR_AVERAGE && telemetry == NULL){
+        int covQual = fitResult->covQual;
+
+        if(covQual == 2){
+            *_qout << "INFO: covariance matrix forced positive-definite" << std::endl;
+        }
+        else if(covQual == 1){
+            *_qout << "WARNING: covariance matrix not accurate" << std::endl;
+        }
+        else if(covQual != 3){
+            *_qout << "WARNING: covQual = " << covQual << std::endl;
         }
     }
 
-    if(cutIndex <= 0){
-        *_qout << "ERROR: Too few events available for numNearestNeighbors = " << numNearestNeighbors << std::endl;
-        return false;
+
+    //Get weight at m0
+    double Q = fitResult->weight;
+    short int clip = (Q > 1) ? 1 : ((Q < 0) ? -1 : 0);
+
+    if(clip != 0)
+        WIBAS_PROFILE_COUNT(WibProfile::COUNT_Q_CLIPPED, 1);
+
+    PushTelemetry(fitResult, Q, clip, cutIndex, eventStart);
+
+    if(Q > 1) {
+        if(telemetry == NULL)
+            *_qout << "WARNING: Q > 1. Setting Q = 1." << std::endl;
+        Q = 1.0;
+    }
+    else if(Q < 0){
+        if(telemetry == NULL)
+            *_qout << "WARNING: Q < 0. Setting Q = 0." << std::endl;
+        Q = 0.0;
+    }
+
+    refPhasespacePoint.SetWeight(Q);
+    refPhasespacePoint.SetWeightError(fitResult->weightError);
+
+    // Remember Q of events that are part of the cloud for neighbor averages,
+    // under the index of the event itself rather than of the first point at
+    // its place. The cloud may have grown since the last weighted event.
+    long ownIndex = refPhasespacePoint.GetCloudIndex();
+    std::vector<PhasespacePoint*>& phasespacePointVector = GetPointVector();
+
+    if(useFitFallback && ownIndex >= 0 && static_cast<size_t>(ownIndex) < phasespacePointVector.size() &&
+       phasespacePointVector[ownIndex]->GetMass() == refPhasespacePoint.GetMass() &&
+       CalcPhasespaceDistance(phasespacePointVector[ownIndex], &refPhasespacePoint) == 0){
+
+        if(knownQ.size() < phasespacePointVector.size())
+            knownQ.resize(phasespacePointVector.size(), std::numeric_limits<double>::quiet_NaN());
+        knownQ.at(ownIndex) = Q;
+    }
+
+    delete fitResult;
+    return true;
+}
+
+
+
+unsigned long WiBaS::CalcWeights(std::vector<PhasespacePoint>& points, WibProgress* progress, unsigned int worker){
+
+    // Weights all points, returns the number of successful ones. Several
+    // WiBaS instances with their own fit functions may run in parallel
+    // threads, each reporting as another worker of the same progress.
+    unsigned long numSuccessful = 0;
+
+    for(size_t i=0; i<points.size(); i++){
+        std::chrono::steady_clock::time_point eventStart = std::chrono::steady_clock::now();
+        bool success = CalcWeight(points[i]);
+
+        if(success)
+            numSuccessful++;
+
+        if(progress != NULL)
+            progress->AddEvent(worker, success,
+                               std::chrono::duration<double>(std::chrono::steady_clock::now() - eventStart).count());
     }
 
-   pointMapVector.resize(cutIndex + 1);
+    return numSuccessful;
+}
+
+
+
+FitResult* WiBaS::FitNeighborhood(const std::vector<FastPointMap>& pointMapVector, unsigned int cutIndex,
+                                  PhasespacePoint& refPhasespacePoint, bool useCache){
+
+    // Look for an earlier fit of the same neighborhood
+    std::vector<unsigned int> neighbors;
+    const RooFitResult* cachedFit = NULL;
+    bool exactHit = false;
+
+    if(useCache){
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_CACHE);
 
+        for(unsigned int i=1; i<=cutIndex; i++)
+            neighbors.push_back(pointMapVector.at(i)._index);
+
+        std::sort(neighbors.begin(), neighbors.end());
+        cachedFit = FindCachedFit(neighbors, exactHit);
+    }
+
+    if(cachedFit != NULL){
+        numCacheHits++;
+        WIBAS_PROFILE_COUNT(WibProfile::COUNT_CACHE_HITS, 1);
+        if(exactHit)
+            numExactCacheHits++;
+
+        return fitFunction->EvaluateFit(*cachedFit, refPhasespacePoint.GetMass(), refPhasespacePoint.GetMass2());
+    }
 
     // Fill the fit function with the neighbor data
-    std::vector<FastPointMap>::iterator it2;
-    for(it2=pointMapVector.begin() + 1; it2!=pointMapVector.end(); ++it2) // skip nearest event (=ref event?, TODO: check this!)
     {
-        fitFunction->AddData(*((*it2)._phasespacePoint));
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_ADD_DATA);
+
+        for(unsigned int i=1; i<=cutIndex; i++) // skip nearest event (=ref event?, TODO: check this!)
+        {
+            fitFunction->AddData(*(pointMapVector.at(i)._phasespacePoint));
+        }
     }
 
 
     // Do the fit
+    std::chrono::steady_clock::time_point fitStart = std::chrono::steady_clock::now();
     FitResult* fitResult = fitFunction->DoFit(refPhasespacePoint.GetMass(),  refPhasespacePoint.GetMass2());
+    fitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - fitStart).count();
+    numFits++;
+    WIBAS_PROFILE_COUNT(WibProfile::COUNT_FITS, 1);
 
+    if(useCache && (fitResult != NULL) && (fitResult->rooFitResult != NULL) && (fitResult->status == 0)){
+        StoreFit(neighbors, *fitResult->rooFitResult);
+    }
 
-    // Check fit result
-    if((fitResult == NULL) || (fitResult->rooFitResult == NULL) || (fitResult->rooFitResult->status() != 0)){
-        *_qout << "ERROR: Fit did not converge or returned NULL pointer" << std::endl;
+    return fitResult;
+}
+
+
+
+FitResult* WiBaS::RetryFit(const std::vector<FastPointMap>& pointMapVector, unsigned int cutIndex,
+                           PhasespacePoint& refPhasespacePoint){
+
+    // Fallback fits are not stored in the fit cache, their start values
+    // differ from the ones of the nominal fit
+    FitResult* fitResult = NULL;
+
+    for(unsigned int attempt=1; attempt<=numFallbackStarts; attempt++){
+        fitFunction->SetAlternativeStart(attempt);
+        fitResult = FitNeighborhood(pointMapVector, cutIndex, refPhasespacePoint, false);
+        fitFunction->SetAlternativeStart(0);
+
+        if(IsConverged(fitResult)){
+            lastFitRung = FIT_START_VALUES;
+            return fitResult;
+        }
         delete fitResult;
-        return false;
     }
 
-    int covQual = fitResult->rooFitResult->covQual();
+    fitFunction->SetBackgroundFixed(true);
+    fitResult = FitNeighborhood(pointMapVector, cutIndex, refPhasespacePoint, false);
+    fitFunction->SetBackgroundFixed(false);
 
-    if(covQual == 2){
-        *_qout << "INFO: covariance matrix forced positive-definite" << std::endl;
+    if(IsConverged(fitResult)){
+        lastFitRung = FIT_FIXED_BACKGROUND;
+        return fitResult;
     }
-    else if(covQual == 1){
-        *_qout << "WARNING: covariance matrix not accurate" << std::endl;
+    delete fitResult;
+
+    // More neighbors from the same sorted list, or all of them if there are too few
+    unsigned int largerCutIndex = GetCutIndex(pointMapVector, numNearestNeighbors * fallbackNeighborFactor);
+    if(largerCutIndex == 0)
+        largerCutIndex = pointMapVector.size() - 1;
+
+    if(largerCutIndex > cutIndex){
+        fitResult = FitNeighborhood(pointMapVector, largerCutIndex, refPhasespacePoint, false);
+
+        if(IsConverged(fitResult)){
+            lastFitRung = FIT_MORE_NEIGHBORS;
+            return fitResult;
+        }
+        delete fitResult;
     }
-    else if(covQual != 3){
-        *_qout << "WARNING: covQual = " << covQual << std::endl;
+
+    // Average Q of the neighbors that were weighted before, the error is their
+    // spread. Which neighbors these are depends on the order of the events.
+    if(reproducible)
+        return NULL;
+
+    double sumOfWeights = 0;
+    double sum = 0;
+    double sumsq = 0;
+
+    for(unsigned int i=1; i<=cutIndex; i++){
+        size_t index = pointMapVector.at(i)._index;
+        if(index >= knownQ.size() || std::isnan(knownQ[index]))
+            continue;
+
+        double q = knownQ[index];
+
+        double weight = pointMapVector.at(i)._phasespacePoint->GetInitialWeight();
+        sumOfWeights += weight;
+        sum += weight * q;
+        sumsq += weight * q * q;
     }
 
+    if(sumOfWeights <= 0)
+        return NULL;
 
-    //Get weight at m0
-    double Q = fitResult->weight;
+    fitResult = new FitResult;
+    fitResult->weight = sum / sumOfWeights;
+    fitResult->weightError = sqrt(std::max(sumsq / sumOfWeights - fitResult->weight * fitResult->weight, 0.));
+    fitResult->status = 0;
+    lastFitRung = FIT_NEIGHBOR_AVERAGE;
 
-    if(Q > 1) {
-        *_qout << "WARNING: Q > 1. Setting Q = 1." << std::endl;
-        Q = 1.0;
+    return fitResult;
+}
+
+
+
+void WiBaS::SortByDistance(PhasespacePoint& refPhasespacePoint, std::vector<FastPointMap>& pointMapVector){
+
+    // calculate phasespace distances
+    std::vector<PhasespacePoint*>::iterator it;
+    std::vector<PhasespacePoint*>& phasespacePointVector = GetPointVector();
+
+    pointMapVector.clear();
+    pointMapVector.reserve(phasespacePointVector.size());
+
+    {
+        WIBAS_PROFILE_SCOPE(WibProfile::STAGE_DISTANCES);
+
+        for (it=phasespacePointVector.begin(); it!=phasespacePointVector.end(); ++it){
+            FastPointMap newMapEntry((*it), CalcPhasespaceDistance((*it), &refPhasespacePoint),
+                                     it - phasespacePointVector.begin());
+            pointMapVector.push_back(newMapEntry);
+        }
     }
-    else if(Q < 0){
-        *_qout << "WARNING: Q < 0. Setting Q = 0." << std::endl;
-        Q = 0.0;
+
+
+    // sort list
+    WIBAS_PROFILE_SCOPE(WibProfile::STAGE_SORT);
+    FastPointMap compHelper(NULL, 0);
+
+    if(reproducible)
+        std::sort(pointMapVector.begin(), pointMapVector.end(), FastPointMap::CompareStable);
+    else
+        std::sort(pointMapVector.begin(), pointMapVector.end(), compHelper);
+}
+
+
+
+unsigned int WiBaS::GetCutIndex(const std::vector<FastPointMap>& pointMapVector, double numNeighbors){
+
+    // Index of the last neighbor if the weights of the neighbors, without
+    // the nearest event, add up to numNeighbors, 0 if there are too few
+    double weightsum = 0;
+
+    for(unsigned int i=1; i<pointMapVector.size(); i++){
+
+        weightsum += pointMapVector.at(i)._phasespacePoint->GetInitialWeight();
+
+        if(weightsum >= numNeighbors)
+            return i;
     }
 
-    refPhasespacePoint.SetWeight(Q);
-    refPhasespacePoint.SetWeightError(fitResult->weightError);
+    return 0;
+}
 
-    delete fitResult;
-    return true;
+
+
+bool WiBaS::IsConverged(const FitResult* fitResult){
+
+    return (fitResult != NULL) && (fitResult->status == 0);
+}
+
+
+
+void WiBaS::PushTelemetry(const FitResult* fitResult, double q, short int clip, unsigned int numNeighbors,
+                          std::chrono::steady_clock::time_point start){
+
+    if(telemetry == NULL)
+        return;
+
+    TelemetryRecord record;
+    record.event = numWeightCalls;
+    record.source = telemetrySource;
+    record.status = (fitResult != NULL) ? fitResult->status : -1;
+    record.covQual = (fitResult != NULL) ? fitResult->covQual : -1;
+    record.rung = lastFitRung;
+    record.clip = clip;
+    record.numCalls = (fitResult != NULL) ? fitResult->numCalls : 0;
+    record.numNeighbors = numNeighbors;
+    record.q = q;
+    record.weightError = (fitResult != NULL) ? fitResult->weightError : 0;
+    record.edm = (fitResult != NULL) ? fitResult->edm : 0;
+    record.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    telemetry->Push(record);
 }
 
 
@@ -218,3 +519,292 @@ void WiBaS::SetCalcErrors(bool set){
 }
 
 
+
+void WiBaS::SetBinnedFit(unsigned int numBins){
+
+    fitFunction->SetBinnedFit(numBins);
+}
+
+
+
+void WiBaS::SetFitStrategy(const FitStrategy& fitStrategy){
+
+    fitFunction->SetFitStrategy(fitStrategy);
+}
+
+
+
+void WiBaS::SetFitCache(bool enable, double jaccardThreshold, unsigned int maxEntries){
+
+    // Neighborhoods with a Jaccard index of at least jaccardThreshold share
+    // one fit, 1 only reuses identical neighbor sets. The nearest point is
+    // not a neighbor, so identical sets only occur for events that are not
+    // in the cloud; events of the cloud itself need a threshold below 1.
+    useFitCache = enable;
+    cacheJaccardThreshold = jaccardThreshold;
+    cacheMaxEntries = maxEntries;
+    numFits = 0;
+    numCacheHits = 0;
+    numExactCacheHits = 0;
+    fitSeconds = 0;
+    ClearFitCache();
+}
+
+
+
+void WiBaS::SetFitFallback(bool enable, unsigned int numStartAttempts, double neighborFactor){
+
+    // Failed fits are repeated with other start values, a flat background
+    // and neighborFactor times more neighbors, before Q is averaged over
+    // the neighbors that were weighted before
+    useFitFallback = enable;
+    numFallbackStarts = numStartAttempts;
+    fallbackNeighborFactor = neighborFactor;
+    std::fill(fitRungCounts.begin(), fitRungCounts.end(), 0);
+    knownQ.clear();
+}
+
+
+
+MemoryUsage WiBaS::GetMemoryUsage() const {
+
+    // The sorted distance list is rebuilt for every event, it is counted
+    // with its reserved size as peak of CalcWeight
+    MemoryUsage usage = PhasespacePointCloud::GetMemoryUsage();
+    usage.neighborIndex = MemoryUsage::GetVectorBytes(GetNumPoints(), sizeof(FastPointMap)) +
+                          MemoryUsage::GetVectorBytes(useFitCache ? numNearestNeighbors : 0, sizeof(unsigned int));
+    usage.fitWorkspace = fitFunction->GetMemoryUsage() +
+                         MemoryUsage::GetVectorBytes(knownQ.capacity(), sizeof(double));
+
+    std::map<unsigned long long, FitCacheEntry>::const_iterator it;
+    for(it=fitCache.begin(); it!=fitCache.end(); ++it)
+        usage.fitWorkspace += MemoryUsage::GetVectorBytes(it->second.neighbors.capacity(), sizeof(unsigned int)) +
+                              MemoryUsage::GetAllocationSize(4 * sizeof(void*) + sizeof(*it)) + CACHED_FIT_BYTES;
+
+    return usage;
+}
+
+
+
+MemoryUsage WiBaS::EstimateMemoryUsage(unsigned long numPoints, unsigned int numCoords, unsigned int numNeighbors,
+                                       unsigned int numWorkers, unsigned int cacheEntries, unsigned int meanNameLength){
+
+    // Every worker runs its own WiBaS object with a copy of all points,
+    // the fits are unbinned and the fallback is off
+    MemoryUsage usage = PhasespacePointCloud::EstimateMemoryUsage(numPoints, numCoords, meanNameLength);
+    usage.neighborIndex = MemoryUsage::GetVectorBytes(numPoints, sizeof(FastPointMap)) +
+                          MemoryUsage::GetVectorBytes((cacheEntries > 0) ? numNeighbors : 0, sizeof(unsigned int));
+    usage.fitWorkspace = WibFitFunction::EstimateMemoryUsage(numNeighbors) +
+                         cacheEntries * (MemoryUsage::GetVectorBytes(numNeighbors, sizeof(unsigned int)) +
+                                         MemoryUsage::GetAllocationSize(4 * sizeof(void*) +
+                                                                        sizeof(std::pair<const unsigned long long, FitCacheEntry>)) +
+                                         CACHED_FIT_BYTES);
+
+    return usage * numWorkers;
+}
+
+
+
+unsigned int WiBaS::GetMaxWorkers(size_t memoryBudget, unsigned long numPoints, unsigned int numCoords,
+                                  unsigned int numNeighbors, unsigned int cacheEntries, unsigned int meanNameLength){
+
+    size_t workerBytes = EstimateMemoryUsage(numPoints, numCoords, numNeighbors, 1, cacheEntries, meanNameLength).GetTotal();
+    return (workerBytes > 0) ? memoryBudget / workerBytes : 0;
+}
+
+
+
+void WiBaS::SetTelemetry(WibTelemetry* ptelemetry, unsigned int source){
+
+    // Not owned, NULL switches the telemetry off. The source number tells
+    // the records of several WiBaS instances (e.g. one per thread) apart.
+    telemetry = ptelemetry;
+    telemetrySource = source;
+}
+
+
+
+void WiBaS::SetReproducible(bool set){
+
+    // Makes the weight of an event a function of the event and the point
+    // cloud only, independent of the order and the split of the events over
+    // WiBaS objects and threads: equal distances are ordered by the point
+    // index, every nominal fit starts from the constructor start values and
+    // step sizes instead of the errors of the previous fit (the minimizer
+    // of WibModelFitFunction is rebuilt), the fit cache only takes exact hits
+    // and the fallback ladder has no neighbor average rung. Costs: the sort
+    // takes about 10-15% longer (up to twice as long with many equal
+    // distances), the fits need more calls without the warm start and
+    // similar-neighborhood cache hits are lost; validateApp measures the
+    // total against the fast mode.
+    reproducible = set;
+}
+
+
+
+short int WiBaS::GetLastFitRung() const {
+
+    return lastFitRung;
+}
+
+
+
+unsigned long WiBaS::GetNumFitRung(short int rung) const {
+
+    // Events weighted at the given rung since the last SetFitFallback
+    return fitRungCounts.at(rung);
+}
+
+
+
+void WiBaS::PrintFitFallbackStats() const {
+
+    const char* names[] = {"nominal fit", "other start values", "flat background",
+                           "more neighbors", "neighbor average", "failed"};
+
+    *_qout << "INFO: fit fallbacks:";
+    for(short int i=FIT_NOMINAL; i<=FIT_FAILED; i++)
+        *_qout << " " << names[i] << " " << fitRungCounts.at(i) << (i < FIT_FAILED ? "," : "");
+    *_qout << std::endl;
+}
+
+
+
+unsigned long WiBaS::GetNumFits() const {
+
+    return numFits;
+}
+
+
+
+unsigned long WiBaS::GetNumCacheHits() const {
+
+    return numCacheHits;
+}
+
+
+
+void WiBaS::PrintFitCacheStats() const {
+
+    unsigned long numEvents = numFits + numCacheHits;
+    double secondsPerFit = (numFits > 0) ? fitSeconds / numFits : 0;
+
+    *_qout << "INFO: fit cache: " << numCacheHits << " of " << numEvents << " events reused a fit ("
+           << numExactCacheHits << " identical neighborhoods, hit rate "
+           << ((numEvents > 0) ? 100. * numCacheHits / numEvents : 0.) << "%), "
+           << numFits << " fits in " << fitSeconds << " s, about "
+           << numCacheHits * secondsPerFit << " s saved" << std::endl;
+}
+
+
+
+const RooFitResult* WiBaS::FindCachedFit(const std::vector<unsigned int>& neighbors, bool& exact) const {
+
+    std::map<unsigned long long, FitCacheEntry>::const_iterator it = fitCache.find(HashNeighbors(neighbors));
+
+    if(it != fitCache.end() && it->second.neighbors == neighbors){
+        exact = true;
+        return it->second.rooFitResult;
+    }
+
+    // Similar neighborhoods depend on the events fitted before
+    exact = false;
+    if(cacheJaccardThreshold >= 1. || reproducible)
+        return NULL;
+
+    // Most similar stored neighborhood above the threshold
+    const RooFitResult* best = NULL;
+    double bestJaccard = cacheJaccardThreshold;
+
+    for(it=fitCache.begin(); it!=fitCache.end(); ++it){
+        double jaccard = GetJaccardIndex(neighbors, it->second.neighbors);
+        if(jaccard >= bestJaccard){
+            bestJaccard = jaccard;
+            best = it->second.rooFitResult;
+        }
+    }
+
+    return best;
+}
+
+
+
+void WiBaS::StoreFit(const std::vector<unsigned int>& neighbors, const RooFitResult& rooFitResult){
+
+    unsigned long long key = HashNeighbors(neighbors);
+    std::map<unsigned long long, FitCacheEntry>::iterator it = fitCache.find(key);
+
+    if(it != fitCache.end()){
+        delete it->second.rooFitResult;
+        it->second.neighbors = neighbors;
+        it->second.rooFitResult = new RooFitResult(rooFitResult);
+        return;
+    }
+
+    // Drop the oldest entry if the cache is full
+    if(cacheMaxEntries > 0 && fitCache.size() >= cacheMaxEntries){
+        std::map<unsigned long long, FitCacheEntry>::iterator oldest = fitCache.find(fitCacheOrder.front());
+        delete oldest->second.rooFitResult;
+        fitCache.erase(oldest);
+        fitCacheOrder.pop_front();
+    }
+
+    FitCacheEntry& entry = fitCache[key];
+    entry.neighbors = neighbors;
+    entry.rooFitResult = new RooFitResult(rooFitResult);
+    fitCacheOrder.push_back(key);
+}
+
+
+
+void WiBaS::ClearFitCache(){
+
+    std::map<unsigned long long, FitCacheEntry>::iterator it;
+    for(it=fitCache.begin(); it!=fitCache.end(); ++it)
+        delete it->second.rooFitResult;
+
+    fitCache.clear();
+    fitCacheOrder.clear();
+}
+
+
+
+unsigned long long WiBaS::HashNeighbors(const std::vector<unsigned int>& neighbors){
+
+    // FNV-1a style hash over the sorted indices, collisions are caught by
+    // comparing the stored index lists
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for(unsigned int i=0; i<neighbors.size(); i++){
+        hash ^= neighbors[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+
+double WiBaS::GetJaccardIndex(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b){
+
+    // Both index lists are sorted
+    unsigned int common = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    while(i < a.size() && j < b.size()){
+        if(a[i] < b[j])
+            i++;
+        else if(a[i] > b[j])
+            j++;
+        else{
+            common++;
+            i++;
+            j++;
+        }
+    }
+
+    unsigned int total = a.size() + b.size() - common;
+
+    return (total > 0) ? static_cast<double>(common) / total : 1.;
+}
@@ -0,0 +1,120 @@
+#include <cstdlib>
+#include <random>
+#include "Catch-master/single_include/catch.hpp"
+#include "EnergyTest.hh"
+#include "EnergyTestState.hh"
+#include "PhasespacePoint.hh"
+
+
+
+static void CheckIncrementalPhi(short distanceFunc){
+
+    EnergyTest energyTest(distanceFunc, false);
+    energyTest.RegisterPhasespaceCoord("x");
+    energyTest.RegisterPhasespaceCoord("y");
+
+    std::vector<PhasespacePoint> points(200);
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    for(unsigned int i=0; i<points.size(); i++){
+        points[i].SetCoordinate("x", uniform(generator));
+        points[i].SetCoordinate("y", uniform(generator) + (i < 60 ? 0.1 : 0.));
+        energyTest.ArrangePointCoordinates(points[i]);
+
+        if(i < 60)
+            energyTest.AddPhasespacePointData(points[i]);
+        else
+            energyTest.AddPhasespacePointFit(points[i]);
+    }
+
+    EnergyTestState state(energyTest);
+    REQUIRE(state.GetNumPoints() == 200);
+    REQUIRE(state.GetNumData() == 60);
+
+    for(int step=0; step<5; step++){
+        state.Swap(step * 7, 100 + step * 13);
+        state.MoveToFit(30 + step);
+
+        std::vector<PhasespacePoint*> dataVector;
+        std::vector<PhasespacePoint*> fitVector;
+        for(unsigned int i=0; i<points.size(); i++){
+            (state.IsData(i) ? dataVector : fitVector).push_back(&points[i]);
+        }
+
+        REQUIRE(state.GetNumData() == dataVector.size());
+        REQUIRE(state.GetPhi() == Approx(energyTest.GetPhi(dataVector, fitVector)).epsilon(1E-9));
+    }
+}
+
+
+
+TEST_CASE("EnergyTestState incremental updates"){
+
+    CheckIncrementalPhi(EnergyTest::DISTANCE_LOG);
+    CheckIncrementalPhi(EnergyTest::DISTANCE_GAUSS);
+}
+
+
+
+TEST_CASE("EnergyTest swap chain"){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_GAUSS, false);
+    energyTest.RegisterPhasespaceCoord("x");
+
+    // Same order as in EnergyTestState: data points first, then fit points
+    std::vector<PhasespacePoint> points;
+    unsigned int numData = 0;
+    for(int subset=0; subset<2; subset++){
+        for(int i=0; i<100; i++){
+            if((i % 3 == 0) != (subset == 0))
+                continue;
+
+            PhasespacePoint point;
+            point.SetCoordinate("x", i * 0.01);
+            energyTest.ArrangePointCoordinates(point);
+            points.push_back(point);
+
+            if(subset == 0){
+                energyTest.AddPhasespacePointData(point);
+                numData++;
+            }
+            else
+                energyTest.AddPhasespacePointFit(point);
+        }
+    }
+
+    std::vector<double> phis = energyTest.GetSwapChainPhis(50, 2, 10, 1);
+    std::vector<double> phisRepeated = energyTest.GetSwapChainPhis(50, 2, 10, 1);
+
+    REQUIRE(phis.size() == 50);
+    REQUIRE(phis == phisRepeated);
+
+    // Replay the swaps of the chain and compare its last Phi with a full
+    // calculation on the permuted subsets
+    std::vector<unsigned int> dataIndices;
+    std::vector<unsigned int> fitIndices;
+    for(unsigned int i=0; i<points.size(); i++)
+        (i < numData ? dataIndices : fitIndices).push_back(i);
+
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<unsigned int> dataDist(0, dataIndices.size() - 1);
+    std::uniform_int_distribution<unsigned int> fitDist(0, fitIndices.size() - 1);
+
+    for(int i=0; i<10 + 50; i++){
+        for(int j=0; j<2; j++){
+            unsigned int& dataIndex = dataIndices[dataDist(generator)];
+            unsigned int& fitIndex = fitIndices[fitDist(generator)];
+            std::swap(dataIndex, fitIndex);
+        }
+    }
+
+    std::vector<PhasespacePoint*> dataVector;
+    std::vector<PhasespacePoint*> fitVector;
+    for(unsigned int i=0; i<dataIndices.size(); i++)
+        dataVector.push_back(&points[dataIndices[i]]);
+    for(unsigned int i=0; i<fitIndices.size(); i++)
+        fitVector.push_back(&points[fitIndices[i]]);
+
+    REQUIRE(phis.back() == Approx(energyTest.GetPhi(dataVector, fitVector)).epsilon(1E-9));
+}
@@ -0,0 +1,173 @@
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "EnergyTest.hh"
+#include "PhasespacePoint.hh"
+#include "ColumnarPointFile.hh"
+#include "PointColumns.hh"
+#include "TestHeap.hh"
+
+
+
+TEST_CASE("EnergyTest sequential p-value"){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_GAUSS, false);
+    energyTest.RegisterPhasespaceCoord("x");
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    // Strongly shifted data: the p-value is decided long before the maximum
+    // number of resamplings. With no exceeding phi, the 99% upper limit split
+    // over 20 looks (z = 3.48) drops below 5% after 250 resamplings.
+    for(int i=0; i<300; i++){
+        PhasespacePoint point;
+        point.SetCoordinate("x", uniform(generator) + (i < 100 ? 0.5 : 0.));
+        if(i < 100)
+            energyTest.AddPhasespacePointData(point);
+        else
+            energyTest.AddPhasespacePointFit(point);
+    }
+
+    // Resamples from own generators, the global rand() stays untouched
+    energyTest.SetReproducible();
+    PValueResult result = energyTest.GetPValue(0.05, 1000, 2, 50, 0.99, 5);
+
+    REQUIRE(result.decided);
+    REQUIRE(result.numResamples == 250);
+    REQUIRE(result.numExceeding == 0);
+    REQUIRE(result.pValue == 0);
+    REQUIRE(result.upperLimit < 0.05);
+    REQUIRE(result.lowerLimit == 0);
+}
+
+
+
+TEST_CASE("EnergyTest streamed fit sample"){
+
+    EnergyTest memoryTest(EnergyTest::DISTANCE_LOG, false);
+    EnergyTest streamedTest(EnergyTest::DISTANCE_LOG, false);
+    memoryTest.RegisterPhasespaceCoord("x");
+    memoryTest.RegisterPhasespaceCoord("phi", PhasespacePointCloud::Pi, PhasespacePointCloud::IS_2PI_CIRCULAR);
+    streamedTest.RegisterPhasespaceCoord("x");
+    streamedTest.RegisterPhasespaceCoord("phi", PhasespacePointCloud::Pi, PhasespacePointCloud::IS_2PI_CIRCULAR);
+
+    std::vector<std::string> coordNames;
+    coordNames.push_back("phi");
+    coordNames.push_back("x");
+    std::string fileName = "EnergyTest_streamed.col";
+    int numFit = 5000;
+    std::mt19937 generator(13);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    {
+        ColumnarPointFile fitFile(fileName, coordNames, numFit);
+
+        for(int i=0; i<numFit + 400; i++){
+            PhasespacePoint point;
+            point.SetCoordinate("x", uniform(generator));
+            point.SetCoordinate("phi", (uniform(generator) * 2. - 1.) * PhasespacePointCloud::Pi);
+            point.SetInitialWeight(0.5 + uniform(generator));
+
+            if(i < 400){
+                memoryTest.AddPhasespacePointData(point);
+                streamedTest.AddPhasespacePointData(point);
+            }
+            else{
+                memoryTest.AddPhasespacePointFit(point);
+                fitFile.SetPoint(i - 400, point);
+            }
+        }
+    }
+
+    // Budget for the resident data and two tiles of 1024 points
+    double phi = memoryTest.GetPhi();
+    double streamedPhi = streamedTest.GetPhiStreamed(fileName, 400 * 24 + 2 * 1024 * 24);
+
+    REQUIRE(streamedPhi == Approx(phi).epsilon(1E-5));
+    std::remove(fileName.c_str());
+}
+
+
+
+TEST_CASE("EnergyTest reproducible resampling"){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_LOG, false);
+    energyTest.RegisterPhasespaceCoord("x");
+    energyTest.RegisterPhasespaceCoord("y");
+    std::mt19937 generator(29);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    for(int i=0; i<200; i++){
+        PhasespacePoint point;
+        point.SetCoordinate("x", uniform(generator));
+        point.SetCoordinate("y", uniform(generator));
+
+        if(i < 80)
+            energyTest.AddPhasespacePointData(point);
+        else
+            energyTest.AddPhasespacePointFit(point);
+    }
+
+    energyTest.SetReproducible();
+    energyTest.GetPhi();
+
+    // Same resamples in the same order for any number of threads
+    std::vector<double> serial = energyTest.GetResampledPhis(8, 1, 7);
+    std::vector<double> threaded = energyTest.GetResampledPhis(2, 4, 7);
+    std::vector<double> otherSeed = energyTest.GetResampledPhis(8, 1, 8);
+
+    REQUIRE(serial.size() == 8);
+    REQUIRE(serial == threaded);
+    REQUIRE(serial != otherSeed);
+}
+
+
+
+TEST_CASE("EnergyTest memory accounting"){
+
+    EnergyTest energyTest(EnergyTest::DISTANCE_GAUSS, false);
+    energyTest.RegisterPhasespaceCoord("x");
+    energyTest.RegisterPhasespaceCoord("y");
+
+    std::vector<PhasespacePoint> points(300);
+    std::vector<PhasespacePoint*> dataPoints;
+    std::vector<PhasespacePoint*> fitPoints;
+
+    for(int i=0; i<300; i++){
+        points[i].SetCoordinate("x", i);
+        points[i].SetCoordinate("y", -i);
+
+        if(i < 100){
+            energyTest.AddPhasespacePointData(points[i]);
+            dataPoints.push_back(&points[i]);
+        }
+        else{
+            energyTest.AddPhasespacePointFit(points[i]);
+            fitPoints.push_back(&points[i]);
+        }
+    }
+
+    MemoryUsage usage = energyTest.GetMemoryUsage();
+    REQUIRE(usage.energyTest > 0);
+    REQUIRE(energyTest.GetResamplingMemoryUsage(4).energyTest > 4 * usage.energyTest);
+
+#ifdef TEST_HEAP_BYTES
+    // The coordinate and weight columns that GetPhi allocates, against the
+    // allocator
+    std::vector<double> invNorms(2, 1.);
+    size_t heapBefore = GetHeapBytes();
+    size_t heapBytes;
+    {
+        PointColumns dataColumns;
+        PointColumns fitColumns;
+        dataColumns.Fill(dataPoints, invNorms);
+        fitColumns.Fill(fitPoints, invNorms);
+        heapBytes = GetHeapBytes() - heapBefore;
+    }
+
+    REQUIRE(usage.energyTest == heapBytes);
+    REQUIRE(EnergyTest::EstimateMemoryUsage(100, 200, 2, 0).energyTest == heapBytes);
+#endif
+}
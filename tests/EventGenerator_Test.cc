@@ -0,0 +1,108 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "EventGenerator.hh"
+#include "PhasespacePointCloud.hh"
+#include "ColumnarPointFile.hh"
+
+
+
+TEST_CASE( "EventGenerator samples", "[EventGenerator]" ) {
+
+    const double minMass = 600;
+    const double maxMass = 1000;
+
+    SECTION( "same seed, same sample" ) {
+        EventGenerator generator1(3, minMass, maxMass, 17);
+        EventGenerator generator2(3, minMass, maxMass, 17);
+        PhasespacePoint point1;
+        PhasespacePoint point2;
+
+        for(int i=0; i<100; i++){
+            REQUIRE( generator1.Generate(point1) == generator2.Generate(point2) );
+            REQUIRE( point1.GetMass() == point2.GetMass() );
+            REQUIRE( point1.coordValueMap["x2"] == point2.coordValueMap["x2"] );
+        }
+
+        generator1.SetSeed(17);
+        generator2.SetSeed(17);
+        generator1.Generate(point1);
+        generator2.Generate(point2);
+        REQUIRE( point1.GetMass() == point2.GetMass() );
+    }
+
+    SECTION( "coordinates, masses and weights stay in range" ) {
+        EventGenerator generator(2, minMass, maxMass, 3);
+        generator.SetCircular(1);
+        generator.SetSignal(EventGenerator::SHAPE_VOIGT, 780, 10, 30);
+        generator.SetInitialWeights(0.5, 2);
+        generator.SetTwoMasses(true);
+
+        PhasespacePoint point;
+        for(int i=0; i<2000; i++){
+            generator.Generate(point);
+            REQUIRE( std::abs(point.coordValueMap["x0"]) <= 1 );
+            REQUIRE( std::abs(point.coordValueMap["x1"]) <= PhasespacePointCloud::Pi );
+            REQUIRE( point.GetMass() >= minMass );
+            REQUIRE( point.GetMass() < maxMass );
+            REQUIRE( point.GetMass2() >= minMass );
+            REQUIRE( point.GetInitialWeight() >= 0.5 );
+            REQUIRE( point.GetInitialWeight() <= 2 );
+        }
+    }
+
+    SECTION( "signal fraction and shapes" ) {
+        std::vector<double> coefs(1, 0.002);
+        short shapes[] = {EventGenerator::SHAPE_GAUSS, EventGenerator::SHAPE_CRYSTALBALL};
+
+        for(int s=0; s<2; s++){
+            EventGenerator generator(1, minMass, maxMass, 5);
+            generator.SetSignal(shapes[s], 800, 10, 0, 1.5, 3);
+            generator.SetBackground(coefs);
+            generator.SetSignalFraction(0.3);
+
+            PhasespacePoint point;
+            const int numEvents = 100000;
+            int numSignal = 0;
+            double sumQ = 0;
+            double sumBackground = 0;
+
+            for(int i=0; i<numEvents; i++){
+                if(generator.Generate(point)){
+                    numSignal++;
+                    if(shapes[s] == EventGenerator::SHAPE_GAUSS)
+                        REQUIRE( std::abs(point.GetMass() - 800) < 80 );
+                }
+                else{
+                    sumBackground += point.GetMass() - minMass;
+                }
+                sumQ += generator.GetTrueQ(point);
+            }
+
+            REQUIRE( numSignal / double(numEvents) == Approx(0.3).epsilon(0.02) );
+
+            // The mean Q is the signal fraction
+            REQUIRE( sumQ / numEvents == Approx(0.3).epsilon(0.02) );
+
+            // Mean of x with the density 1 + 0.002 x on [0, 400]
+            double expectedMean = (400. * 400. / 2 + 0.002 * 400. * 400. * 400. / 3) / (400. + 0.002 * 400. * 400. / 2);
+            REQUIRE( sumBackground / (numEvents - numSignal) == Approx(expectedMean).epsilon(0.01) );
+        }
+    }
+
+    SECTION( "columnar file" ) {
+        const char* fileName = "eventGeneratorTest.col";
+        EventGenerator generator(2, minMass, maxMass, 9);
+        REQUIRE( generator.WriteColumnarFile(fileName, 1000) );
+
+        ColumnarPointFile file(fileName);
+        REQUIRE( file.IsOpen() );
+        REQUIRE( file.GetNumPoints() == 1000 );
+        REQUIRE( file.GetCoordNames() == generator.GetCoordNames() );
+        REQUIRE( file.GetMassColumn()[999] >= minMass );
+        REQUIRE( std::isnan(file.GetMass2Column()[0]) );
+
+        remove(fileName);
+    }
+}
@@ -0,0 +1,56 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "Catch-master/single_include/catch.hpp"
+#include "FastMath.hh"
+
+
+
+TEST_CASE("FastMath accuracy against libm"){
+
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    double maxLogDeviation = 0;
+    double maxExpDeviation = 0;
+
+    // log over the full range of distances plus epsilon
+    for(int i=0; i<200000; i++){
+        double x = exp((uniform(generator) - 0.5) * 1400.);
+        double reference = log(x);
+        double deviation = fabs(FastMath::Log(x) - reference) / std::max(fabs(reference), 1.);
+        maxLogDeviation = std::max(maxLogDeviation, deviation);
+    }
+
+    // log close to 1, where the result is small
+    for(int i=0; i<200000; i++){
+        double x = 1. + (uniform(generator) - 0.5) * 0.1;
+        double reference = log(x);
+        if(reference != 0)
+            maxLogDeviation = std::max(maxLogDeviation, fabs(FastMath::Log(x) - reference) / fabs(reference));
+    }
+
+    for(int i=0; i<200000; i++){
+        double x = (uniform(generator) - 0.5) * 1400.;
+        double reference = exp(x);
+        if(x > -708. && x < 709.)
+            maxExpDeviation = std::max(maxExpDeviation, fabs(FastMath::Exp(x) - reference) / reference);
+    }
+
+    REQUIRE(maxLogDeviation < 1E-15);
+    REQUIRE(maxExpDeviation < 1E-15);
+    REQUIRE(FastMath::Exp(0.) == 1.);
+    REQUIRE(FastMath::Exp(-1000.) == 0.);
+    REQUIRE(FastMath::Log(1.) == 0.);
+
+    std::vector<double> values(1000);
+    std::vector<double> results(1000);
+    for(unsigned int i=0; i<values.size(); i++){
+        values[i] = -0.01 * i;
+    }
+
+    FastMath::ExpBatch(&values[0], &results[0], values.size());
+    for(unsigned int i=0; i<values.size(); i++){
+        REQUIRE(results[i] == Approx(exp(values[i])).epsilon(1E-15));
+    }
+}
@@ -16,4 +16,19 @@ TEST_CASE("FastPointMap Tests"){
     REQUIRE(comp(fpm1, fpm2) == true);
     REQUIRE(comp(fpm2, fpm1) == false);
     REQUIRE(comp(fpm1, fpm1) == false);
-}
\ No newline at end of file
+}
+
+
+TEST_CASE("FastPointMap stable order of equal distances"){
+
+    PhasespacePoint p;
+    FastPointMap near(&p, 1, 9);
+    FastPointMap tieLow(&p, 2, 3);
+    FastPointMap tieHigh(&p, 2, 5);
+
+    REQUIRE(FastPointMap::CompareStable(near, tieLow) == true);
+    REQUIRE(FastPointMap::CompareStable(tieLow, near) == false);
+    REQUIRE(FastPointMap::CompareStable(tieLow, tieHigh) == true);
+    REQUIRE(FastPointMap::CompareStable(tieHigh, tieLow) == false);
+    REQUIRE(FastPointMap::CompareStable(tieLow, tieLow) == false);
+}
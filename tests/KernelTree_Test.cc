@@ -0,0 +1,100 @@
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "Catch-master/single_include/catch.hpp"
+#include "KernelTree.hh"
+#include "EnergyTest.hh"
+#include "PhasespacePoint.hh"
+
+
+
+TEST_CASE("KernelTree log kernel summation"){
+
+    std::vector<PhasespacePoint*> points;
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    for(int i=0; i<2000; i++){
+        PhasespacePoint* point = new PhasespacePoint;
+        point->coordValueVector.push_back(uniform(generator) * 4.);
+        point->coordValueVector.push_back((uniform(generator) * 2. - 1.) * PhasespacePointCloud::Pi);
+        point->SetInitialWeight(0.5 + uniform(generator));
+        points.push_back(point);
+    }
+
+    std::vector<double> norms;
+    norms.push_back(2.);
+    norms.push_back(PhasespacePointCloud::Pi);
+    std::vector<bool> isCircular;
+    isCircular.push_back(false);
+    isCircular.push_back(true);
+
+    KernelTree tree(points, norms, isCircular);
+    double epsilon = 1E-6;
+
+    for(int i=0; i<2000; i+=97){
+        double target[2];
+        tree.NormalizePoint(points[i], target);
+
+        // Brute force reference using the same metric
+        double refSum = 0;
+        for(int j=0; j<2000; j++){
+            if(j == i)
+                continue;
+            double d0 = (points[j]->GetCoordValue(0) - points[i]->GetCoordValue(0)) / norms[0];
+            double d1 = fabs(points[j]->GetCoordValue(1) - points[i]->GetCoordValue(1)) / norms[1];
+            d1 = std::min(d1, fabs(2. - d1));
+            refSum -= points[j]->GetInitialWeight() * log(sqrt(d0*d0 + d1*d1) + epsilon);
+        }
+
+        double errorBound;
+        double exactSum = tree.SumLogKernel(target, points[i], epsilon, 0., errorBound);
+        REQUIRE(exactSum == Approx(refSum).epsilon(1E-10));
+        REQUIRE(errorBound == 0);
+
+        double approxSum = tree.SumLogKernel(target, points[i], epsilon, 1E-2, errorBound);
+        REQUIRE(errorBound > 0);
+        REQUIRE(fabs(approxSum - refSum) <= errorBound);
+    }
+
+    // The pre-flight estimate is an upper bound of the tree memory
+    REQUIRE(tree.GetMemoryUsage() > 2000 * 3 * sizeof(double));
+    REQUIRE(KernelTree::EstimateMemoryUsage(2000, 2) >= tree.GetMemoryUsage());
+    REQUIRE(KernelTree::EstimateMemoryUsage(2000, 2) < 2 * tree.GetMemoryUsage());
+
+    for(auto it = points.begin(); it != points.end(); ++it){
+        delete *it;
+    }
+}
+
+
+
+TEST_CASE("EnergyTest tree summation"){
+
+    EnergyTest exactTest(EnergyTest::DISTANCE_LOG, false);
+    EnergyTest treeTest(EnergyTest::DISTANCE_LOG, false);
+    exactTest.RegisterPhasespaceCoord("x");
+    treeTest.RegisterPhasespaceCoord("x");
+    treeTest.SetSummationMode(EnergyTest::SUMMATION_TREE, 1E-3);
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    for(int i=0; i<1500; i++){
+        PhasespacePoint point;
+        point.SetCoordinate("x", uniform(generator));
+        if(i < 500){
+            exactTest.AddPhasespacePointData(point);
+            treeTest.AddPhasespacePointData(point);
+        }
+        else{
+            exactTest.AddPhasespacePointFit(point);
+            treeTest.AddPhasespacePointFit(point);
+        }
+    }
+
+    double exactPhi = exactTest.GetPhi();
+    double treePhi = treeTest.GetPhi();
+
+    REQUIRE(treeTest.GetPhiErrorBound() > 0);
+    REQUIRE(fabs(treePhi - exactPhi) <= treeTest.GetPhiErrorBound() + 1E-6);
+}
@@ -0,0 +1,134 @@
+#include <cmath>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "MixtureModel.hh"
+#include "ModelShapes.hh"
+
+
+
+template<class Model>
+void CheckQGradient(Model& model, double x, double y){
+
+    std::vector<double> params(model.GetParameters(), model.GetParameters() + Model::NUM_PARAMS);
+    std::vector<double> gradient(Model::NUM_PARAMS);
+    model.GetQGradient(x, y, &gradient[0]);
+
+    for(unsigned int i=0; i<Model::NUM_PARAMS; i++){
+        double epsilon = 1E-6 * (fabs(params[i]) + 1E-3);
+        std::vector<double> shifted(params);
+
+        shifted[i] = params[i] + epsilon;
+        model.SetParameters(&shifted[0]);
+        double high = model.GetQValue(x, y);
+
+        shifted[i] = params[i] - epsilon;
+        model.SetParameters(&shifted[0]);
+        double low = model.GetQValue(x, y);
+
+        REQUIRE(gradient[i] == Approx((high - low) / (2. * epsilon)).epsilon(1E-5));
+    }
+
+    model.SetParameters(&params[0]);
+}
+
+
+
+TEST_CASE("MixtureModel normalization and Q"){
+
+    // Gaussian signal at 100 with a quadratic background on [0, 200]
+    MixtureModel<GaussShape, PolynomialShape<2>, 1> model(GaussShape(100., 10., 1., 50.), PolynomialShape<2>(), 200.);
+    REQUIRE(model.NUM_PARAMS == 4);
+
+    double params[] = {12., 0.02, -5E-5, 0.3};
+    model.SetParameters(params);
+
+    double integral = 0;
+    int numSteps = 20000;
+    for(int i=0; i<numSteps; i++){
+        double x = (i + 0.5) * 200. / numSteps;
+        double density = model.GetShare() * model.GetSignalDensity(x, 0) +
+                         (1 - model.GetShare()) * model.GetBackgroundDensity(x, 0);
+        integral += density * 200. / numSteps;
+    }
+
+    REQUIRE(integral == Approx(1.).epsilon(1E-6));
+
+    double s = 0.3 * exp(-0.5 * (4. / 12.) * (4. / 12.)) / (12. * sqrt(2. * M_PI) * erf(100. / (12. * sqrt(2.))));
+    double b = 0.7 * (1 + 0.02 * 104. - 5E-5 * 104. * 104.) / (200. + 0.02 * 200. * 200. / 2. - 5E-5 * 200. * 200. * 200. / 3.);
+    REQUIRE(model.GetQValue(104., 0) == Approx(s / (s + b)).epsilon(1E-12));
+
+    CheckQGradient(model, 104., 0);
+    CheckQGradient(model, 20., 0);
+}
+
+
+
+TEST_CASE("MixtureModel Voigt gradient in two dimensions"){
+
+    MixtureModel<VoigtShape, PolynomialShape<1>, 2> model(VoigtShape(82.65, 8.49, 10., 1., 40.),
+                                                          PolynomialShape<1>(), 200.);
+
+    double params[] = {14., 0.01, 0.6};
+    model.SetParameters(params);
+
+    REQUIRE(model.GetQValue(80., 90.) > 0.5);
+    CheckQGradient(model, 80., 90.);
+    CheckQGradient(model, 150., 60.);
+}
+
+
+
+TEST_CASE("MixtureModel Crystal Ball shape"){
+
+    // Tail reaching into the range, the tail and the core are both probed
+    MixtureModel<CrystalBallShape, PolynomialShape<1>, 1> model(CrystalBallShape(120., 10., 1., 50., 1.5, 0.1, 10., 3.),
+                                                                PolynomialShape<1>(), 200.);
+
+    double params[] = {12., 1.2, 0.004, 0.6};
+    model.SetParameters(params);
+
+    double integral = 0;
+    int numSteps = 200000;
+    for(int i=0; i<numSteps; i++){
+        double x = (i + 0.5) * 200. / numSteps;
+        integral += model.GetSignalDensity(x, 0) * 200. / numSteps;
+    }
+
+    REQUIRE(integral == Approx(1.).epsilon(1E-6));
+
+    CheckQGradient(model, 60., 0);
+    CheckQGradient(model, 125., 0);
+}
+
+
+
+TEST_CASE("MixtureModel likelihood"){
+
+    MixtureModel<VoigtShape, PolynomialShape<2>, 1> model(VoigtShape(82.65, 8.49, 10., 1., 40.),
+                                                          PolynomialShape<2>(), 200.);
+
+    double params[] = {9., 0.05, 1E-4, 0.4};
+    model.SetParameters(params);
+
+    std::vector<double> masses;
+    std::vector<double> weights;
+    for(int i=0; i<1000; i++){
+        masses.push_back(fmod(i * 61.803398875, 200.));
+        weights.push_back(0.5 + (i % 3) * 0.25);
+    }
+
+    double expected = 0;
+    for(size_t i=0; i<masses.size(); i++){
+        double density = 0.4 * model.GetSignalDensity(masses[i], 0) + 0.6 * model.GetBackgroundDensity(masses[i], 0);
+        expected -= weights[i] * log(density);
+    }
+
+    double nll;
+    REQUIRE(model.GetNegativeLogLikelihood(&masses[0], NULL, &weights[0], masses.size(), nll));
+    REQUIRE(nll == Approx(expected).epsilon(1E-12));
+
+    // Negative background density
+    double negative[] = {9., -0.05, 0., 0.4};
+    model.SetParameters(negative);
+    REQUIRE(!model.GetNegativeLogLikelihood(&masses[0], NULL, &weights[0], masses.size(), nll));
+}
@@ -0,0 +1,35 @@
+#include <cmath>
+#include "Catch-master/single_include/catch.hpp"
+#include "NormalizationCache.hh"
+
+
+
+TEST_CASE("NormalizationCache interpolation"){
+
+    // Integral of exp(-(x-0.3)^2 / (2 sigma^2)) over [0, 1] and its sigma derivative
+    double mean = 0.3;
+    double range = 1.;
+    NormalizationCache cache(0.01, 0.5, 128);
+
+    for(unsigned int i=0; i<cache.GetNumNodes(); i++){
+        double sigma = cache.GetNode(i);
+        double tlow = -mean / sigma;
+        double thigh = (range - mean) / sigma;
+        double integral = sigma * sqrt(M_PI / 2.) * (erf(thigh / sqrt(2.)) - erf(tlow / sqrt(2.)));
+        double derivative = integral / sigma - thigh * exp(-0.5 * thigh * thigh) + tlow * exp(-0.5 * tlow * tlow);
+        cache.SetNode(i, integral, derivative);
+    }
+
+    REQUIRE(cache.GetNode(0) == Approx(0.01));
+    REQUIRE(cache.GetNode(127) == Approx(0.5));
+    REQUIRE(cache.IsInRange(0.2));
+    REQUIRE(!cache.IsInRange(0.6));
+
+    for(double sigma=0.01; sigma<=0.5; sigma+=0.00731){
+        double tlow = -mean / sigma;
+        double thigh = (range - mean) / sigma;
+        double integral = sigma * sqrt(M_PI / 2.) * (erf(thigh / sqrt(2.)) - erf(tlow / sqrt(2.)));
+
+        REQUIRE(cache.GetValue(sigma) == Approx(integral).epsilon(1E-8));
+    }
+}
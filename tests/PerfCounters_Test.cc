@@ -0,0 +1,58 @@
+#include "Catch-master/single_include/catch.hpp"
+
+#include <thread>
+#include <string>
+
+#include "PerfCounters.hh"
+
+
+TEST_CASE("PerfCounters count a loop"){
+
+    PerfCounters counters;
+    volatile double sum = 0;
+
+    counters.Start();
+    for(int i=0; i<1000000; i++)
+        sum += i * 0.5;
+    counters.Stop();
+
+    // Without permissions for perf_event_open the counters stay zero
+    for(short e=0; e<PerfCounters::NUM_EVENTS; e++){
+        if(counters.IsAvailable(e))
+            REQUIRE(counters.GetCount(e) >= 0);
+        else
+            REQUIRE(counters.GetCount(e) == 0);
+    }
+
+    if(counters.IsAvailable(PerfCounters::INSTRUCTIONS))
+        REQUIRE(counters.GetCount(PerfCounters::INSTRUCTIONS) > 1000000);
+
+    REQUIRE(std::string(PerfCounters::GetEventName(PerfCounters::LLC_MISSES)) == "llc_misses");
+}
+
+
+
+TEST_CASE("PerfCounters inherit to new threads"){
+
+    PerfCounters own;
+    PerfCounters inherited(true);
+
+    if(!own.IsAvailable(PerfCounters::INSTRUCTIONS) || !inherited.IsAvailable(PerfCounters::INSTRUCTIONS))
+        return;
+
+    own.Start();
+    inherited.Start();
+
+    std::thread worker([](){
+        volatile double sum = 0;
+        for(int i=0; i<10000000; i++)
+            sum += i * 0.5;
+    });
+    worker.join();
+
+    own.Stop();
+    inherited.Stop();
+
+    REQUIRE(inherited.GetCount(PerfCounters::INSTRUCTIONS) > 10000000);
+    REQUIRE(own.GetCount(PerfCounters::INSTRUCTIONS) < inherited.GetCount(PerfCounters::INSTRUCTIONS));
+}
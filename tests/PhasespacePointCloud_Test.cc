@@ -1,8 +1,11 @@
+#include <cstdlib>
 #include <map>
+#include <vector>
 #include "Catch-master/single_include/catch.hpp"
 #include "PhasespacePointCloud.hh"
 #include "PhasespaceCoord.hh"
 #include "PhasespacePoint.hh"
+#include "TestHeap.hh"
 
 
 
@@ -58,4 +61,54 @@ TEST_CASE("PhasespacePointCloud distance calculation 2Pi circular coordinate"){
     // Distance should yield 0.2, not 1.8
     double distance = cloud.CalcPhasespaceDistance(&point1, &point2);
     REQUIRE(distance == Approx(0.2).epsilon(1E-6));
-}
\ No newline at end of file
+}
+
+
+TEST_CASE("PhasespacePointCloud memory accounting"){
+
+    PhasespacePointCloud cloud;
+    cloud.RegisterPhasespaceCoord("c1", 1, false);
+    cloud.RegisterPhasespaceCoord("c2", 1, false);
+    cloud.RegisterPhasespaceCoord("c3", 1, false);
+
+#ifdef TEST_HEAP_BYTES
+    size_t heapBefore = GetHeapBytes();
+#endif
+
+    for(int i=0; i<1000; i++){
+        PhasespacePoint point;
+        point.SetCoordinate("c1", i);
+        point.SetCoordinate("c2", 2 * i);
+        point.SetCoordinate("c3", 3 * i);
+        cloud.AddPhasespacePoint(point);
+    }
+
+#ifdef TEST_HEAP_BYTES
+    size_t heapBytes = GetHeapBytes() - heapBefore;
+#endif
+
+    MemoryUsage usage = cloud.GetMemoryUsage();
+    MemoryUsage estimate = PhasespacePointCloud::EstimateMemoryUsage(1000, 3, 2);
+
+    REQUIRE(usage.coordinateMaps > 3000 * sizeof(double));
+    REQUIRE(usage.GetTotal() == usage.pointStorage + usage.coordinateMaps);
+
+#ifdef TEST_HEAP_BYTES
+    // The accounting and the pre-flight estimate against the allocator
+    REQUIRE(usage.GetTotal() == Approx(heapBytes).epsilon(0.01));
+    REQUIRE(estimate.GetTotal() == Approx(heapBytes).epsilon(0.01));
+
+    for(size_t bytes=1; bytes<2000; bytes+=37){
+        void* block = malloc(bytes);
+        size_t chunk = malloc_usable_size(block) + sizeof(size_t);
+        free(block);
+        REQUIRE(MemoryUsage::GetAllocationSize(bytes) == chunk);
+    }
+#endif
+
+    std::vector<int> grown;
+    for(int i=0; i<1000; i++)
+        grown.push_back(i);
+
+    REQUIRE(MemoryUsage::GetGrownCapacity(grown.size()) == grown.capacity());
+}
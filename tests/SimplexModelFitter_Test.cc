@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "SimplexModelFitter.hh"
+#include "ModelShapes.hh"
+#include "TestSamples.hh"
+
+
+
+namespace {
+
+void GenerateNeighbors(unsigned int seed, int numPoints, std::vector<double>& masses, std::vector<double>& weights){
+
+    // Gaussian signal at 100 with a width of 14 on a flat background in [0, 200]
+    GenerateGaussSample(seed, numPoints, 100., 14., 0., 200., 0.7, masses);
+
+    for(size_t i=0; i<masses.size(); i++)
+        masses[i] = std::min(std::max(masses[i], 0.), 200.);
+
+    weights.assign(masses.size(), 1.);
+}
+
+}
+
+
+
+TEST_CASE("SimplexModelFitter fits"){
+
+    typedef SimplexModelFitter<GaussShape, PolynomialShape<1> > Fitter;
+
+    Fitter fitter(GaussShape(100., 10., 1., 100.), PolynomialShape<1>(), 200.);
+    fitter.SetCalcErrors(true);
+
+    const unsigned int numEvents = 11;
+    std::vector<std::vector<double> > masses(numEvents);
+    std::vector<std::vector<double> > weights(numEvents);
+
+    for(unsigned int e=0; e<numEvents; e++){
+        GenerateNeighbors(e + 1, 500 + 37 * e, masses[e], weights[e]);
+        fitter.AddEvent(100 + e, masses[e].size(), &masses[e][0], NULL, &weights[e][0], 95., 0);
+    }
+
+    REQUIRE(fitter.GetNumEvents() == numEvents);
+
+    std::vector<Fitter::Result> results;
+    fitter.Run(results);
+
+    REQUIRE(fitter.GetNumEvents() == 0);
+    REQUIRE(results.size() == numEvents);
+
+    Fitter::Model model(GaussShape(100., 10., 1., 100.), PolynomialShape<1>(), 200.);
+
+    for(unsigned int e=0; e<numEvents; e++){
+
+        // A queued event is fitted as if it were alone
+        std::vector<Fitter::Result> single;
+        fitter.AddEvent(100 + e, masses[e].size(), &masses[e][0], NULL, &weights[e][0], 95., 0);
+        fitter.Run(single);
+
+        REQUIRE(single.size() == 1);
+        REQUIRE(results[e].id == 100 + e);
+        REQUIRE(results[e].status == 0);
+        REQUIRE(results[e].covQual == 3);
+        REQUIRE(results[e].weight == single[0].weight);
+        REQUIRE(results[e].weightError == single[0].weightError);
+        REQUIRE(results[e].numCalls == single[0].numCalls);
+
+        REQUIRE(results[e].params[0] == Approx(14.).epsilon(0.15));
+        REQUIRE(results[e].params[2] == Approx(0.7).epsilon(0.1));
+        REQUIRE(results[e].weightError > 0);
+        REQUIRE(results[e].weightError < 0.05);
+
+        // The result is a minimum of the likelihood
+        double nll;
+        model.SetParameters(results[e].params);
+        model.GetNegativeLogLikelihood(&masses[e][0], NULL, &weights[e][0], masses[e].size(), nll);
+
+        for(unsigned int i=0; i<Fitter::NUM_PARAMS; i++){
+            double shifted[Fitter::NUM_PARAMS];
+            for(unsigned int j=0; j<Fitter::NUM_PARAMS; j++)
+                shifted[j] = results[e].params[j];
+
+            shifted[i] = results[e].params[i] * 1.01;
+            model.SetParameters(shifted);
+
+            double shiftedNll;
+            model.GetNegativeLogLikelihood(&masses[e][0], NULL, &weights[e][0], masses[e].size(), shiftedNll);
+            REQUIRE(shiftedNll > nll - 1E-5);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef TESTHEAP_HH
+#define TESTHEAP_HH
+
+#include <cstdlib>
+
+// Bytes in use on the heap, from mallinfo2 of glibc 2.33 or newer. With
+// other allocators TEST_HEAP_BYTES is not defined and the checks of the
+// memory accounting against the allocator are skipped.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+
+#define TEST_HEAP_BYTES
+
+inline size_t GetHeapBytes(){
+
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+#endif
+
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TESTSAMPLES_HH
+#define TESTSAMPLES_HH
+
+#include <random>
+#include <vector>
+
+// Gaussian peak with a share signalShare on a flat background in
+// [minMass, maxMass], drawn from its own generator so that a sample only
+// depends on the seed and not on the order of the test cases. With masses2
+// the signal events get a second Gaussian mass, the background events a
+// second flat one.
+inline void GenerateGaussSample(unsigned int seed, int numEvents, double mean, double width,
+                                double minMass, double maxMass, double signalShare,
+                                std::vector<double>& masses, std::vector<double>* masses2=NULL){
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> gauss(mean, width);
+    std::uniform_real_distribution<double> flat(minMass, maxMass);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    masses.clear();
+    if(masses2 != NULL)
+        masses2->clear();
+
+    for(int i=0; i<numEvents; i++){
+        bool signal = uniform(generator) < signalShare;
+        masses.push_back(signal ? gauss(generator) : flat(generator));
+
+        if(masses2 != NULL)
+            masses2->push_back(signal ? gauss(generator) : flat(generator));
+    }
+}
+
+
+#endif
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <vector>
+#include <complex>
+#include "Catch-master/single_include/catch.hpp"
+#include "VoigtProfile.hh"
+
+
+
+namespace {
+
+// Laplace continued fraction of w(z), converges quickly for |z| > 6
+std::complex<double> ContinuedFraction(std::complex<double> z){
+
+    std::complex<double> t = z;
+    for(int k=300; k>=1; k--)
+        t = z - (k / 2.) / t;
+
+    return std::complex<double>(0., 1. / sqrt(M_PI)) / t;
+}
+
+}
+
+
+
+TEST_CASE("VoigtProfile Faddeeva accuracy"){
+
+    // On the imaginary axis w(iy) = exp(y^2) erfc(y)
+    for(double y=1E-6; y<30; y*=1.3){
+        double re, im;
+        VoigtProfile::Faddeeva(0, y, re, im);
+        long double ref = expl((long double)y * y) * erfcl(y);
+
+        REQUIRE(fabs(re - ref) < 1E-13 * ref);
+        REQUIRE(fabs(im) < 1E-13);
+    }
+
+    // Far from the origin, relative to the reference and absolute to the peak
+    for(double y=1E-3; y<30; y*=2){
+        double peakRe, peakIm;
+        VoigtProfile::Faddeeva(0, y, peakRe, peakIm);
+
+        for(double x=6.5; x<300; x*=1.1){
+            double re, im;
+            VoigtProfile::Faddeeva(x, y, re, im);
+            std::complex<double> ref = ContinuedFraction(std::complex<double>(x, y));
+
+            REQUIRE(fabs(re - ref.real()) < 1E-8 * ref.real());
+            REQUIRE(fabs(re - ref.real()) < 1E-13 * peakRe);
+            REQUIRE(fabs(im - ref.imag()) < 1E-8 * fabs(ref.imag()));
+        }
+    }
+}
+
+
+
+TEST_CASE("VoigtProfile evaluation"){
+
+    VoigtProfile profile(782.65, 8.49, 10.);
+
+    // Unit normalization on a wide range (the Lorentzian tails beyond are ~2E-4)
+    double integral = 0;
+    double step = 0.01;
+    for(double x=-30000+782.65; x<30000+782.65; x+=step)
+        integral += profile.Evaluate(x + 0.5 * step) * step;
+    REQUIRE(integral == Approx(1.).epsilon(1E-3));
+
+    std::vector<double> masses;
+    for(int i=0; i<1000; i++)
+        masses.push_back(700 + 0.17 * i);
+
+    std::vector<double> values(masses.size());
+    std::vector<double> batchValues(masses.size());
+    std::vector<double> batchDSigma(masses.size());
+    profile.EvaluateBatch(&masses[0], &values[0], masses.size());
+    profile.EvaluateBatch(&masses[0], &batchValues[0], &batchDSigma[0], masses.size());
+
+    VoigtProfile upper(782.65, 8.49, 10. + 1E-5);
+    VoigtProfile lower(782.65, 8.49, 10. - 1E-5);
+
+    for(size_t i=0; i<masses.size(); i++){
+        double value, dSigma, dX;
+        profile.Evaluate(masses[i], value, dSigma, dX);
+
+        REQUIRE(values[i] == Approx(profile.Evaluate(masses[i])).epsilon(1E-14));
+        REQUIRE(batchValues[i] == Approx(value).epsilon(1E-14));
+        REQUIRE(batchDSigma[i] == Approx(dSigma).epsilon(1E-12));
+
+        double numDSigma = (upper.Evaluate(masses[i]) - lower.Evaluate(masses[i])) / 2E-5;
+        double numDX = (profile.Evaluate(masses[i] + 1E-5) - profile.Evaluate(masses[i] - 1E-5)) / 2E-5;
+        REQUIRE(fabs(dSigma - numDSigma) < 1E-8 * profile.Evaluate(782.65) / 10.);
+        REQUIRE(fabs(dX - numDX) < 1E-8 * profile.Evaluate(782.65) / 10.);
+    }
+
+    // Gaussian limit
+    VoigtProfile gauss(0., 0., 2.);
+    REQUIRE(gauss.Evaluate(1.) == Approx(exp(-0.125)));
+}
+
+
+
+TEST_CASE("VoigtProfile integration"){
+
+    // Normalized profile, only the Breit-Wigner tails width / (pi * R)
+    // beyond +-R are missing
+    VoigtProfile profile(0., 1., 2.);
+    REQUIRE(profile.Integrate(-1000., 1000.) == Approx(1. - 1. / (1000. * M_PI)).epsilon(1E-6));
+
+    VoigtProfile upper(782.65, 8.49, 10. + 1E-5);
+    VoigtProfile lower(782.65, 8.49, 10. - 1E-5);
+    VoigtProfile central(782.65, 8.49, 10.);
+
+    double numDSigma = (upper.Integrate(700., 900.) - lower.Integrate(700., 900.)) / 2E-5;
+    REQUIRE(central.IntegralDSigma(700., 900.) == Approx(numDSigma).epsilon(1E-4));
+}
@@ -0,0 +1,137 @@
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibGaussFitFunction.hh"
+#include "WibCrystalBallFitFunction.hh"
+#include "WibVoigtFitFunction.hh"
+#include "WibVoigtFitFunction2D.hh"
+#include "EventGenerator.hh"
+#include "FitResult.hh"
+#include "RooMsgService.h"
+
+
+
+namespace {
+
+// Falls back to the finite differences of WibFitFunction
+template<class FitFunction>
+class FiniteDifference : public FitFunction
+{
+    public:
+        template<class... Args>
+        FiniteDifference(Args... args) : FitFunction(args...) {}
+
+    protected:
+        virtual bool GetQGradient(std::vector<double>&){ return false; }
+};
+
+
+
+void GenerateSample(EventGenerator& generator, int numEvents, std::vector<PhasespacePoint>& sample){
+
+    sample.resize(numEvents);
+    for(int i=0; i<numEvents; i++)
+        generator.Generate(sample[i]);
+}
+
+
+
+// Fits the same sample with the analytic Q gradient and with finite
+// differences, the propagated Q errors have to agree
+template<class FitFunction>
+void CheckQGradient(FitFunction& analytic, FiniteDifference<FitFunction>& numeric,
+                    const std::vector<PhasespacePoint>& sample, double eventMass, double eventMass2){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    analytic.SetCalcErrors(true);
+    numeric.SetCalcErrors(true);
+
+    for(size_t i=0; i<sample.size(); i++){
+        analytic.AddData(sample[i]);
+        numeric.AddData(sample[i]);
+    }
+
+    FitResult* analyticResult = analytic.DoFit(eventMass, eventMass2);
+    FitResult* numericResult = numeric.DoFit(eventMass, eventMass2);
+
+    REQUIRE(analyticResult->status == 0);
+    REQUIRE(analyticResult->weight == Approx(numericResult->weight));
+    REQUIRE(analyticResult->weightError > 0);
+    REQUIRE(analyticResult->weightError == Approx(numericResult->weightError).epsilon(0.01));
+
+    delete analyticResult;
+    delete numericResult;
+}
+
+}
+
+
+
+TEST_CASE("WibGaussFitFunction analytic error propagation"){
+
+    EventGenerator generator(1, 900, 1100, 31);
+    generator.SetSignal(EventGenerator::SHAPE_GAUSS, 1000, 14);
+    generator.SetSignalFraction(0.6);
+
+    std::vector<PhasespacePoint> sample;
+    GenerateSample(generator, 2000, sample);
+
+    WibGaussFitFunction analytic(1000, 900, 1100, 2, 10, 1, 100);
+    FiniteDifference<WibGaussFitFunction> numeric(1000., 900., 1100., 2u, 10., 1., 100.);
+    CheckQGradient(analytic, numeric, sample, 1020, 0);
+}
+
+
+
+TEST_CASE("WibCrystalBallFitFunction analytic error propagation"){
+
+    // Sample with a tail, so that sigma and alpha are both determined
+    EventGenerator generator(1, 900, 1100, 32);
+    generator.SetSignal(EventGenerator::SHAPE_CRYSTALBALL, 1000, 14, 0, 1.5, 3);
+    generator.SetSignalFraction(0.6);
+
+    std::vector<PhasespacePoint> sample;
+    GenerateSample(generator, 3000, sample);
+
+    WibCrystalBallFitFunction analytic(1000, 900, 1100, 1, 10, 1, 100, 1.2, 0.1, 10, 3);
+    FiniteDifference<WibCrystalBallFitFunction> numeric(1000., 900., 1100., 1u, 10., 1., 100., 1.2, 0.1, 10., 3);
+
+    // In the tail, where the closed-form tail integral enters, and at the peak
+    CheckQGradient(analytic, numeric, sample, 1000 - 2.5 * 14, 0);
+    CheckQGradient(analytic, numeric, sample, 1005, 0);
+}
+
+
+
+TEST_CASE("WibVoigtFitFunction analytic error propagation"){
+
+    EventGenerator generator(1, 900, 1100, 33);
+    generator.SetSignal(EventGenerator::SHAPE_VOIGT, 1000, 10, 8);
+    generator.SetSignalFraction(0.6);
+
+    std::vector<PhasespacePoint> sample;
+    GenerateSample(generator, 3000, sample);
+
+    WibVoigtFitFunction analytic(1000, 8, 900, 1100, 2, 8, 1, 50);
+    FiniteDifference<WibVoigtFitFunction> numeric(1000., 8., 900., 1100., 2u, 8., 1., 50.);
+    CheckQGradient(analytic, numeric, sample, 1015, 0);
+}
+
+
+
+TEST_CASE("WibVoigtFitFunction2D analytic error propagation"){
+
+    // Signal events have both masses in the peak
+    EventGenerator generator(1, 900, 1100, 34);
+    generator.SetSignal(EventGenerator::SHAPE_VOIGT, 1000, 10, 8);
+    generator.SetSignalFraction(0.6);
+    generator.SetTwoMasses(true);
+
+    std::vector<PhasespacePoint> sample;
+    GenerateSample(generator, 3000, sample);
+
+    WibVoigtFitFunction2D analytic(1000, 8, 900, 1100, 1, 8, 1, 50);
+    FiniteDifference<WibVoigtFitFunction2D> numeric(1000., 8., 900., 1100., 1u, 8., 1., 50.);
+    CheckQGradient(analytic, numeric, sample, 1010, 995);
+}
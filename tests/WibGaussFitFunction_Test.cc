@@ -3,6 +3,7 @@
 #include "WibGaussFitFunction.hh"
 #include "RooMsgService.h"
 #include "FitResult.hh"
+#include "TestSamples.hh"
 
 
 
@@ -54,3 +55,186 @@ TEST_CASE("WibGaussFitFunction Tests"){
     infile.close();
     delete fitResult;
 }
+
+
+
+TEST_CASE("WibGaussFitFunction binned fit"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    double mean          = 1000;
+    double massmin       = 900;
+    double massmax       = 1100;
+    double width         = 14;
+    double signalShare   = 0.7;
+    double polorder      = 1;
+    int ndata            = 5000;
+
+    WibGaussFitFunction unbinned(mean, massmin, massmax, polorder, 10, 1, 100);
+    WibGaussFitFunction binned(mean, massmin, massmax, polorder, 10, 1, 100);
+    binned.SetBinnedFit(100);
+    REQUIRE(binned.GetNumBins() == 100);
+
+    std::vector<double> masses;
+    GenerateGaussSample(35, ndata, mean, width, massmin, massmax, signalShare, masses);
+
+    for(size_t i=0; i<masses.size(); i++){
+        PhasespacePoint newPoint;
+        newPoint.SetMass(masses[i]);
+        unbinned.AddData(newPoint);
+        binned.AddData(newPoint);
+    }
+
+    FitResult* unbinnedResult = unbinned.DoFit(mean, 0);
+    FitResult* binnedResult = binned.DoFit(mean, 0);
+
+    REQUIRE(binnedResult->rooFitResult->status() == 0);
+    REQUIRE(binnedResult->weight == Approx(unbinnedResult->weight).epsilon(0.01));
+
+    delete unbinnedResult;
+    delete binnedResult;
+}
+
+
+
+TEST_CASE("WibGaussFitFunction weight-only fit strategy"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    double mean          = 1000;
+    double massmin       = 900;
+    double massmax       = 1100;
+    double width         = 14;
+    double signalShare   = 0.7;
+    double polorder      = 1;
+    int ndata            = 2000;
+
+    FitStrategy fastStrategy;
+    fastStrategy.strategy = 0;
+    fastStrategy.maxCalls = 10000;
+
+    // Same settings, except that HESSE always runs
+    FitStrategy hesseStrategy = fastStrategy;
+    hesseStrategy.hesseMode = FitStrategy::HESSE_ALWAYS;
+
+    WibGaussFitFunction fast(mean, massmin, massmax, polorder, 10, 1, 100);
+    WibGaussFitFunction reference(mean, massmin, massmax, polorder, 10, 1, 100);
+    fast.SetCalcErrors(false);
+    fast.SetFitStrategy(fastStrategy);
+    reference.SetCalcErrors(false);
+    reference.SetFitStrategy(hesseStrategy);
+    REQUIRE(fast.GetFitStrategy().strategy == 0);
+
+    std::vector<double> masses;
+    GenerateGaussSample(37, ndata, mean, width, massmin, massmax, signalShare, masses);
+
+    for(size_t i=0; i<masses.size(); i++){
+        PhasespacePoint newPoint;
+        newPoint.SetMass(masses[i]);
+        fast.AddData(newPoint);
+        reference.AddData(newPoint);
+    }
+
+    FitResult* fastResult = fast.DoFit(mean, 0);
+    FitResult* referenceResult = reference.DoFit(mean, 0);
+
+    REQUIRE(fastResult->rooFitResult->status() == 0);
+    REQUIRE(fastResult->weight == Approx(referenceResult->weight).epsilon(0.005));
+    REQUIRE(fastResult->weightError == 0);
+
+    // Without HESSE only the approximate covariance of MIGRAD is available
+    REQUIRE(referenceResult->covQual == 3);
+    REQUIRE(fastResult->covQual < 3);
+
+    delete fastResult;
+    delete referenceResult;
+}
+
+
+
+TEST_CASE("WibGaussFitFunction evaluation of a stored fit"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    double mean          = 1000;
+    double massmin       = 900;
+    double massmax       = 1100;
+    double width         = 14;
+    double signalShare   = 0.7;
+    double polorder      = 1;
+    int ndata            = 2000;
+
+    WibGaussFitFunction f(mean, massmin, massmax, polorder, 10, 1, 100);
+    f.SetCalcErrors(true);
+
+    std::vector<double> masses;
+    GenerateGaussSample(36, ndata, mean, width, massmin, massmax, signalShare, masses);
+
+    for(size_t i=0; i<masses.size(); i++){
+        PhasespacePoint newPoint;
+        newPoint.SetMass(masses[i]);
+        f.AddData(newPoint);
+    }
+
+    FitResult* fitResult = f.DoFit(mean + 10, 0);
+    REQUIRE(f.GetNumData() == 0);
+
+    FitResult* sameMass = f.EvaluateFit(*fitResult->rooFitResult, mean + 10, 0);
+    FitResult* otherMass = f.EvaluateFit(*fitResult->rooFitResult, mean + 30, 0);
+
+    REQUIRE(sameMass->weight == Approx(fitResult->weight));
+    REQUIRE(sameMass->weightError == Approx(fitResult->weightError));
+    REQUIRE(otherMass->weight < fitResult->weight);
+
+    delete fitResult;
+    delete sameMass;
+    delete otherMass;
+}
+
+
+
+TEST_CASE("WibGaussFitFunction fallback start values and flat background"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    double mean          = 1000;
+    double massmin       = 900;
+    double massmax       = 1100;
+    double width         = 14;
+    int ndata            = 2000;
+
+    WibGaussFitFunction f(mean, massmin, massmax, 2, 10, 1, 100);
+
+    std::vector<double> masses;
+    GenerateGaussSample(7, ndata, mean, width, massmin, massmax, 0.7, masses);
+
+    for(int pass=0; pass<3; pass++){
+        for(size_t i=0; i<masses.size(); i++){
+            PhasespacePoint newPoint;
+            newPoint.SetMass(masses[i]);
+            f.AddData(newPoint);
+        }
+
+        if(pass == 0)
+            f.SetAlternativeStart(1);
+        else if(pass == 1)
+            f.SetBackgroundFixed(true);
+
+        FitResult* fitResult = f.DoFit(mean, 0);
+
+        REQUIRE(fitResult->status == 0);
+        REQUIRE(fitResult->weight == Approx(0.94).epsilon(0.05));
+        REQUIRE(fitResult->rooFitResult->floatParsFinal().getSize() == ((pass == 1) ? 2 : 4));
+
+        if(pass == 0)
+            f.SetAlternativeStart(0);
+        else if(pass == 1)
+            f.SetBackgroundFixed(false);
+
+        delete fitResult;
+    }
+}
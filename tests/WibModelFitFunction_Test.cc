@@ -0,0 +1,115 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibModelFitFunction.hh"
+#include "SimplexModelFitter.hh"
+#include "WibGaussFitFunction.hh"
+#include "FitResult.hh"
+#include "RooMsgService.h"
+#include "RooFitResult.h"
+#include "TestSamples.hh"
+
+
+
+TEST_CASE("WibModelFitFunction agrees with the RooFit Gauss fit"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    double mean          = 1000;
+    double massmin       = 900;
+    double massmax       = 1100;
+    double width         = 14;
+    double signalShare   = 0.7;
+    int ndata            = 2000;
+
+    WibGaussFitFunction reference(mean, massmin, massmax, 2, 10, 1, 100);
+    WibModelFitFunction<GaussShape, PolynomialShape<2> > native(GaussShape(mean - massmin, 10, 1, 100),
+                                                                PolynomialShape<2>(), massmin, massmax);
+    reference.SetCalcErrors(true);
+    native.SetCalcErrors(true);
+
+    std::vector<double> masses;
+    GenerateGaussSample(38, ndata, mean, width, massmin, massmax, signalShare, masses);
+
+    for(size_t i=0; i<masses.size(); i++){
+        PhasespacePoint newPoint;
+        newPoint.SetMass(masses[i]);
+        reference.AddData(newPoint);
+        native.AddData(newPoint);
+    }
+
+    FitResult* referenceResult = reference.DoFit(mean + 5, 0);
+    FitResult* nativeResult = native.DoFit(mean + 5, 0);
+
+    REQUIRE(nativeResult != NULL);
+    REQUIRE(nativeResult->rooFitResult == NULL);
+    REQUIRE(nativeResult->status == 0);
+    REQUIRE(referenceResult->status == referenceResult->rooFitResult->status());
+    REQUIRE(nativeResult->weight == Approx(referenceResult->weight).epsilon(1E-3));
+    REQUIRE(nativeResult->weightError == Approx(referenceResult->weightError).epsilon(0.02));
+    REQUIRE(native.GetModel().GetShare() == Approx(signalShare).epsilon(0.1));
+    REQUIRE(native.GetNumData() == 0);
+
+    delete referenceResult;
+    delete nativeResult;
+}
+
+
+
+TEST_CASE("SimplexModelFitter errors agree with HESSE"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    typedef SimplexModelFitter<GaussShape, PolynomialShape<1> > Fitter;
+
+    double massmin       = 0;
+    double massmax       = 200;
+
+    Fitter fitter(GaussShape(100., 10., 1., 100.), PolynomialShape<1>(), massmax - massmin);
+    fitter.SetCalcErrors(true);
+
+    WibModelFitFunction<GaussShape, PolynomialShape<1> > hesse(GaussShape(100., 10., 1., 100.), PolynomialShape<1>(),
+                                                               massmin, massmax);
+    hesse.SetCalcErrors(true);
+
+    const unsigned int numEvents = 5;
+    std::vector<std::vector<double> > masses(numEvents);
+    std::vector<FitResult*> hesseResults(numEvents);
+
+    for(unsigned int e=0; e<numEvents; e++){
+
+        // The same neighbors as the simplex fit, within the fit range
+        GenerateGaussSample(40 + e, 800 + 100 * e, 100., 14., massmin, massmax, 0.7, masses[e]);
+        for(size_t i=0; i<masses[e].size(); i++)
+            masses[e][i] = std::min(std::max(masses[e][i], massmin), massmax);
+
+        std::vector<double> weights(masses[e].size(), 1.);
+        fitter.AddEvent(e, masses[e].size(), &masses[e][0], NULL, &weights[0], 90. + 5 * e, 0);
+
+        for(size_t i=0; i<masses[e].size(); i++){
+            PhasespacePoint newPoint;
+            newPoint.SetMass(masses[e][i]);
+            hesse.AddData(newPoint);
+        }
+
+        hesseResults[e] = hesse.DoFit(massmin + 90. + 5 * e, 0);
+    }
+
+    std::vector<Fitter::Result> results;
+    fitter.Run(results);
+    REQUIRE(results.size() == numEvents);
+
+    for(unsigned int e=0; e<numEvents; e++){
+        REQUIRE(results[e].status == 0);
+        REQUIRE(hesseResults[e]->status == 0);
+        REQUIRE(results[e].weight == Approx(hesseResults[e]->weight).epsilon(1E-3));
+        REQUIRE(results[e].weightError > 0);
+        REQUIRE(results[e].weightError == Approx(hesseResults[e]->weightError).epsilon(0.05));
+
+        delete hesseResults[e];
+    }
+}
@@ -0,0 +1,43 @@
+#include <thread>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibProfile.hh"
+
+
+
+TEST_CASE( "WibProfile merges thread records", "[WibProfile]" ) {
+
+    WibProfile::Reset();
+
+    std::vector<std::thread> threads;
+    for(int t=0; t<4; t++){
+        threads.push_back(std::thread([](){
+            for(int i=0; i<100; i++){
+                WibProfile::AddTime(WibProfile::STAGE_SORT, 0.5);
+                WibProfile::AddCount(WibProfile::COUNT_FITS, 2);
+            }
+        }));
+    }
+
+    for(size_t t=0; t<threads.size(); t++)
+        threads[t].join();
+
+    WibProfile::AddCount(WibProfile::COUNT_EVENTS, 3);
+    {
+        WibStageTimer timer(WibProfile::STAGE_FIT);
+    }
+
+    WibProfile::Stats stats = WibProfile::GetStats();
+    REQUIRE( stats.calls[WibProfile::STAGE_SORT] == 400 );
+    REQUIRE( stats.seconds[WibProfile::STAGE_SORT] == Approx(200.) );
+    REQUIRE( stats.counts[WibProfile::COUNT_FITS] == 800 );
+    REQUIRE( stats.counts[WibProfile::COUNT_EVENTS] == 3 );
+    REQUIRE( stats.calls[WibProfile::STAGE_FIT] == 1 );
+    REQUIRE( stats.seconds[WibProfile::STAGE_FIT] >= 0 );
+    REQUIRE( stats.calls[WibProfile::STAGE_HESSE] == 0 );
+
+    WibProfile::Reset();
+    stats = WibProfile::GetStats();
+    REQUIRE( stats.calls[WibProfile::STAGE_SORT] == 0 );
+    REQUIRE( stats.counts[WibProfile::COUNT_EVENTS] == 0 );
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibProgress.hh"
+
+
+
+TEST_CASE( "WibProgress", "[WibProgress]" ) {
+
+    SECTION( "worker counters are merged" ) {
+        WibProgress progress(10000, 4);
+
+        std::vector<std::thread> threads;
+        for(unsigned int t=0; t<4; t++){
+            threads.push_back(std::thread([&progress, t](){
+                for(int i=0; i<1000; i++)
+                    progress.AddEvent(t, i % 100 != 0, 0.01 * (t + 1));
+            }));
+        }
+
+        for(size_t t=0; t<threads.size(); t++)
+            threads[t].join();
+
+        ProgressStatus status = progress.GetStatus();
+        REQUIRE( status.numDone == 4000 );
+        REQUIRE( status.numFailed == 40 );
+        REQUIRE( status.workerDone[2] == 1000 );
+        REQUIRE( status.workerLatency[2] == Approx(0.03) );
+        REQUIRE( status.meanLatency == Approx(0.025) );
+        REQUIRE( status.eventsPerSecond > 0 );
+        REQUIRE( status.etaSeconds >= 0 );
+    }
+
+    SECTION( "status file is replaced by the reporter" ) {
+        const std::string fileName = "progressTest.json";
+        WibProgress progress(10);
+
+        progress.Start(fileName, 0.01);
+        for(int i=0; i<10; i++)
+            progress.AddEvent(0, true, 0.001);
+        progress.Stop();
+
+        std::ifstream in(fileName.c_str());
+        std::stringstream content;
+        content << in.rdbuf();
+
+        REQUIRE( content.str().find("\"done\": 10,") != std::string::npos );
+        REQUIRE( content.str().find("\"eta_s\": 0,") != std::string::npos );
+        REQUIRE( !std::ifstream((fileName + ".tmp").c_str()).good() );
+
+        remove(fileName.c_str());
+    }
+}
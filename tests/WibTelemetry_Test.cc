@@ -0,0 +1,127 @@
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibTelemetry.hh"
+
+
+
+TelemetryRecord MakeRecord(unsigned long long event, unsigned int source){
+
+    TelemetryRecord record = TelemetryRecord();
+    record.event = event;
+    record.source = source;
+    record.status = (event % 10 == 0) ? 4 : 0;
+    record.covQual = 3;
+    record.clip = (event % 20 == 1) ? 1 : 0;
+    record.numCalls = 150;
+    record.numNeighbors = 200;
+    record.q = 0.5;
+    record.edm = 1E-5;
+    record.seconds = 2E-3;
+
+    return record;
+}
+
+
+
+TEST_CASE( "WibTelemetry ring buffer", "[WibTelemetry]" ) {
+
+    SECTION( "records of several threads are all drained" ) {
+        WibTelemetry telemetry(1024);
+        telemetry.Start(1);
+
+        std::vector<std::thread> threads;
+        for(unsigned int t=0; t<4; t++){
+            threads.push_back(std::thread([&telemetry, t](){
+                for(unsigned long long i=0; i<1000; i++){
+                    while(!telemetry.Push(MakeRecord(i, t)))
+                        std::this_thread::yield();
+                }
+            }));
+        }
+
+        for(size_t t=0; t<threads.size(); t++)
+            threads[t].join();
+
+        telemetry.Stop();
+        TelemetrySummary summary = telemetry.GetSummary();
+
+        REQUIRE( summary.numRecords == 4000 );
+        REQUIRE( summary.statusCounts[0] == 3600 );
+        REQUIRE( summary.statusCounts[4] == 400 );
+        REQUIRE( summary.covQualCounts[3] == 4000 );
+        REQUIRE( summary.numClippedHigh == 200 );
+        REQUIRE( summary.edm.GetEntries() == 4000 );
+        REQUIRE( summary.edm.GetUnderflow() == 0 );
+    }
+
+    SECTION( "a full ring drops records instead of blocking" ) {
+        WibTelemetry telemetry(8);
+
+        for(unsigned long long i=0; i<10; i++)
+            telemetry.Push(MakeRecord(i, 0));
+
+        TelemetrySummary summary = telemetry.GetSummary();
+        REQUIRE( summary.numRecords == 8 );
+        REQUIRE( summary.numDropped == 2 );
+
+        REQUIRE( telemetry.Push(MakeRecord(10, 0)) );
+        REQUIRE( telemetry.Drain() == 1 );
+    }
+
+    SECTION( "CSV sink" ) {
+        const char* fileName = "telemetryTest.csv";
+        {
+            WibTelemetry telemetry(16);
+            REQUIRE( telemetry.OpenSink(fileName) );
+            telemetry.Push(MakeRecord(1, 2));
+            telemetry.Push(MakeRecord(2, 2));
+        }
+
+        std::ifstream in(fileName);
+        std::string header, line;
+        std::getline(in, header);
+        std::getline(in, line);
+
+        REQUIRE( header.compare(0, 13, "event,source,") == 0 );
+        REQUIRE( line.compare(0, 4, "1,2,") == 0 );
+        REQUIRE( std::getline(in, line) );
+        REQUIRE( !std::getline(in, line) );
+
+        remove(fileName);
+    }
+}
+
+
+
+TEST_CASE( "TelemetryHistogram", "[WibTelemetry]" ) {
+
+    TelemetryHistogram histogram(1E-6, 1., 6, true);
+    histogram.Fill(0);
+    histogram.Fill(5E-6);
+    histogram.Fill(0.5);
+    histogram.Fill(2.);
+
+    REQUIRE( histogram.GetEntries() == 4 );
+    REQUIRE( histogram.GetUnderflow() == 1 );
+    REQUIRE( histogram.GetOverflow() == 1 );
+    REQUIRE( histogram.GetBinCount(0) == 1 );
+    REQUIRE( histogram.GetBinCount(5) == 1 );
+    REQUIRE( histogram.GetBinLowEdge(1) == Approx(1E-5) );
+
+    // NaN is an underflow, the largest value below the upper edge is in the last bin
+    TelemetryHistogram linear(-1., 1., 3, false);
+    linear.Fill(std::numeric_limits<double>::quiet_NaN());
+    linear.Fill(std::nextafter(1., 0.));
+    histogram.Fill(std::numeric_limits<double>::quiet_NaN());
+
+    REQUIRE( linear.GetUnderflow() == 1 );
+    REQUIRE( linear.GetOverflow() == 0 );
+    REQUIRE( linear.GetBinCount(2) == 1 );
+    REQUIRE( histogram.GetUnderflow() == 2 );
+}
@@ -0,0 +1,59 @@
+#include "Catch-master/single_include/catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <cstdio>
+
+#include "WibTrace.hh"
+#include "WibProfile.hh"
+
+
+TEST_CASE( "WibTrace ring buffers", "[WibTrace]" ) {
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = start + std::chrono::microseconds(250);
+
+    WibTrace::Clear();
+    WibTrace::AddSpan(WibProfile::STAGE_SORT, start, end);
+    REQUIRE( WibTrace::GetNumSpans() == 0 );
+
+    WibTrace::Start(4);
+    WibTrace::SetEvent(7);
+
+    for(int i=0; i<6; i++)
+        WibTrace::AddSpan(WibProfile::STAGE_MINIMIZE, start, end);
+
+    std::thread worker([&](){
+        WibTrace::SetEvent(3);
+        WibTrace::AddSpan(WibProfile::STAGE_OUTPUT, start, end);
+    });
+    worker.join();
+
+    WibTrace::Stop();
+    WibTrace::AddSpan(WibProfile::STAGE_SORT, start, end);
+
+    REQUIRE( WibTrace::GetNumSpans() == 5 );
+    REQUIRE( WibTrace::GetNumOverwritten() == 2 );
+
+    std::string fileName = "WibTrace_Test.json";
+    REQUIRE( WibTrace::WriteChromeTrace(fileName) );
+
+    std::ifstream in(fileName.c_str());
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string json = content.str();
+
+    REQUIRE( json.find("\"traceEvents\"") != std::string::npos );
+    REQUIRE( json.find("\"name\": \"minimize\", \"cat\": \"wibas\", \"ph\": \"X\"") != std::string::npos );
+    REQUIRE( json.find("\"dur\": 250.000, \"args\": {\"event\": 7}") != std::string::npos );
+    REQUIRE( json.find("\"name\": \"output\"") != std::string::npos );
+    REQUIRE( json.find("{\"event\": 3}") != std::string::npos );
+    REQUIRE( json.find("\"name\": \"sort\"") == std::string::npos );
+
+    // The buffer of the finished worker is freed
+    WibTrace::Clear();
+    REQUIRE( WibTrace::GetNumSpans() == 0 );
+    std::remove(fileName.c_str());
+}
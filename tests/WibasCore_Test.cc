@@ -0,0 +1,299 @@
+#include <cmath>
+#include <vector>
+#include "Catch-master/single_include/catch.hpp"
+#include "WibasCore.hh"
+#include "WibGaussFitFunction.hh"
+#include "WibModelFitFunction.hh"
+#include "EventGenerator.hh"
+#include "RooMsgService.h"
+
+
+
+namespace {
+
+const double minMass = 900;
+const double maxMass = 1100;
+const unsigned int numEvents = 12;
+
+// Weights the first numEvents points of the sample with a new WiBaS, in the
+// given order of the events
+void WeightEvents(const std::vector<PhasespacePoint>& sample, WibFitFunction& fitFunction,
+                  const std::vector<unsigned int>& order, std::vector<double>& weights,
+                  std::vector<double>& weightErrors){
+
+    WiBaS wibas(fitFunction);
+    EventGenerator generator(2, minMass, maxMass);
+    generator.RegisterCoords(wibas);
+    wibas.SetNearestNeighbors(300);
+    wibas.SetCalcErrors(true);
+    wibas.SetReproducible();
+
+    for(size_t i=0; i<sample.size(); i++){
+        PhasespacePoint point = sample[i];
+        wibas.AddPhasespacePoint(point);
+    }
+
+    weights.assign(numEvents, -1);
+    weightErrors.assign(numEvents, -1);
+
+    for(size_t i=0; i<order.size(); i++){
+        PhasespacePoint event = sample[order[i]];
+        REQUIRE(wibas.CalcWeight(event));
+        weights[order[i]] = event.GetWeight();
+        weightErrors[order[i]] = event.GetWeightError();
+    }
+}
+
+
+
+// Gauss fit function whose fits fail below a given rung of the fallback
+// ladder of WiBaS
+class LadderFitFunction : public WibGaussFitFunction
+{
+    public:
+        LadderFitFunction(double pminMass, double pmaxMass, unsigned int pnumNeighbors) :
+            WibGaussFitFunction(1000, pminMass, pmaxMass, 1, 10, 1, 100),
+            numNeighbors(pnumNeighbors),
+            workingRung(WiBaS::FIT_NOMINAL),
+            attempt(0),
+            backgroundFixed(false)
+        {
+        }
+
+        void SetWorkingRung(short int rung){ workingRung = rung; }
+
+        virtual FitResult* DoFitD(double eventMass, double eventMass2){
+            short int rung = WiBaS::FIT_NOMINAL;
+            if(attempt > 0)
+                rung = WiBaS::FIT_START_VALUES;
+            else if(backgroundFixed)
+                rung = WiBaS::FIT_FIXED_BACKGROUND;
+            else if(GetNumData() > numNeighbors)
+                rung = WiBaS::FIT_MORE_NEIGHBORS;
+
+            if(rung < workingRung)
+                return NULL;
+
+            return WibGaussFitFunction::DoFitD(eventMass, eventMass2);
+        }
+
+        virtual void SetAlternativeStart(unsigned int pattempt){
+            attempt = pattempt;
+            WibGaussFitFunction::SetAlternativeStart(pattempt);
+        }
+
+        virtual void SetBackgroundFixed(bool fixed){
+            backgroundFixed = fixed;
+            WibGaussFitFunction::SetBackgroundFixed(fixed);
+        }
+
+    private:
+        unsigned int numNeighbors;
+        short int workingRung;
+        unsigned int attempt;
+        bool backgroundFixed;
+};
+
+
+
+template<class FitFunction>
+void CheckOrderIndependence(FitFunction& forwardFunction, FitFunction& splitFunction){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    EventGenerator generator(2, minMass, maxMass, 50);
+    generator.SetSignal(EventGenerator::SHAPE_GAUSS, 1000, 14);
+    generator.SetSignalFraction(0.6, 0.5);
+
+    std::vector<PhasespacePoint> sample(3000);
+    for(size_t i=0; i<sample.size(); i++)
+        generator.Generate(sample[i]);
+
+    // All events in one object, against the events in reverse order split
+    // over two objects sharing a fit function
+    std::vector<unsigned int> forward, firstHalf, secondHalf;
+    for(unsigned int i=0; i<numEvents; i++)
+        forward.push_back(i);
+    for(unsigned int i=numEvents; i>numEvents/2; i--)
+        firstHalf.push_back(i - 1);
+    for(unsigned int i=numEvents/2; i>0; i--)
+        secondHalf.push_back(i - 1);
+
+    std::vector<double> weights, weightErrors, splitWeights, splitErrors, secondWeights, secondErrors;
+    WeightEvents(sample, forwardFunction, forward, weights, weightErrors);
+    WeightEvents(sample, splitFunction, firstHalf, splitWeights, splitErrors);
+    WeightEvents(sample, splitFunction, secondHalf, secondWeights, secondErrors);
+
+    for(unsigned int i=0; i<numEvents/2; i++){
+        splitWeights[i] = secondWeights[i];
+        splitErrors[i] = secondErrors[i];
+    }
+
+    for(unsigned int i=0; i<numEvents; i++){
+        REQUIRE(weights[i] >= 0);
+        REQUIRE(weights[i] == splitWeights[i]);
+        REQUIRE(weightErrors[i] == splitErrors[i]);
+    }
+}
+
+}
+
+
+
+TEST_CASE("WiBaS reproducible weights do not depend on the event order"){
+
+    SECTION( "RooFit fit function" ) {
+        WibGaussFitFunction forwardFunction(1000, minMass, maxMass, 1, 10, 1, 100);
+        WibGaussFitFunction splitFunction(1000, minMass, maxMass, 1, 10, 1, 100);
+        CheckOrderIndependence(forwardFunction, splitFunction);
+    }
+
+    SECTION( "native fit function" ) {
+        WibModelFitFunction<GaussShape, PolynomialShape<1> > forwardFunction(GaussShape(100, 10, 1, 100),
+                                                                             PolynomialShape<1>(), minMass, maxMass);
+        WibModelFitFunction<GaussShape, PolynomialShape<1> > splitFunction(GaussShape(100, 10, 1, 100),
+                                                                           PolynomialShape<1>(), minMass, maxMass);
+        CheckOrderIndependence(forwardFunction, splitFunction);
+    }
+}
+
+
+
+TEST_CASE("WiBaS fit cache"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    EventGenerator generator(2, minMass, maxMass, 51);
+    generator.SetSignal(EventGenerator::SHAPE_GAUSS, 1000, 14);
+    generator.SetSignalFraction(0.6, 0.5);
+
+    std::vector<PhasespacePoint> sample(2000);
+    for(size_t i=0; i<sample.size(); i++)
+        generator.Generate(sample[i]);
+
+    // The second point sits right next to the first one
+    const std::string& coordName = generator.GetCoordNames().at(0);
+    sample[1] = sample[0];
+    sample[1].SetCoordinate(coordName, sample[0].coordValueMap[coordName] + 1E-6);
+    sample[1].SetMass(sample[0].GetMass() + 3);
+
+    WibGaussFitFunction fitFunction(1000, minMass, maxMass, 1, 10, 1, 100);
+    WiBaS wibas(fitFunction);
+    generator.RegisterCoords(wibas);
+    wibas.SetNearestNeighbors(300);
+
+    SECTION( "exact hits for events outside the cloud" ) {
+        wibas.SetFitCache(true);
+        for(size_t i=2; i<sample.size(); i++){
+            PhasespacePoint point = sample[i];
+            wibas.AddPhasespacePoint(point);
+        }
+
+        PhasespacePoint first = sample[0];
+        PhasespacePoint second = sample[1];
+        REQUIRE(wibas.CalcWeight(first));
+        REQUIRE(wibas.CalcWeight(second));
+
+        REQUIRE(wibas.GetNumFits() == 1);
+        REQUIRE(wibas.GetNumCacheHits() == 1);
+        REQUIRE(second.GetWeight() != first.GetWeight());
+    }
+
+    SECTION( "similar neighborhoods of events in the cloud" ) {
+        wibas.SetFitCache(true, 0.9);
+        for(size_t i=0; i<sample.size(); i++){
+            PhasespacePoint point = sample[i];
+            wibas.AddPhasespacePoint(point);
+        }
+
+        // Each event drops itself from its neighbors, so the sets differ in
+        // one point
+        PhasespacePoint first = sample[0];
+        PhasespacePoint second = sample[1];
+        REQUIRE(wibas.CalcWeight(first));
+        REQUIRE(wibas.CalcWeight(second));
+
+        REQUIRE(wibas.GetNumFits() == 1);
+        REQUIRE(wibas.GetNumCacheHits() == 1);
+    }
+}
+
+
+
+TEST_CASE("WiBaS fallback ladder"){
+
+    RooMsgService::instance().setSilentMode(true);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::FATAL);
+
+    EventGenerator generator(2, minMass, maxMass, 52);
+    generator.SetSignal(EventGenerator::SHAPE_GAUSS, 1000, 14);
+    generator.SetSignalFraction(0.6, 0.5);
+
+    std::vector<PhasespacePoint> sample(2000);
+    for(size_t i=0; i<sample.size(); i++)
+        generator.Generate(sample[i]);
+
+    // The second point sits right next to the first one, the third at the
+    // same place with another mass
+    const std::string& coordName = generator.GetCoordNames().at(0);
+    sample[1] = sample[0];
+    sample[1].SetCoordinate(coordName, sample[0].coordValueMap[coordName] + 1E-6);
+    sample[2] = sample[0];
+    sample[2].SetMass(sample[0].GetMass() + 5);
+
+    LadderFitFunction fitFunction(minMass, maxMass, 300);
+    WiBaS wibas(fitFunction);
+    generator.RegisterCoords(wibas);
+    wibas.SetNearestNeighbors(300);
+    wibas.SetFitFallback(true);
+
+    // The points remember their index in the cloud, the last one is added later
+    for(size_t i=0; i+1<sample.size(); i++)
+        wibas.AddPhasespacePoint(sample[i]);
+
+    REQUIRE(wibas.CalcWeight(sample[0]));
+    REQUIRE(wibas.CalcWeight(sample[2]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_NOMINAL);
+    REQUIRE(sample[0].GetWeight() != sample[2].GetWeight());
+
+    // Without any converging fit, Q is averaged over both points at the
+    // place of the first one
+    fitFunction.SetWorkingRung(WiBaS::FIT_FAILED);
+    REQUIRE(wibas.CalcWeight(sample[1]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_NEIGHBOR_AVERAGE);
+    REQUIRE(sample[1].GetWeight() == Approx(0.5 * (sample[0].GetWeight() + sample[2].GetWeight())));
+    REQUIRE(sample[1].GetWeightError() == Approx(0.5 * fabs(sample[0].GetWeight() - sample[2].GetWeight())));
+
+    fitFunction.SetWorkingRung(WiBaS::FIT_START_VALUES);
+    REQUIRE(wibas.CalcWeight(sample[3]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_START_VALUES);
+
+    fitFunction.SetWorkingRung(WiBaS::FIT_FIXED_BACKGROUND);
+    REQUIRE(wibas.CalcWeight(sample[4]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_FIXED_BACKGROUND);
+
+    fitFunction.SetWorkingRung(WiBaS::FIT_MORE_NEIGHBORS);
+    REQUIRE(wibas.CalcWeight(sample[5]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_MORE_NEIGHBORS);
+
+    // A point added after the first weighted events
+    wibas.AddPhasespacePoint(sample.back());
+    fitFunction.SetWorkingRung(WiBaS::FIT_NOMINAL);
+    REQUIRE(wibas.CalcWeight(sample.back()));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_NOMINAL);
+
+    // The reproducible mode has no neighbor average
+    wibas.SetReproducible();
+    fitFunction.SetWorkingRung(WiBaS::FIT_FAILED);
+    REQUIRE_FALSE(wibas.CalcWeight(sample[6]));
+    REQUIRE(wibas.GetLastFitRung() == WiBaS::FIT_FAILED);
+
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_NOMINAL) == 3);
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_START_VALUES) == 1);
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_FIXED_BACKGROUND) == 1);
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_MORE_NEIGHBORS) == 1);
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_NEIGHBOR_AVERAGE) == 1);
+    REQUIRE(wibas.GetNumFitRung(WiBaS::FIT_FAILED) == 1);
+}